@@ -4,6 +4,9 @@
 #include <stdint.h>
 
 #define ANIDXSET_NODE_CAPACITY 0x1fe
+#define ANIDXSET_BITMAP_LEAVES 8
+#define ANIDXSET_BITMAP_CAPACITY 0x40000
+#define ANIDXSET_INVALID 0xffffffffffffffffUL
 
 /**
  * This structure must be a page, meaning 0x200 total uint64_t values.
@@ -16,6 +19,16 @@ typedef struct {
   void * next;
 } __attribute__((packed)) anidxset_node_t;
 
+/**
+ * The summary page of a bitmap set. Bit `j` of `summary[i]` is set when leaf
+ * word `i * 64 + j` is full. Each leaf is a page of 0x200 words, allocated
+ * the first time an index inside it is handed out.
+ */
+typedef struct {
+  uint64_t summary[0x40];
+  uint64_t * leaves[ANIDXSET_BITMAP_LEAVES];
+} __attribute__((packed)) anidxset_bitmap_t;
+
 typedef void * (*anidxset_alloc_t)();
 typedef void (*anidxset_free_t)(void * ptr);
 
@@ -24,11 +37,25 @@ typedef struct {
   anidxset_node_t * first;
   anidxset_alloc_t alloc;
   anidxset_free_t free;
+
+  // only used in bitmap mode; bit `i` is set when `summary[i]` is full
+  anidxset_bitmap_t * bitmap;
+  uint64_t top;
 } __attribute__((packed)) anidxset_root_t;
 
 uint8_t anidxset_initialize(anidxset_root_t * root,
                             anidxset_alloc_t alloc,
                             anidxset_free_t free);
+
+/**
+ * Initialize a set which always hands out the lowest free index, using a
+ * three level bitmap. At most ANIDXSET_BITMAP_CAPACITY indexes are available;
+ * anidxset_get() returns ANIDXSET_INVALID once they run out or if a leaf page
+ * cannot be allocated.
+ */
+uint8_t anidxset_initialize_bitmap(anidxset_root_t * root,
+                                   anidxset_alloc_t alloc,
+                                   anidxset_free_t free);
 uint64_t anidxset_get(anidxset_root_t * root);
 uint8_t anidxset_put(anidxset_root_t * root, uint64_t value);
 void anidxset_free(anidxset_root_t * root);
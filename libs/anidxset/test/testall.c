@@ -15,6 +15,7 @@ void test_initialize();
 void test_massive_gets();
 void test_massive_puts();
 void test_get_loopback();
+void test_bitmap();
 
 static anidxset_root_t root;
 
@@ -24,6 +25,7 @@ int main(int argc, const char * argv[]) {
   test_massive_puts();
   test_get_loopback();
   anidxset_free(&root);
+  test_bitmap();
   return 0;
 }
 
@@ -102,3 +104,38 @@ void test_get_loopback() {
   }
   end_test();
 }
+
+void test_bitmap() {
+  begin_test("bitmap");
+  
+  anidxset_root_t bitmap;
+  if (!anidxset_initialize_bitmap(&bitmap, block_alloc, block_free)) {
+    fail_test("failed to initialize bitmap");
+  }
+  int i;
+  for (i = 0; i < ANIDXSET_BITMAP_CAPACITY; i++) {
+    if (anidxset_get(&bitmap) != i) fail_test("got non-sequential index");
+  }
+  if (anidxset_get(&bitmap) != ANIDXSET_INVALID) {
+    fail_test("got index past capacity");
+  }
+  
+  // the lowest free index should always come back first
+  for (i = 0x1000; i < 0x30000; i += 0x777) {
+    if (!anidxset_put(&bitmap, i)) fail_test("failed to put");
+  }
+  if (!anidxset_put(&bitmap, 3)) fail_test("failed to put");
+  if (anidxset_get(&bitmap) != 3) fail_test("did not reuse lowest index");
+  for (i = 0x1000; i < 0x30000; i += 0x777) {
+    if (anidxset_get(&bitmap) != i) fail_test("did not reuse in order");
+  }
+  if (anidxset_get(&bitmap) != ANIDXSET_INVALID) {
+    fail_test("got index past capacity");
+  }
+  if (anidxset_put(&bitmap, ANIDXSET_BITMAP_CAPACITY)) {
+    fail_test("put index past capacity");
+  }
+  
+  anidxset_free(&bitmap);
+  end_test();
+}
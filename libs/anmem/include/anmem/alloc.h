@@ -22,7 +22,22 @@ void anmem_free_aligned(anmem_t * mem, void * buffer, uint64_t len);
 void * anmem_alloc_page(anmem_t * mem);
 
 /**
- * Free a page of memory which was allocated with anmem_alloc_page().
+ * Allocate a page from an allocator whose `node` field is `node`. This will
+ * not fall back on other nodes; use anmem_alloc_page() for that.
+ */
+void * anmem_alloc_page_node(anmem_t * mem, uint8_t node);
+
+/**
+ * Like anmem_alloc_page_node(), but try allocator `*hint` first and store the
+ * index of the allocator which gave the page in `*hint`. Keeping a hint per
+ * caller avoids scanning every allocator on each allocation. An invalid hint
+ * (e.g. `mem->count`) is ignored.
+ */
+void * anmem_alloc_page_hint(anmem_t * mem, uint8_t node, uint64_t * hint);
+
+/**
+ * Free a page of memory which was allocated with anmem_alloc_page() or
+ * anmem_alloc_page_node().
  */
 void anmem_free_page(anmem_t * mem, void * page);
 
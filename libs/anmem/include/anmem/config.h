@@ -5,7 +5,8 @@
 
 /**
  * Configure the anmem allocator. This must be called after you have mapped
- * physical memory to contiguous virtual memory.
+ * physical memory to contiguous virtual memory, or to a direct map with the
+ * config's `directMapped` flag set.
  *
  * @param config Information about the physical memory's topology.
  *
@@ -23,6 +23,9 @@ typedef struct {
   // used before allocating anything on this allocator
   uint64_t lock;
   
+  // the NUMA node which this allocator's memory belongs to (0 by default)
+  uint8_t node;
+  
   union {
     anpages_struct_t anpagesRoot;
     analloc_struct_t anallocRoot;
@@ -46,6 +49,10 @@ typedef struct {
  * `sizeOffset` in the struct. Additionally, each structure contains the
  * `physicalPageOffset` of this range of memory in the physical address space.
  * The pointer to the first struct is `structs`.
+ *
+ * If `directMapped` is false, the regions are packed back-to-back in virtual
+ * memory. Otherwise, each region's virtual pages are its physical pages, and
+ * the gaps between regions are never handed out.
  */
 typedef struct {
   void * structs;
@@ -53,6 +60,7 @@ typedef struct {
   uint64_t physPageOffset;
   uint64_t structSize;
   uint64_t structCount;
+  bool directMapped;
 } __attribute__((packed)) anmem_config_t;
 
 #endif
@@ -1,6 +1,60 @@
 #include "anlock.h"
 
-static uint64_t read_value_atomically(uint64_t * ptr);
+// reader-writer lock layout: the low 32 bits count the readers, the next 31
+// count the waiting writers, and the top bit is set while a writer holds it
+#define RW_READERS 0xffffffffUL
+#define RW_WAITING (1UL << 32)
+#define RW_WRITER (1UL << 63)
+
+static uint8_t ticket_lock(anlock_t lock, void * data, void (*fn)(void * d));
+static void ticket_unlock(anlock_t lock);
+static uint64_t read_value(uint64_t * ptr);
+static void pause_rounds(uint64_t count);
+
+#ifdef ANLOCK_STATS
+
+#define STATS_SLOTS 0x400
+#define STATS_TOMBSTONE 1UL
+
+typedef struct {
+  uint64_t lock;
+  uint64_t holdStart;
+  anlock_stat_t * stat;
+} stats_slot_t;
+
+static uint64_t statsLock = 0;
+static uint64_t statsCount = 0;
+static anlock_stat_t statsClasses[ANLOCK_STATS_CLASSES];
+static stats_slot_t statsSlots[STATS_SLOTS];
+
+static uint64_t stats_time();
+static void stats_acquired(anlock_t lock,
+                           uint64_t start,
+                           uint8_t contended,
+                           uint8_t exclusive);
+static void stats_released(anlock_t lock);
+static stats_slot_t * stats_slot(anlock_t lock);
+static void stats_compact(uint64_t idx);
+static anlock_stat_t * stats_class(const char * name);
+static uint8_t stats_name_equal(const char * name1, const char * name2);
+static void stats_max(uint64_t * ptr, uint64_t value);
+
+#else
+
+static inline uint64_t stats_time() {
+  return 0;
+}
+
+static inline void stats_acquired(anlock_t lock,
+                                  uint64_t start,
+                                  uint8_t contended,
+                                  uint8_t exclusive) {
+}
+
+static inline void stats_released(anlock_t lock) {
+}
+
+#endif
 
 void anlock_initialize(anlock_t lock) {
   *lock = 0;
@@ -11,21 +65,126 @@ void anlock_lock(anlock_t lock) {
 }
 
 void anlock_lock_waiting(anlock_t lock, void * data, void (*fn)(void * d)) {
+  uint64_t start = stats_time();
+  uint8_t contended = ticket_lock(lock, data, fn);
+  stats_acquired(lock, start, contended, 1);
+}
+
+void anlock_unlock(anlock_t lock) {
+  stats_released(lock);
+  ticket_unlock(lock);
+}
+
+void anlock_mcs_lock(anlock_t lock, anlock_node_t * node) {
+  uint64_t start = stats_time();
+  node->next = (anlock_node_t *)0;
+  node->locked = 1;
+  anlock_node_t * pred;
+  pred = (anlock_node_t *)__sync_lock_test_and_set(lock, (uint64_t)node);
+  if (!pred) {
+    stats_acquired(lock, start, 0, 1);
+    return;
+  }
+
+  pred->next = node;
+  while (node->locked) {
+    pause_rounds(1);
+  }
+  __asm__ __volatile__("" : : : "memory");
+  stats_acquired(lock, start, 1, 1);
+}
+
+uint8_t anlock_mcs_trylock(anlock_t lock, anlock_node_t * node) {
+  node->next = (anlock_node_t *)0;
+  node->locked = 1;
+  if (!__sync_bool_compare_and_swap(lock, 0, (uint64_t)node)) return 0;
+  stats_acquired(lock, stats_time(), 0, 1);
+  return 1;
+}
+
+void anlock_mcs_unlock(anlock_t lock, anlock_node_t * node) {
+  stats_released(lock);
+  anlock_node_t * next = node->next;
+  if (!next) {
+    if (__sync_bool_compare_and_swap(lock, (uint64_t)node, 0)) return;
+    // a waiter has swapped itself in but not yet linked itself to us
+    while (!(next = node->next)) {
+      pause_rounds(1);
+    }
+  }
+  __asm__ __volatile__("" : : : "memory");
+  next->locked = 0;
+}
+
+void anlock_read_lock(anlock_t lock) {
+  uint64_t start = stats_time();
+  uint8_t contended = 0;
+  while (1) {
+    uint64_t oldValue = __sync_fetch_and_add(lock, 1);
+    if (!(oldValue & ~RW_READERS)) break;
+
+    // a writer holds or awaits the lock; back off until it is done
+    contended = 1;
+    __sync_fetch_and_sub(lock, 1);
+    while (read_value(lock) & ~RW_READERS) {
+      pause_rounds(ANLOCK_BACKOFF_UNIT);
+    }
+  }
+  // readers overlap, so they do not count towards the hold time
+  stats_acquired(lock, start, contended, 0);
+}
+
+void anlock_read_unlock(anlock_t lock) {
+  __sync_fetch_and_sub(lock, 1);
+}
+
+void anlock_write_lock(anlock_t lock) {
+  uint64_t start = stats_time();
+  uint8_t contended = 0;
+  __sync_fetch_and_add(lock, RW_WAITING);
+  uint64_t rounds = 1;
+  while (1) {
+    uint64_t value = read_value(lock);
+    if (!(value & (RW_WRITER | RW_READERS))) {
+      uint64_t newValue = (value - RW_WAITING) | RW_WRITER;
+      if (__sync_bool_compare_and_swap(lock, value, newValue)) break;
+    }
+    contended = 1;
+    pause_rounds(rounds);
+    if (rounds < ANLOCK_BACKOFF_MAX) rounds <<= 1;
+  }
+  stats_acquired(lock, start, contended, 1);
+}
+
+void anlock_write_unlock(anlock_t lock) {
+  stats_released(lock);
+  __sync_fetch_and_and(lock, ~RW_WRITER);
+}
+
+static uint8_t ticket_lock(anlock_t lock, void * data, void (*fn)(void * d)) {
   volatile anlock_t ptr = lock;
   uint64_t oldValue = __sync_fetch_and_add(ptr, 1);
   uint32_t lower = (uint32_t)(oldValue & 0xffffffffL);
-  if (!lower) return; // we have seized the lock first!
+  if (!lower) return 0; // we have seized the lock first!
   
   uint32_t upper = (uint32_t)(oldValue >> 32L);
   uint32_t waitUntil = (uint32_t)(upper + lower);
   while (1) {
-    uint64_t nowUpper = read_value_atomically(lock) >> 32L;
-    if (nowUpper == (uint64_t)waitUntil) return;
-    if (fn) fn(data);
+    uint32_t nowUpper = (uint32_t)(read_value(lock) >> 32L);
+    if (nowUpper == waitUntil) return 1;
+    if (fn) {
+      fn(data);
+    } else {
+      // wait longer the further back in line we are
+      uint64_t ahead = (uint64_t)(uint32_t)(waitUntil - nowUpper);
+      uint64_t rounds = ahead * ANLOCK_BACKOFF_UNIT;
+      if (rounds > ANLOCK_BACKOFF_MAX) rounds = ANLOCK_BACKOFF_MAX;
+      pause_rounds(rounds);
+    }
   }
 }
 
-void anlock_unlock(anlock_t lock) {
+static void ticket_unlock(anlock_t lock) {
   // use Intel's `lock` directive here to ensure that the unlock
   // operation is atomic.
   __asm__ __volatile__ ("movq $0xffffffff, %%rax\n"
@@ -35,6 +194,166 @@ void anlock_unlock(anlock_t lock) {
                         : "rax", "memory");
 }
 
-static uint64_t read_value_atomically(uint64_t * ptr) {
-  return __sync_fetch_and_add(ptr, 0);
+static uint64_t read_value(uint64_t * ptr) {
+  // aligned 64-bit loads are atomic, and a plain load lets every waiter keep
+  // a shared copy of the cache line instead of stealing it with a locked op
+  return *((volatile uint64_t *)ptr);
 }
+
+static void pause_rounds(uint64_t count) {
+  while (count--) {
+    __asm__ __volatile__("pause" : : : "memory");
+  }
+}
+
+/******************
+ * Lock statistics *
+ ******************/
+
+#ifdef ANLOCK_STATS
+
+void anlock_name(anlock_t lock, const char * name) {
+  ticket_lock(&statsLock, (void *)0, (void *)0);
+  anlock_stat_t * stat = stats_class(name);
+  stats_slot_t * slot = stats_slot(lock);
+  if (stat && slot) {
+    slot->stat = stat;
+  } else if (stat) {
+    // claim the first free or forgotten slot in the lock's probe sequence
+    uint64_t i, idx = ((uint64_t)lock >> 3) % STATS_SLOTS;
+    for (i = 0; i < STATS_SLOTS; i++) {
+      slot = &statsSlots[(idx + i) % STATS_SLOTS];
+      if (slot->lock > STATS_TOMBSTONE) continue;
+      slot->stat = stat;
+      slot->holdStart = 0;
+      __sync_synchronize();
+      slot->lock = (uint64_t)lock;
+      break;
+    }
+  }
+  ticket_unlock(&statsLock);
+}
+
+void anlock_forget(anlock_t lock) {
+  ticket_lock(&statsLock, (void *)0, (void *)0);
+  stats_slot_t * slot = stats_slot(lock);
+  if (slot) {
+    slot->lock = STATS_TOMBSTONE;
+    stats_compact(slot - statsSlots);
+  }
+  ticket_unlock(&statsLock);
+}
+
+uint64_t anlock_get_stats(anlock_stat_t * stats, uint64_t max) {
+  ticket_lock(&statsLock, (void *)0, (void *)0);
+  uint64_t used = 0;
+  uint64_t i, j;
+  for (i = 0; i < statsCount; i++) {
+    // insertion sort by spin time, keeping only the top `max` entries
+    anlock_stat_t * stat = &statsClasses[i];
+    for (j = used; j > 0; j--) {
+      if (stats[j - 1].spinCycles >= stat->spinCycles) break;
+      if (j < max) stats[j] = stats[j - 1];
+    }
+    if (j < max) stats[j] = *stat;
+    if (used < max) used++;
+  }
+  ticket_unlock(&statsLock);
+  return used;
+}
+
+static uint64_t stats_time() {
+  uint32_t lower, upper;
+  __asm__ __volatile__("rdtsc" : "=a" (lower), "=d" (upper));
+  return ((uint64_t)upper << 32) | lower;
+}
+
+static void stats_acquired(anlock_t lock,
+                           uint64_t start,
+                           uint8_t contended,
+                           uint8_t exclusive) {
+  stats_slot_t * slot = stats_slot(lock);
+  if (!slot) return;
+  anlock_stat_t * stat = slot->stat;
+  uint64_t now = stats_time();
+  __sync_fetch_and_add(&stat->acquisitions, 1);
+  if (contended) {
+    __sync_fetch_and_add(&stat->contended, 1);
+    __sync_fetch_and_add(&stat->spinCycles, now - start);
+  }
+  if (exclusive) slot->holdStart = now;
+}
+
+static void stats_released(anlock_t lock) {
+  stats_slot_t * slot = stats_slot(lock);
+  if (!slot || !slot->holdStart) return;
+  stats_max(&slot->stat->maxHoldCycles, stats_time() - slot->holdStart);
+}
+
+static stats_slot_t * stats_slot(anlock_t lock) {
+  uint64_t i, idx = ((uint64_t)lock >> 3) % STATS_SLOTS;
+  for (i = 0; i < STATS_SLOTS; i++) {
+    stats_slot_t * slot = &statsSlots[(idx + i) % STATS_SLOTS];
+    if (slot->lock == (uint64_t)lock) return slot;
+    if (!slot->lock) break;
+  }
+  return (stats_slot_t *)0;
+}
+
+static void stats_compact(uint64_t idx) {
+  // no probe sequence goes past an empty slot, so the tombstones right before
+  // one are dead ends and can be emptied too
+  if (statsSlots[(idx + 1) % STATS_SLOTS].lock) return;
+  while (statsSlots[idx].lock == STATS_TOMBSTONE) {
+    statsSlots[idx].lock = 0;
+    idx = (idx + STATS_SLOTS - 1) % STATS_SLOTS;
+  }
+}
+
+static anlock_stat_t * stats_class(const char * name) {
+  uint64_t i;
+  for (i = 0; i < statsCount; i++) {
+    if (stats_name_equal(statsClasses[i].name, name)) {
+      return &statsClasses[i];
+    }
+  }
+  if (statsCount == ANLOCK_STATS_CLASSES) return (anlock_stat_t *)0;
+
+  anlock_stat_t * stat = &statsClasses[statsCount++];
+  for (i = 0; i < ANLOCK_STATS_NAME_LEN - 1 && name[i]; i++) {
+    stat->name[i] = name[i];
+  }
+  stat->name[i] = 0;
+  return stat;
+}
+
+static uint8_t stats_name_equal(const char * name1, const char * name2) {
+  uint64_t i;
+  for (i = 0; i < ANLOCK_STATS_NAME_LEN - 1; i++) {
+    if (name1[i] != name2[i]) return 0;
+    if (!name1[i]) return 1;
+  }
+  return 1;
+}
+
+static void stats_max(uint64_t * ptr, uint64_t value) {
+  uint64_t old = *ptr;
+  while (value > old) {
+    if (__sync_bool_compare_and_swap(ptr, old, value)) return;
+    old = *ptr;
+  }
+}
+
+#else
+
+void anlock_name(anlock_t lock, const char * name) {
+}
+
+void anlock_forget(anlock_t lock) {
+}
+
+uint64_t anlock_get_stats(anlock_stat_t * stats, uint64_t max) {
+  return 0;
+}
+
+#endif
@@ -1,8 +1,111 @@
+#ifndef __ANLOCK_H__
+#define __ANLOCK_H__
+
 #include <stdint.h>
 
 typedef uint64_t * anlock_t;
 
+/**
+ * A waiter spins with `pause` for this many rounds for every thread ahead of
+ * it in a ticket lock before reading the lock again.
+ */
+#define ANLOCK_BACKOFF_UNIT 0x20
+
+/**
+ * The most `pause` rounds a ticket lock waiter will do between reads.
+ */
+#define ANLOCK_BACKOFF_MAX 0x400
+
+typedef struct anlock_node_t anlock_node_t;
+
+/**
+ * The queue entry of one thread waiting for or holding an MCS lock. Each
+ * waiter spins on its own node, so a release only touches the cache line of
+ * the next waiter.
+ */
+struct anlock_node_t {
+  anlock_node_t * volatile next;
+  volatile uint64_t locked;
+};
+
 void anlock_initialize(anlock_t lock);
 void anlock_lock(anlock_t lock);
 void anlock_lock_waiting(anlock_t lock, void * data, void (*fn)(void * d));
 void anlock_unlock(anlock_t lock);
+
+/**
+ * Seize an MCS lock. The lock is a 64-bit value initialized with
+ * anlock_initialize(); it holds the tail of the waiting queue. The node must
+ * stay valid, and must be passed to anlock_mcs_unlock(), until the lock is
+ * released.
+ */
+void anlock_mcs_lock(anlock_t lock, anlock_node_t * node);
+
+/**
+ * Seize an MCS lock only if nobody holds it. Returns 1 on success.
+ */
+uint8_t anlock_mcs_trylock(anlock_t lock, anlock_node_t * node);
+
+/**
+ * Release an MCS lock seized with `node`.
+ */
+void anlock_mcs_unlock(anlock_t lock, anlock_node_t * node);
+
+/**
+ * Seize a reader-writer lock for reading. Any number of readers may hold the
+ * lock at once, but new readers wait while a writer holds or awaits it.
+ * Reader-writer locks are initialized with anlock_initialize(), and may not be
+ * used with the other lock functions.
+ */
+void anlock_read_lock(anlock_t lock);
+
+/**
+ * Release a reader-writer lock seized with anlock_read_lock().
+ */
+void anlock_read_unlock(anlock_t lock);
+
+/**
+ * Seize a reader-writer lock exclusively.
+ */
+void anlock_write_lock(anlock_t lock);
+
+/**
+ * Release a reader-writer lock seized with anlock_write_lock().
+ */
+void anlock_write_unlock(anlock_t lock);
+
+#define ANLOCK_STATS_NAME_LEN 0x20
+#define ANLOCK_STATS_CLASSES 0x40
+
+/**
+ * Contention statistics for all the locks which share a name. Cycle counts
+ * are read from the time stamp counter. Statistics are only gathered when
+ * anlock is built with ANLOCK_STATS defined (`make LOCKSTAT=1`).
+ */
+typedef struct {
+  char name[ANLOCK_STATS_NAME_LEN];
+  uint64_t acquisitions;
+  uint64_t contended;
+  uint64_t spinCycles;
+  uint64_t maxHoldCycles;
+} anlock_stat_t;
+
+/**
+ * Attribute the statistics of a lock to `name`. Locks with the same name are
+ * reported together, so per-object locks may all share one name. Call
+ * anlock_forget() before the lock's memory is reused.
+ */
+void anlock_name(anlock_t lock, const char * name);
+
+/**
+ * Stop gathering statistics for a lock.
+ */
+void anlock_forget(anlock_t lock);
+
+/**
+ * Copy out the statistics of at most `max` names, sorted by the time spent
+ * waiting for them. Returns the number of entries written.
+ */
+uint64_t anlock_get_stats(anlock_stat_t * stats, uint64_t max);
+
+#endif
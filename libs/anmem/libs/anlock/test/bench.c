@@ -0,0 +1,85 @@
+#include <anlock.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+
+typedef struct {
+  int mcs;
+  int threads;
+} bench_t;
+
+static uint64_t lockValue;
+static anlock_t lock = (anlock_t)&lockValue;
+static volatile uint64_t counter;
+static volatile int startFlag;
+static int iterations = 1000;
+
+void * bench_thread(void * ptr);
+double run_bench(int mcs, int threads);
+double current_time();
+
+int main(int argc, const char * argv[]) {
+  int counts[] = {1, 2, 4, 8};
+  int i;
+  if (argc > 1) iterations = atoi(argv[1]);
+  printf("threads   ticket ns/op   mcs ns/op\n");
+  for (i = 0; i < 4; i++) {
+    double ticket = run_bench(0, counts[i]);
+    double mcs = run_bench(1, counts[i]);
+    printf("%7d   %12.1lf   %9.1lf\n", counts[i], ticket, mcs);
+  }
+  return 0;
+}
+
+double run_bench(int mcs, int threads) {
+  pthread_t list[8];
+  bench_t info = {mcs, threads};
+  anlock_initialize(lock);
+  counter = 0;
+  startFlag = 0;
+
+  int i;
+  for (i = 0; i < threads; i++) {
+    pthread_create(&list[i], NULL, bench_thread, &info);
+  }
+  double start = current_time();
+  startFlag = 1;
+  for (i = 0; i < threads; i++) {
+    pthread_join(list[i], NULL);
+  }
+  double duration = current_time() - start;
+
+  if (counter != (uint64_t)threads * iterations) {
+    fprintf(stderr, "lost updates: %llu\n", (unsigned long long)counter);
+    exit(1);
+  }
+  return duration * 1e9 / ((double)threads * iterations);
+}
+
+void * bench_thread(void * ptr) {
+  bench_t * info = (bench_t *)ptr;
+  anlock_node_t node;
+  while (!startFlag);
+
+  int i;
+  for (i = 0; i < iterations; i++) {
+    if (info->mcs) {
+      anlock_mcs_lock(lock, &node);
+      counter++;
+      anlock_mcs_unlock(lock, &node);
+    } else {
+      anlock_lock(lock);
+      counter++;
+      anlock_unlock(lock);
+    }
+  }
+  return NULL;
+}
+
+double current_time() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
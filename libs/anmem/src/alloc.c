@@ -3,6 +3,8 @@
 #include <analloc.h>
 #include <anpages.h>
 
+static void * _alloc_from(anmem_section_t * section);
+
 void * anmem_alloc_aligned(anmem_t * mem, uint64_t len) {
   if (len == 1) return anmem_alloc_page(mem);
   
@@ -48,18 +50,30 @@ void * anmem_alloc_page(anmem_t * mem) {
   uint64_t k, i;
   for (k = 0; k < mem->count; k++) {
     i = mem->count - k - 1;
-    if (mem->allocators[i].type == 0) {
-      anlock_lock(&mem->allocators[i].lock);
-      uint64_t page = anpages_alloc(&mem->allocators[i].anpagesRoot);
-      anlock_unlock(&mem->allocators[i].lock);
-      if (page) return (void *)(page << 12);
-    } else {
-      anlock_lock(&mem->allocators[i].lock);
-      analloc_t alloc = &mem->allocators[i].anallocRoot;
-      uint64_t size = 0x1000;
-      void * buff = analloc_alloc(alloc, &size, 0);
-      anlock_unlock(&mem->allocators[i].lock);
-      if (buff) return buff;
+    void * buff = _alloc_from(&mem->allocators[i]);
+    if (buff) return buff;
+  }
+  return NULL;
+}
+
+void * anmem_alloc_page_node(anmem_t * mem, uint8_t node) {
+  uint64_t hint = mem->count;
+  return anmem_alloc_page_hint(mem, node, &hint);
+}
+
+void * anmem_alloc_page_hint(anmem_t * mem, uint8_t node, uint64_t * hint) {
+  uint64_t k, i = *hint;
+  if (i < mem->count && mem->allocators[i].node == node) {
+    void * buff = _alloc_from(&mem->allocators[i]);
+    if (buff) return buff;
+  }
+  for (k = 0; k < mem->count; k++) {
+    i = mem->count - k - 1;
+    if (i == *hint || mem->allocators[i].node != node) continue;
+    void * buff = _alloc_from(&mem->allocators[i]);
+    if (buff) {
+      *hint = i;
+      return buff;
     }
   }
   return NULL;
@@ -90,3 +104,20 @@ void anmem_free_page(anmem_t * mem, void * buffer) {
     }
   }
 }
+
+static void * _alloc_from(anmem_section_t * section) {
+  if (section->type == 0) {
+    anlock_lock(&section->lock);
+    uint64_t page = anpages_alloc(&section->anpagesRoot);
+    anlock_unlock(&section->lock);
+    if (page) return (void *)(page << 12);
+  } else {
+    anlock_lock(&section->lock);
+    analloc_t alloc = &section->anallocRoot;
+    uint64_t size = 0x1000;
+    void * buff = analloc_alloc(alloc, &size, 0);
+    anlock_unlock(&section->lock);
+    if (buff) return buff;
+  }
+  return NULL;
+}
@@ -13,6 +13,14 @@ static bool _add_allocator(anmem_t * mem,
                            uint64_t len,
                            uint64_t type);
 static uint64_t _sum_regions(anmem_config_t * config);
+static uint64_t _fill_regions(anmem_config_t * config,
+                              anmem_t * mem,
+                              uint64_t pageSkip,
+                              bool create);
+static uint64_t _fill_range(anmem_t * mem,
+                            uint64_t start,
+                            uint64_t end,
+                            bool create);
 static uint64_t _next_analloc(anmem_t * mem, uint64_t start, uint64_t * len);
 static bool _region_is_taken(anmem_t * mem, uint64_t start, uint64_t len);
 
@@ -24,24 +32,13 @@ bool anmem_configure(anmem_config_t * config,
   bool result = _create_controllable(config, mem, maxControllable, pageSkip);
   
   uint64_t allocs = 0;
-  uint64_t sum = _sum_regions(config);
   bool hadToCut = false;
   
   // NOTE: anpages cannot be used on single-page regions.
   
   do {
     // calculate the number of anpages_t we will need
-    uint64_t page = pageSkip;
-    while (page + 1 < sum) {
-      uint64_t len;
-      uint64_t next = _next_analloc(mem, page, &len);
-      if (!(next + 1)) {
-        allocs++;
-        break;
-      }
-      if (next - page > 1) allocs++;
-      page = next + len;
-    }
+    allocs += _fill_regions(config, mem, pageSkip, false);
     
     if (allocs + mem->count > mem->maximum) {
       mem->count--;
@@ -50,23 +47,7 @@ bool anmem_configure(anmem_config_t * config,
   } while (allocs + mem->count > mem->maximum);
   
   // go through and create the allocators
-  uint64_t startPage = pageSkip;
-  
-  while (startPage + 1 < sum) {
-    uint64_t len;
-    uint64_t next = _next_analloc(mem, startPage, &len);
-    if (!(next + 1)) {
-      // fill up the rest of the memory
-      _add_allocator(mem, startPage, sum - startPage, 0);
-      break;
-    }
-    
-    if (next - startPage > 1) {
-      _add_allocator(mem, startPage, next - startPage, 0);
-    }
-    
-    startPage = next + len;
-  }
+  _fill_regions(config, mem, pageSkip, true);
   
   return result && !hadToCut;
 }
@@ -121,7 +102,8 @@ static bool _create_controllable(anmem_config_t * config,
       structs += config->structSize;
       
       // calculate the available bounds
-      uint64_t lowerBound = curPage, upperBound = curPage + fullSize;
+      uint64_t virtPage = config->directMapped ? physPage : curPage;
+      uint64_t lowerBound = virtPage, upperBound = virtPage + fullSize;
 #ifndef IGNORE_4GB_RULE
       if (upperBound + (physPage - lowerBound) > 0x100000) {
         upperBound = 0x100000 + (lowerBound - physPage);
@@ -186,6 +168,7 @@ static bool _add_allocator(anmem_t * mem,
   mem->allocators[mem->count].start = start;
   mem->allocators[mem->count].len = len;
   mem->allocators[mem->count].lock = 0;
+  mem->allocators[mem->count].node = 0;
   mem->count++;
   return true;
 }
@@ -202,6 +185,53 @@ static uint64_t _sum_regions(anmem_config_t * config) {
   return curPage;
 }
 
+static uint64_t _fill_regions(anmem_config_t * config,
+                              anmem_t * mem,
+                              uint64_t pageSkip,
+                              bool create) {
+  if (!config->directMapped) {
+    return _fill_range(mem, pageSkip, _sum_regions(config), create);
+  }
+  
+  // each region is its own island in virtual memory
+  uint64_t i, count = 0;
+  void * structs = config->structs;
+  for (i = 0; i < config->structCount; i++) {
+    uint64_t fullSize = *((uint64_t *)(structs + config->sizeOffset));
+    uint64_t physPage = *((uint64_t *)(structs + config->physPageOffset));
+    structs += config->structSize;
+    
+    uint64_t start = physPage < pageSkip ? pageSkip : physPage;
+    count += _fill_range(mem, start, physPage + fullSize, create);
+  }
+  return count;
+}
+
+static uint64_t _fill_range(anmem_t * mem,
+                            uint64_t start,
+                            uint64_t end,
+                            bool create) {
+  uint64_t count = 0;
+  while (start + 1 < end) {
+    uint64_t len = 0;
+    uint64_t next = _next_analloc(mem, start, &len);
+    if (!(next + 1) || next >= end) {
+      // fill up the rest of the range
+      if (create) _add_allocator(mem, start, end - start, 0);
+      count++;
+      break;
+    }
+    
+    if (next - start > 1) {
+      if (create) _add_allocator(mem, start, next - start, 0);
+      count++;
+    }
+    
+    start = next + len;
+  }
+  return count;
+}
+
 static uint64_t _next_analloc(anmem_t * mem, uint64_t start, uint64_t * len) {
   uint64_t i, firstPlace = 0xffffffffffffffffL;
   for (i = 0; i < mem->count; i++) {
@@ -12,12 +12,16 @@ void test_initialize();
 void test_alloc_pages();
 void test_alloc_aligned();
 void test_alloc_pages_overflow();
+void test_alloc_pages_node();
+void test_alloc_pages_hint();
 
 int main() {
   test_initialize();
   test_alloc_pages();
   test_alloc_aligned();
   test_alloc_pages_overflow();
+  test_alloc_pages_node();
+  test_alloc_pages_hint();
   return 0;
 }
 
@@ -36,6 +40,7 @@ void test_initialize() {
   config.physPageOffset = 8;
   config.structSize = 0x10;
   config.structCount = 3;
+  config.directMapped = false;
   
   mem.allocators = sections;
   mem.maximum = 3;
@@ -142,3 +147,53 @@ void test_alloc_pages_overflow() {
   
   printf(" passed!\n");
 }
+
+void test_alloc_pages_node() {
+  printf("testing anmem_alloc_page_node()...");
+  
+  uint64_t firstPage = ((uint64_t)buffer) >> 12;
+  
+  // put the top allocator on its own node and free a page from it and from
+  // the bottom allocator
+  sections[2].node = 1;
+  anmem_free_page(&mem, (void *)((firstPage + 0x1f) << 12));
+  anmem_free_page(&mem, (void *)((firstPage + 1) << 12));
+  
+  void * page = anmem_alloc_page_node(&mem, 1);
+  assert(page == (void *)((firstPage + 0x1f) << 12));
+  assert(anmem_alloc_page_node(&mem, 1) == NULL);
+  
+  page = anmem_alloc_page_node(&mem, 0);
+  assert(page == (void *)((firstPage + 1) << 12));
+  assert(anmem_alloc_page_node(&mem, 0) == NULL);
+  
+  printf(" passed!\n");
+}
+
+void test_alloc_pages_hint() {
+  printf("testing anmem_alloc_page_hint()...");
+  
+  uint64_t firstPage = ((uint64_t)buffer) >> 12;
+  
+  // both node 0 allocators have a free page; the hint picks the anpages one
+  anmem_free_page(&mem, (void *)((firstPage + 1) << 12));
+  anmem_free_page(&mem, (void *)((firstPage + 0xb) << 12));
+  uint64_t hint = 1;
+  void * page = anmem_alloc_page_hint(&mem, 0, &hint);
+  assert(page == (void *)((firstPage + 1) << 12));
+  assert(hint == 1);
+  
+  // an empty hinted allocator falls back and updates the hint
+  page = anmem_alloc_page_hint(&mem, 0, &hint);
+  assert(page == (void *)((firstPage + 0xb) << 12));
+  assert(hint == 0);
+  
+  // a hint on another node is ignored
+  anmem_free_page(&mem, (void *)((firstPage + 0x1f) << 12));
+  page = anmem_alloc_page_hint(&mem, 1, &hint);
+  assert(page == (void *)((firstPage + 0x1f) << 12));
+  assert(hint == 2);
+  assert(anmem_alloc_page_hint(&mem, 1, &hint) == NULL);
+  
+  printf(" passed!\n");
+}
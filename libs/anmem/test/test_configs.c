@@ -7,6 +7,7 @@ void test_fragmented_enough();
 void test_forced_align();
 void test_alloc_overflow();
 void test_physical_alignment();
+void test_direct_mapped();
 
 int main() {
   test_high_only();
@@ -14,6 +15,7 @@ int main() {
   test_forced_align();
   test_alloc_overflow();
   test_physical_alignment();
+  test_direct_mapped();
   return 0;
 }
 
@@ -30,6 +32,7 @@ void test_high_only() {
   config.physPageOffset = 8;
   config.structSize = 0x10;
   config.structCount = 3;
+  config.directMapped = false;
   
   anmem_t mem;
   mem.allocators = sections;
@@ -66,6 +69,7 @@ void test_fragmented_enough() {
   config.physPageOffset = 8;
   config.structSize = 0x10;
   config.structCount = 5;
+  config.directMapped = false;
   
   anmem_t mem;
   mem.allocators = sections;
@@ -113,6 +117,7 @@ void test_forced_align() {
   config.physPageOffset = 8;
   config.structSize = 0x10;
   config.structCount = 3;
+  config.directMapped = false;
   
   anmem_t mem;
   mem.allocators = sections;
@@ -166,6 +171,7 @@ void test_alloc_overflow() {
   config.physPageOffset = 8;
   config.structSize = 0x10;
   config.structCount = 3;
+  config.directMapped = false;
   
   anmem_t mem;
   mem.allocators = sections;
@@ -217,6 +223,7 @@ void test_physical_alignment() {
   config.physPageOffset = 8;
   config.structSize = 0x10;
   config.structCount = 4;
+  config.directMapped = false;
   
   anmem_t mem;
   mem.allocators = sections;
@@ -254,3 +261,54 @@ void test_physical_alignment() {
   
   printf(" passed!\n");
 }
+
+void test_direct_mapped() {
+  printf("testing direct mapped regions...");
+  
+  uint64_t regions[] = {
+    0x10, 0,
+    // 0x30 page physical gap
+    0x40, 0x40,
+    // 0x80 page physical gap
+    0x82, 0x100
+  };
+  
+  anmem_section_t sections[5];
+  
+  anmem_config_t config;
+  config.structs = regions;
+  config.sizeOffset = 0;
+  config.physPageOffset = 8;
+  config.structSize = 0x10;
+  config.structCount = 3;
+  config.directMapped = true;
+  
+  anmem_t mem;
+  mem.allocators = sections;
+  mem.count = 0;
+  mem.maximum = 5;
+  
+  bool result = anmem_configure(&config, &mem, 7, 0);
+  assert(result);
+  assert(mem.count == 4);
+  
+  // one 0x80 analloc at the start of the third region
+  assert(mem.allocators[0].type == 1);
+  assert(mem.allocators[0].start == 0x100);
+  assert(mem.allocators[0].len == 0x80);
+  
+  // the rest of each region is anpages, never spanning a gap
+  assert(mem.allocators[1].type == 0);
+  assert(mem.allocators[1].start == 0);
+  assert(mem.allocators[1].len == 0x10);
+  
+  assert(mem.allocators[2].type == 0);
+  assert(mem.allocators[2].start == 0x40);
+  assert(mem.allocators[2].len == 0x40);
+  
+  assert(mem.allocators[3].type == 0);
+  assert(mem.allocators[3].start == 0x180);
+  assert(mem.allocators[3].len == 0x2);
+  
+  printf(" passed!\n");
+}
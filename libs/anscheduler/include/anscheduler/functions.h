@@ -12,6 +12,8 @@
 #define ANSCHEDULER_PAGE_FLAG_PRESENT 1
 #define ANSCHEDULER_PAGE_FLAG_WRITE 2
 #define ANSCHEDULER_PAGE_FLAG_USER 4
+#define ANSCHEDULER_PAGE_FLAG_ACCESSED 0x20
+#define ANSCHEDULER_PAGE_FLAG_DIRTY 0x40
 #define ANSCHEDULER_PAGE_FLAG_GLOBAL 0x100
 #define ANSCHEDULER_PAGE_FLAG_UNALLOC 0x200
 #define ANSCHEDULER_PAGE_FLAG_SWAPPED 0x400
@@ -47,6 +49,46 @@ void anscheduler_lock(uint64_t * ptr);
  */
 void anscheduler_unlock(uint64_t * ptr);
 
+/**
+ * Seizes a 64-bit reader-writer lock for reading. Reader-writer locks are
+ * initialized to 0 and may only be used with the read and write functions.
+ * A CPU must not take the same lock for reading twice, since a writer which
+ * arrives in between would wait on the first hold forever.
+ * @critical
+ */
+void anscheduler_read_lock(uint64_t * ptr);
+
+/**
+ * Unlocks something locked with anscheduler_read_lock()
+ * @critical
+ */
+void anscheduler_read_unlock(uint64_t * ptr);
+
+/**
+ * Seizes a 64-bit reader-writer lock exclusively.
+ * @critical
+ */
+void anscheduler_write_lock(uint64_t * ptr);
+
+/**
+ * Unlocks something locked with anscheduler_write_lock()
+ * @critical
+ */
+void anscheduler_write_unlock(uint64_t * ptr);
+
+/**
+ * Names a lock for lock statistics. Locks which share a name are reported
+ * together. Platforms which keep no lock statistics may ignore this.
+ * @critical
+ */
+void anscheduler_lock_name(uint64_t * ptr, const char * name);
+
+/**
+ * Forgets a lock named with anscheduler_lock_name() before it is freed.
+ * @critical
+ */
+void anscheduler_lock_forget(uint64_t * ptr);
+
 /**
  * Terminates application or kernel flow.
  * @critical
@@ -183,6 +225,16 @@ void anscheduler_cpu_set_thread(thread_t * thread);
  */
 void anscheduler_cpu_notify_invlpg(task_t * task);
 
+/**
+ * Like anscheduler_cpu_notify_invlpg(), but only `count` pages starting at
+ * the virtual page `start` were modified. This also flushes any changes which
+ * the platform has queued up for the task.
+ * @critical
+ */
+void anscheduler_cpu_notify_invlpg_range(task_t * task,
+                                         uint64_t start,
+                                         uint64_t count);
+
 /**
  * Notify every CPU running a task to switch tasks. This may be as simple as
  * triggering an early timer tick on every CPU running the task.
@@ -226,7 +278,7 @@ void * anscheduler_vm_root_alloc();
 /**
  * Map a virtual page to a physical page and set flags on the page.
  * @return false if the operation failed (i.e. a page table could not be
- * allocated).
+ * allocated, or the physical page is out of range).
  * @critical
  */
 bool anscheduler_vm_map(void * root,
@@ -240,6 +292,20 @@ bool anscheduler_vm_map(void * root,
  */
 void anscheduler_vm_unmap(void * root, uint64_t vpage);
 
+/**
+ * Unmap `count` virtual pages starting at `vpage`. For every entry that was
+ * mapped, `fn` is called (if non-NULL) with the entry's page and flags before
+ * it is removed. Page tables which become empty are freed.
+ * @critical
+ */
+void anscheduler_vm_unmap_range(void * root,
+                                uint64_t vpage,
+                                uint64_t count,
+                                void * data,
+                                void (* fn)(void * data,
+                                            uint64_t page,
+                                            uint16_t flags));
+
 /**
  * Lookup the physical entry and flags for a given virtual page. If the page
  * is not mapped, 0 should be returned along with 0 flags.
@@ -278,5 +344,13 @@ void anscheduler_vm_root_free_async(void * root);
  */
 void anscheduler_task_cleanup(task_t * task);
 
+/**
+ * Called before a thread is deallocated. The thread is not running, and it
+ * will never run again. If you keep no references to threads outside of
+ * anscheduler's structures, you need not do anything in this implementation.
+ * @critical
+ */
+void anscheduler_thread_cleanup(thread_t * thread);
+
 #endif
 
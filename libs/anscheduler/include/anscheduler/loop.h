@@ -3,6 +3,9 @@
 
 #include "types.h"
 
+// thread priorities run from 0 to ANSCHEDULER_PRIORITY_LEVELS - 1
+#define ANSCHEDULER_PRIORITY_LEVELS 0x11
+
 /**
  * Pushes the current thread back to the run loop for another time. This must
  * be called before running anscheduler_loop_run() function. However,
@@ -16,6 +19,11 @@
  */
 void anscheduler_loop_push_cur();
 
+/**
+ * Names the run loop's lock for lock statistics.
+ */
+void anscheduler_loop_name_locks();
+
 /**
  * Removes a thread from the run loop if it is in the queue at all.
  * @param thread The thread which has been killed.
@@ -27,6 +35,17 @@ void anscheduler_loop_delete(thread_t * thread);
  */
 void anscheduler_loop_push(thread_t * newThread);
 
+/**
+ * Sets the effective priority of a thread, moving it to the queue of its new
+ * level if it is queued. Each level is a FIFO queue. The loop runs the level
+ * with the highest priority plus age, where a level ages by one every time it
+ * has threads queued and another level is picked, so a busy raised thread
+ * cannot starve the levels below it. Priorities above the top level are
+ * clamped.
+ * @critical
+ */
+void anscheduler_loop_set_priority(thread_t * thread, uint8_t priority);
+
 /**
  * Enters the scheduling loop.  This function should never return.  By this
  * point, you should be on the CPU dedicated stack.  Calling this function
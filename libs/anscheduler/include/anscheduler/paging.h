@@ -8,6 +8,19 @@
 #define ANSCHEDULER_PAGE_FAULT_USER 4
 #define ANSCHEDULER_PAGE_FAULT_INSTRUCTION 0x10
 
+/**
+ * When a thread faults on an unallocated stack page, this many of the pages
+ * below it are allocated as well. The window grows toward the maximum as the
+ * stack keeps growing one page at a time. Define these in
+ * anscheduler_structs.h to override them.
+ */
+#ifndef ANSCHEDULER_STACK_FAULT_AROUND_MIN
+#define ANSCHEDULER_STACK_FAULT_AROUND_MIN 1
+#endif
+#ifndef ANSCHEDULER_STACK_FAULT_AROUND_MAX
+#define ANSCHEDULER_STACK_FAULT_AROUND_MAX 8
+#endif
+
 /**
  * Call this whenever a page fault or platform-equivalent interrupt occurs.
  *
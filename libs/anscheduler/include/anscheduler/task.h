@@ -15,6 +15,12 @@
 
 task_t * anscheduler_task_create();
 
+/**
+ * Names the global task locks for lock statistics. Each task's own locks are
+ * named when it is created.
+ */
+void anscheduler_task_name_locks();
+
 /**
  * Adds a task's to the scheduling queue.
  * @param task A reference is not needed here since the task is presumed not
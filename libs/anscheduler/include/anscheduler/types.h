@@ -68,7 +68,9 @@ struct thread_t {
   uint64_t stack;
   
   bool isPolling; // 1 if waiting for a message (or an interrupt)
-  char reserved[7]; // for alignment
+  uint8_t basePriority; // the priority the thread asked for
+  uint8_t priority; // basePriority, possibly raised by priority inheritance
+  char reserved[5]; // for alignment
     
   anscheduler_state state;
 } __attribute__((packed));
@@ -1,12 +1,17 @@
 #include "anidxset.h"
 
 static void _allocate_next_page(anidxset_root_t * root);
+static uint64_t _bitmap_get(anidxset_root_t * root);
+static uint8_t _bitmap_put(anidxset_root_t * root, uint64_t value);
+static void _bitmap_free(anidxset_root_t * root);
 
 uint8_t anidxset_initialize(anidxset_root_t * root,
                             anidxset_alloc_t alloc,
                             anidxset_free_t free) {
   root->alloc = alloc;
   root->free = free;
+  root->bitmap = 0;
+  root->top = 0;
   root->used = ANIDXSET_NODE_CAPACITY;
   root->first = root->alloc();
   if (!root->first) return 0;
@@ -20,7 +25,28 @@ uint8_t anidxset_initialize(anidxset_root_t * root,
   return 1;
 }
 
+uint8_t anidxset_initialize_bitmap(anidxset_root_t * root,
+                                   anidxset_alloc_t alloc,
+                                   anidxset_free_t free) {
+  root->alloc = alloc;
+  root->free = free;
+  root->used = 0;
+  root->first = 0;
+  root->top = 0;
+  root->bitmap = root->alloc();
+  if (!root->bitmap) return 0;
+  int i;
+  for (i = 0; i < 0x40; i++) {
+    root->bitmap->summary[i] = 0;
+  }
+  for (i = 0; i < ANIDXSET_BITMAP_LEAVES; i++) {
+    root->bitmap->leaves[i] = 0;
+  }
+  return 1;
+}
+
 uint64_t anidxset_get(anidxset_root_t * root) {
+  if (root->bitmap) return _bitmap_get(root);
   anidxset_node_t * node = (anidxset_node_t *)root->first;
   if (!node->count) {
     if (!node->next) {
@@ -36,6 +62,7 @@ uint64_t anidxset_get(anidxset_root_t * root) {
 }
 
 uint8_t anidxset_put(anidxset_root_t * root, uint64_t value) {
+  if (root->bitmap) return _bitmap_put(root, value);
   anidxset_node_t * node = root->first;
   // if this node is full, we will allocate a new node
   if (node->count == ANIDXSET_NODE_CAPACITY) {
@@ -52,6 +79,7 @@ uint8_t anidxset_put(anidxset_root_t * root, uint64_t value) {
 }
 
 void anidxset_free(anidxset_root_t * root) {
+  if (root->bitmap) return _bitmap_free(root);
   anidxset_node_t * node = root->first;
   while (node) {
     anidxset_node_t * next = (anidxset_node_t *)node->next;
@@ -71,3 +99,51 @@ static void _allocate_next_page(anidxset_root_t * root) {
   }
 }
 
+static uint64_t _bitmap_get(anidxset_root_t * root) {
+  if (!~root->top) return ANIDXSET_INVALID;
+  anidxset_bitmap_t * bitmap = root->bitmap;
+
+  uint64_t i = __builtin_ctzll(~root->top);
+  uint64_t j = __builtin_ctzll(~bitmap->summary[i]);
+  uint64_t wordIndex = (i << 6) | j;
+
+  uint64_t * leaf = bitmap->leaves[wordIndex >> 9];
+  if (!leaf) {
+    if (!(leaf = root->alloc())) return ANIDXSET_INVALID;
+    int k;
+    for (k = 0; k < 0x200; k++) leaf[k] = 0;
+    bitmap->leaves[wordIndex >> 9] = leaf;
+  }
+
+  uint64_t * word = &leaf[wordIndex & 0x1ff];
+  uint64_t bit = __builtin_ctzll(~(*word));
+  (*word) |= 1UL << bit;
+  if (!~(*word)) {
+    bitmap->summary[i] |= 1UL << j;
+    if (!~bitmap->summary[i]) root->top |= 1UL << i;
+  }
+  return (wordIndex << 6) | bit;
+}
+
+static uint8_t _bitmap_put(anidxset_root_t * root, uint64_t value) {
+  if (value >= ANIDXSET_BITMAP_CAPACITY) return 0;
+  anidxset_bitmap_t * bitmap = root->bitmap;
+
+  uint64_t wordIndex = value >> 6;
+  uint64_t * leaf = bitmap->leaves[wordIndex >> 9];
+  if (!leaf) return 0;
+
+  uint64_t i = wordIndex >> 6;
+  leaf[wordIndex & 0x1ff] &= ~(1UL << (value & 0x3f));
+  bitmap->summary[i] &= ~(1UL << (wordIndex & 0x3f));
+  root->top &= ~(1UL << i);
+  return 1;
+}
+
+static void _bitmap_free(anidxset_root_t * root) {
+  int i;
+  for (i = 0; i < ANIDXSET_BITMAP_LEAVES; i++) {
+    if (root->bitmap->leaves[i]) root->free(root->bitmap->leaves[i]);
+  }
+  root->free(root->bitmap);
+}
@@ -4,12 +4,21 @@
 
 static uint64_t loopLock __attribute__((aligned(8))) = 0;
 static uint64_t queueCount __attribute__((aligned(8))) = 0;
-static thread_t * firstThread __attribute__((aligned(8))) = NULL;
-static thread_t * lastThread __attribute__((aligned(8))) = NULL;
+
+// one FIFO queue per priority level, and a bit for each non-empty queue
+static thread_t * firstThreads[ANSCHEDULER_PRIORITY_LEVELS];
+static thread_t * lastThreads[ANSCHEDULER_PRIORITY_LEVELS];
+static uint32_t queuedLevels = 0;
+
+// how many picks each non-empty level has been passed over for
+static uint64_t levelAges[ANSCHEDULER_PRIORITY_LEVELS];
 
 static thread_t * _next_thread(uint64_t * timeout);
-static thread_t * _shift_thread();
-static void _push_unconditional(thread_t * thread);
+static int _oldest_level(uint32_t levels);
+static thread_t * _first_runnable(int level, uint64_t now, uint64_t * timeout);
+static bool _is_queued(thread_t * thread);
+static void _append_thread(thread_t * thread);
+static void _unlink_thread(thread_t * thread);
 static void _delete_cur_kernel(void * unused);
 static void _switch_to_thread(thread_t * thread);
 static void _run_loop_stub(void * unused);
@@ -28,35 +37,38 @@ void anscheduler_loop_push_cur() {
   if (task) anscheduler_task_dereference(task);
 }
 
+void anscheduler_loop_name_locks() {
+  anscheduler_lock_name(&loopLock, "loopLock");
+}
+
 void anscheduler_loop_delete(thread_t * thread) {
   anscheduler_lock(&loopLock);
   
   // see if it is really in the list at all
-  if (!thread->queueNext && !thread->queueLast) {
-    if (thread != firstThread) {
-      anscheduler_unlock(&loopLock);
-      return;
-    }
+  if (!_is_queued(thread)) {
+    anscheduler_unlock(&loopLock);
+    return;
   }
   
-  // if it is first and/or last in the list...
-  if (firstThread == thread) {
-    firstThread = thread->queueNext;
-  }
-  if (lastThread == thread) {
-    lastThread = thread->queueLast;
-  }
+  _unlink_thread(thread);
+  queueCount--;
   
-  // normal doubly-linked-list removal
-  if (thread->queueLast) {
-    thread->queueLast->queueNext = thread->queueNext;
+  anscheduler_unlock(&loopLock);
+}
+
+void anscheduler_loop_set_priority(thread_t * thread, uint8_t priority) {
+  if (priority >= ANSCHEDULER_PRIORITY_LEVELS) {
+    priority = ANSCHEDULER_PRIORITY_LEVELS - 1;
   }
-  if (thread->queueNext) {
-    thread->queueNext->queueLast = thread->queueLast;
+  anscheduler_lock(&loopLock);
+  if (_is_queued(thread)) {
+    // move it to the back of its new level's queue
+    _unlink_thread(thread);
+    thread->priority = priority;
+    _append_thread(thread);
+  } else {
+    thread->priority = priority;
   }
-  
-  queueCount--;
-  
   anscheduler_unlock(&loopLock);
 }
 
@@ -72,15 +84,7 @@ void anscheduler_loop_push(thread_t * thread) {
   }
   
   anscheduler_lock(&loopLock);
-  if (lastThread) {
-    lastThread->queueNext = thread;
-    thread->queueLast = lastThread;
-    thread->queueNext = NULL;
-    lastThread = thread;
-  } else {
-    firstThread = (lastThread = thread);
-    thread->queueNext = (thread->queueLast = NULL);
-  }
+  _append_thread(thread);
   queueCount++;
   anscheduler_unlock(&loopLock);
 }
@@ -147,54 +151,103 @@ void anscheduler_loop_switch(task_t * task, thread_t * thread) {
 
 static thread_t * _next_thread(uint64_t * timeout) {
   anscheduler_lock(&loopLock);
-  uint64_t i, max = queueCount;
   uint64_t now = anscheduler_get_time();
   (*timeout) = (anscheduler_second_length() >> 6);
-  for (i = 0; i < max; i++) {
-    thread_t * th = _shift_thread();
-    
-    uint64_t nextTs = th->nextTimestamp;
-    if (nextTs > now) {
-      _push_unconditional(th);
-      if (nextTs - now < *timeout) {
-        (*timeout) = nextTs - now;
-      }
-      continue;
+  while (1) {
+    // try the levels in order of priority plus age until one has a thread
+    // which is not sleeping
+    thread_t * best = NULL;
+    uint32_t untried = queuedLevels;
+    while (untried && !best) {
+      int level = _oldest_level(untried);
+      untried &= ~(1 << level);
+      best = _first_runnable(level, now, timeout);
+      // a level with nothing to run was not being starved
+      levelAges[level] = 0;
+    }
+    if (!best) break;
+
+    int i;
+    for (i = 0; i < ANSCHEDULER_PRIORITY_LEVELS; i++) {
+      if ((queuedLevels & (1 << i)) && i != best->priority) levelAges[i]++;
     }
     
+    _unlink_thread(best);
     queueCount--;
-    if (th->task) {
-      if (!anscheduler_task_reference(th->task)) {
+    if (best->task) {
+      if (!anscheduler_task_reference(best->task)) {
         continue;
       }
     }
     anscheduler_unlock(&loopLock);
-    return th;
+    return best;
   }
   
   anscheduler_unlock(&loopLock);
   return NULL;
 }
 
-static thread_t * _shift_thread() {
-  thread_t * th = firstThread;
-  firstThread = th->queueNext;
-  if (!firstThread) lastThread = NULL;
-  else firstThread->queueLast = NULL;
-  th->queueNext = (th->queueLast = NULL);
-  return th;
+static int _oldest_level(uint32_t levels) {
+  // ties go to the higher level, so without aging this is strict priority
+  int best = -1;
+  int i;
+  for (i = ANSCHEDULER_PRIORITY_LEVELS - 1; i >= 0; i--) {
+    if (!(levels & (1 << i))) continue;
+    if (best < 0 || i + levelAges[i] > best + levelAges[best]) best = i;
+  }
+  return best;
+}
+
+static thread_t * _first_runnable(int level, uint64_t now, uint64_t * timeout) {
+  thread_t * th;
+  for (th = firstThreads[level]; th; th = th->queueNext) {
+    uint64_t nextTs = th->nextTimestamp;
+    if (nextTs <= now) return th;
+    if (nextTs - now < *timeout) {
+      (*timeout) = nextTs - now;
+    }
+  }
+  return NULL;
+}
+
+static bool _is_queued(thread_t * thread) {
+  if (thread->queueNext || thread->queueLast) return true;
+  return firstThreads[thread->priority] == thread;
 }
 
-static void _push_unconditional(thread_t * thread) {
-  if (lastThread) {
-    lastThread->queueNext = thread;
-    thread->queueLast = lastThread;
-    thread->queueNext = NULL;
-    lastThread = thread;
+static void _append_thread(thread_t * thread) {
+  uint8_t level = thread->priority;
+  thread_t * last = lastThreads[level];
+  thread->queueNext = NULL;
+  thread->queueLast = last;
+  if (last) {
+    last->queueNext = thread;
   } else {
-    lastThread = (firstThread = thread);
-    thread->queueNext = (thread->queueLast = NULL);
+    firstThreads[level] = thread;
+    queuedLevels |= 1 << level;
+  }
+  lastThreads[level] = thread;
+}
+
+static void _unlink_thread(thread_t * thread) {
+  uint8_t level = thread->priority;
+  // if it is first and/or last in the list...
+  if (firstThreads[level] == thread) {
+    firstThreads[level] = thread->queueNext;
+    if (!thread->queueNext) queuedLevels &= ~(1 << level);
+  }
+  if (lastThreads[level] == thread) {
+    lastThreads[level] = thread->queueLast;
+  }
+  
+  // normal doubly-linked-list removal
+  if (thread->queueLast) {
+    thread->queueLast->queueNext = thread->queueNext;
+  }
+  if (thread->queueNext) {
+    thread->queueNext->queueLast = thread->queueLast;
   }
+  thread->queueNext = (thread->queueLast = NULL);
 }
 
 static void _delete_cur_kernel(void * unused) {
@@ -15,6 +15,11 @@ typedef struct {
 
 static void _push_page_fault(fault_info_t * _info);
 static bool _push_page_fault_cont(fault_info_t info);
+static uint64_t _stack_fault_window(task_t * task, uint64_t faultPage);
+static uint64_t _stack_fault_around(task_t * task,
+                                    uint64_t faultPage,
+                                    void ** buffers,
+                                    uint64_t count);
 
 void anscheduler_page_fault(void * ptr, uint64_t _flags) {
   task_t * task = anscheduler_cpu_get_task();
@@ -29,12 +34,24 @@ void anscheduler_page_fault(void * ptr, uint64_t _flags) {
     anscheduler_cpu_stack_run(&info, (void (*)(void *))_push_page_fault);
   }
   
-  anscheduler_lock(&task->vmLock);
+  // allocate and zero the pages before taking the vmLock so the other threads
+  // of this task aren't kept waiting; whatever goes unused is freed at the end
+  uint64_t faultPage = ((uint64_t)ptr) >> 12;
+  void * buffers[ANSCHEDULER_STACK_FAULT_AROUND_MAX + 1];
+  uint64_t count = _stack_fault_window(task, faultPage) + 1;
+  uint64_t used = 0, i;
+  for (i = 0; i < count; i++) {
+    buffers[i] = anscheduler_alloc(0x1000);
+    if (!buffers[i]) break;
+    anscheduler_zero(buffers[i], 0x1000);
+  }
+  count = i;
+  
+  anscheduler_write_lock(&task->vmLock);
   bool shouldAllocate = false; // overrides shouldFault
   bool shouldFault = true; // if false, try again!
   
   uint16_t flags;
-  uint64_t faultPage = ((uint64_t)ptr) >> 12;
   uint64_t entry = anscheduler_vm_lookup(task->vm, faultPage, &flags);
   if ((flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) && !entry) {
     shouldAllocate = true;
@@ -53,19 +70,23 @@ void anscheduler_page_fault(void * ptr, uint64_t _flags) {
   }
   
   if (shouldAllocate) {
+    // with no memory to spare, the thread simply faults again later
     flags = ANSCHEDULER_PAGE_FLAG_USER
       | ANSCHEDULER_PAGE_FLAG_PRESENT
       | ANSCHEDULER_PAGE_FLAG_WRITE;
-    void * ptr = anscheduler_alloc(0x1000);
-    anscheduler_zero(ptr, 0x1000);
-    uint64_t physAlloc = anscheduler_vm_physical(((uint64_t)ptr) >> 12);
-    anscheduler_vm_map(task->vm, faultPage, physAlloc, flags);
+    uint64_t physAlloc = count
+      ? anscheduler_vm_physical(((uint64_t)buffers[0]) >> 12) : 0;
+    if (count && anscheduler_vm_map(task->vm, faultPage, physAlloc, flags)) {
+      used = 1 + _stack_fault_around(task, faultPage, buffers + 1, count - 1);
+    }
   } else if (shouldFault) {
-    anscheduler_unlock(&task->vmLock);
+    anscheduler_write_unlock(&task->vmLock);
+    for (i = 0; i < count; i++) anscheduler_free(buffers[i]);
     anscheduler_cpu_stack_run(&info, (void (*)(void *))_push_page_fault);
   }
   
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_write_unlock(&task->vmLock);
+  for (i = used; i < count; i++) anscheduler_free(buffers[i]);
   anscheduler_thread_run(task, anscheduler_cpu_get_thread());
 }
 
@@ -118,6 +139,53 @@ static void _push_page_fault(fault_info_t * _info) {
   anscheduler_loop_run();
 }
 
+static uint64_t _stack_fault_window(task_t * task, uint64_t faultPage) {
+  if (faultPage < ANSCHEDULER_TASK_USER_STACKS_PAGE) return 0;
+  if (faultPage >= ANSCHEDULER_TASK_DATA_PAGE) return 0;
+  
+  // never spill into the stack of the thread below this one
+  uint64_t below = (faultPage - ANSCHEDULER_TASK_USER_STACKS_PAGE) & 0xff;
+  uint64_t regionEnd = faultPage - below + 0x100;
+  
+  // the more of the stack that is already in use, the deeper it is growing
+  uint64_t window = 0;
+  anscheduler_read_lock(&task->vmLock);
+  while (window < ANSCHEDULER_STACK_FAULT_AROUND_MAX) {
+    uint64_t page = faultPage + window + 1;
+    if (page >= regionEnd) break;
+    uint16_t flags;
+    anscheduler_vm_lookup(task->vm, page, &flags);
+    if (!(flags & ANSCHEDULER_PAGE_FLAG_PRESENT)) break;
+    window++;
+  }
+  anscheduler_read_unlock(&task->vmLock);
+  if (window < ANSCHEDULER_STACK_FAULT_AROUND_MIN) {
+    window = ANSCHEDULER_STACK_FAULT_AROUND_MIN;
+  }
+  return window < below ? window : below;
+}
+
+static uint64_t _stack_fault_around(task_t * task,
+                                    uint64_t faultPage,
+                                    void ** buffers,
+                                    uint64_t count) {
+  // other threads may have mapped some of these since the window was sized
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    uint64_t page = faultPage - i - 1;
+    uint16_t flags;
+    uint64_t entry = anscheduler_vm_lookup(task->vm, page, &flags);
+    if (!(flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) || entry) break;
+    
+    uint64_t physAlloc = anscheduler_vm_physical(((uint64_t)buffers[i]) >> 12);
+    flags = ANSCHEDULER_PAGE_FLAG_USER
+      | ANSCHEDULER_PAGE_FLAG_PRESENT
+      | ANSCHEDULER_PAGE_FLAG_WRITE;
+    if (!anscheduler_vm_map(task->vm, page, physAlloc, flags)) break;
+  }
+  return i;
+}
+
 static bool _push_page_fault_cont(fault_info_t info) {
   if (!pagerThread) return false;
   
@@ -12,6 +12,11 @@ static bool ppInitialized __attribute__((aligned(8))) = 0;
 
 static uint8_t _hash_pid(uint64_t pid);
 
+void anscheduler_pidmap_name_locks() {
+  anscheduler_lock_name(&pmLock, "pmLock");
+  anscheduler_lock_name(&ppLock, "ppLock");
+}
+
 uint64_t anscheduler_pidmap_alloc_pid() {
   anscheduler_lock(&ppLock);
   if (!ppInitialized) {
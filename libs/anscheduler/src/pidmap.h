@@ -3,6 +3,11 @@
 
 #include <anscheduler/types.h>
 
+/**
+ * Names the PID map's locks for lock statistics.
+ */
+void anscheduler_pidmap_name_locks();
+
 /**
  * @critical O(1)
  */
@@ -266,6 +266,10 @@ static socket_desc_t * _create_descriptor(socket_t * socket,
   anscheduler_lock(&task->descriptorsLock);
   desc->descriptor = anidxset_get(&task->descriptors);
   anscheduler_unlock(&task->descriptorsLock);
+  if (desc->descriptor == ANIDXSET_INVALID) {
+    anscheduler_free(desc);
+    return NULL;
+  }
   
   anscheduler_lock(&socket->connRecLock);
   if (isConnector) {
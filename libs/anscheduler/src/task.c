@@ -54,13 +54,13 @@ task_t * anscheduler_task_create() {
     return NULL;
   }
   
-  if (!anscheduler_idxset_init(&task->descriptors)) {
+  if (!anscheduler_idxset_init_bitmap(&task->descriptors)) {
     anscheduler_vm_root_free(task->vm);
     anscheduler_free(task);
     return NULL;
   }
   
-  if (!anscheduler_idxset_init(&task->stacks)) {
+  if (!anscheduler_idxset_init_bitmap(&task->stacks)) {
     anidxset_free(&task->descriptors);
     anscheduler_vm_root_free(task->vm);
     anscheduler_free(task);
@@ -76,9 +76,15 @@ task_t * anscheduler_task_create() {
   }
   
   task->pid = anscheduler_pidmap_alloc_pid();
+  anscheduler_lock_name(&task->vmLock, "vmLock");
+  anscheduler_lock_name(&task->socketsLock, "socketsLock");
   return task;
 }
 
+void anscheduler_task_name_locks() {
+  anscheduler_pidmap_name_locks();
+}
+
 void anscheduler_task_launch(task_t * task) {
   anscheduler_task_reference(task);
   
@@ -215,6 +221,8 @@ static void _free_task_method(task_t * task) {
   anidxset_free(&task->descriptors);
   
   anscheduler_pidmap_free_pid(task->pid);
+  anscheduler_lock_forget(&task->vmLock);
+  anscheduler_lock_forget(&task->socketsLock);
   anscheduler_free(task);
   
   anscheduler_loop_delete_cur_kernel();
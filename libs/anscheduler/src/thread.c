@@ -27,6 +27,13 @@ void _dealloc_kernel_stack(task_t * task, thread_t * thread);
  */
 void _finalize_thread_exit(thread_t * thread);
 
+/**
+ * Range unmap callback which frees stack pages that were allocated by the
+ * kernel.
+ * @critical
+ */
+void _free_stack_page(void * data, uint64_t page, uint16_t flags);
+
 thread_t * anscheduler_thread_create(task_t * task) {
   thread_t * thread = anscheduler_alloc(sizeof(thread_t));
   if (!thread) return NULL;
@@ -140,6 +147,8 @@ void anscheduler_thread_exit() {
 void anscheduler_thread_deallocate(task_t * task, thread_t * thread) {
   anscheduler_cpu_lock();
   anscheduler_intd_cmpnull(thread);
+  anscheduler_thread_cleanup(thread);
+  anscheduler_loop_set_priority(thread, 0);
   anscheduler_cpu_unlock();
   
   uint64_t i;
@@ -150,7 +159,7 @@ void anscheduler_thread_deallocate(task_t * task, thread_t * thread) {
   for (i = 0; i < 0x100; i++) {
     uint64_t page = firstPage + i;
     anscheduler_cpu_lock();
-    anscheduler_lock(&task->vmLock);
+    anscheduler_write_lock(&task->vmLock);
     uint16_t flags;
     uint64_t phyPage = anscheduler_vm_lookup(task->vm, page, &flags);
     if (flags & ANSCHEDULER_PAGE_FLAG_PRESENT) {
@@ -162,40 +171,30 @@ void anscheduler_thread_deallocate(task_t * task, thread_t * thread) {
       // the memory was never allocated to begin with
       anscheduler_vm_unmap(task->vm, page);
     }
-    anscheduler_unlock(&task->vmLock);
+    anscheduler_write_unlock(&task->vmLock);
     anscheduler_cpu_unlock();
   }
   
   // make sure no running instance will be able to access the memory anymore
   anscheduler_cpu_lock();
-  anscheduler_cpu_notify_invlpg(task);
+  anscheduler_cpu_notify_invlpg_range(task, firstPage, 0x100);
   anscheduler_cpu_unlock();
   
   // free all the memory
-  for (i = 0; i < 0x100; i++) {
-    uint64_t page = firstPage + i;
-    anscheduler_cpu_lock();
-    anscheduler_lock(&task->vmLock);
-    uint16_t flags;
-    uint64_t phyPage = anscheduler_vm_lookup(task->vm, page, &flags);
-    if (phyPage || flags) {
-      anscheduler_vm_unmap(task->vm, page);
-    }
-    anscheduler_unlock(&task->vmLock);
-    if (phyPage && (flags & ANSCHEDULER_PAGE_FLAG_UNALLOC)) {
-      uint64_t virPage = anscheduler_vm_virtual(phyPage);
-      anscheduler_free((void *)(virPage << 12));
-    }
-    anscheduler_cpu_unlock();
-  }
+  anscheduler_cpu_lock();
+  anscheduler_write_lock(&task->vmLock);
+  anscheduler_vm_unmap_range(task->vm, firstPage, 0x100, NULL,
+                             _free_stack_page);
+  anscheduler_write_unlock(&task->vmLock);
+  anscheduler_cpu_unlock();
 }
 
 void * anscheduler_thread_kernel_stack(task_t * task, thread_t * thread) {
   uint64_t vPage = ANSCHEDULER_TASK_KERN_STACKS_PAGE + thread->stack;
-  anscheduler_lock(&task->vmLock);
+  anscheduler_read_lock(&task->vmLock);
   uint16_t flags;
   uint64_t entry = anscheduler_vm_lookup(task->vm, vPage, &flags);
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_read_unlock(&task->vmLock);
   
   if (flags & ANSCHEDULER_PAGE_FLAG_PRESENT) {
     return (void *)(anscheduler_vm_virtual(entry) << 12);
@@ -224,13 +223,13 @@ bool _alloc_kernel_stack(task_t * task, thread_t * thread) {
   uint16_t flags = ANSCHEDULER_PAGE_FLAG_PRESENT
     | ANSCHEDULER_PAGE_FLAG_WRITE;
   
-  anscheduler_lock(&task->vmLock);
+  anscheduler_write_lock(&task->vmLock);
   if (!anscheduler_vm_map(task->vm, kPage, phyPage, flags)) {
-    anscheduler_unlock(&task->vmLock);
+    anscheduler_write_unlock(&task->vmLock);
     anscheduler_free(buffer);
     return false;
   }
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_write_unlock(&task->vmLock);
   return true;
 }
 
@@ -242,7 +241,7 @@ bool _map_user_stack(task_t * task, thread_t * thread) {
   uint64_t start = ANSCHEDULER_TASK_USER_STACKS_PAGE + (thread->stack << 8);
   
   uint64_t i;
-  anscheduler_lock(&task->vmLock);
+  anscheduler_write_lock(&task->vmLock);
   
   for (i = 0; i < 0x100; i++) {
     uint64_t page = i + start;
@@ -253,25 +252,25 @@ bool _map_user_stack(task_t * task, thread_t * thread) {
         page = j + start;
         anscheduler_vm_unmap(task->vm, page);
       }
-      anscheduler_unlock(&task->vmLock);
+      anscheduler_write_unlock(&task->vmLock);
       return false;
     }
   }
   
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_write_unlock(&task->vmLock);
   return true;
 }
 
 void _dealloc_kernel_stack(task_t * task, thread_t * thread) {
   // get the phyPage and unmap it
   uint64_t page = ANSCHEDULER_TASK_KERN_STACKS_PAGE + thread->stack;
-  anscheduler_lock(&task->vmLock);
+  anscheduler_write_lock(&task->vmLock);
   uint16_t flags;
   uint64_t phyPage = anscheduler_vm_lookup(task->vm, page, &flags);
   if (flags & ANSCHEDULER_PAGE_FLAG_PRESENT) {
     anscheduler_vm_unmap(task->vm, page);
   }
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_write_unlock(&task->vmLock);
   
   if (flags & ANSCHEDULER_PAGE_FLAG_PRESENT) {
     uint64_t virPage = anscheduler_vm_virtual(phyPage);
@@ -311,3 +310,9 @@ void _finalize_thread_exit(thread_t * thread) {
   // referenced, so that our kernel thread won't get screwed over.
   anscheduler_loop_run();
 }
+
+void _free_stack_page(void * data, uint64_t page, uint16_t flags) {
+  if (!page || !(flags & ANSCHEDULER_PAGE_FLAG_UNALLOC)) return;
+  uint64_t virPage = anscheduler_vm_virtual(page);
+  anscheduler_free((void *)(virPage << 12));
+}
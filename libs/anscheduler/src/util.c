@@ -9,6 +9,12 @@ uint8_t anscheduler_idxset_init(anidxset_root_t * root) {
                              anscheduler_idxset_free);
 }
 
+uint8_t anscheduler_idxset_init_bitmap(anidxset_root_t * root) {
+  return anidxset_initialize_bitmap(root,
+                                    anscheduler_idxset_alloc,
+                                    anscheduler_idxset_free);
+}
+
 static void * anscheduler_idxset_alloc() {
   return anscheduler_alloc(0x1000);
 }
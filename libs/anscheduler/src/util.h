@@ -4,5 +4,6 @@
 #include <anidxset.h>
 
 uint8_t anscheduler_idxset_init(anidxset_root_t * root);
+uint8_t anscheduler_idxset_init_bitmap(anidxset_root_t * root);
 
 #endif
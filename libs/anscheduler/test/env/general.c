@@ -12,6 +12,30 @@ void anscheduler_unlock(uint64_t * ptr) {
   anlock_unlock(ptr);
 }
 
+void anscheduler_read_lock(uint64_t * ptr) {
+  anlock_read_lock(ptr);
+}
+
+void anscheduler_read_unlock(uint64_t * ptr) {
+  anlock_read_unlock(ptr);
+}
+
+void anscheduler_write_lock(uint64_t * ptr) {
+  anlock_write_lock(ptr);
+}
+
+void anscheduler_write_unlock(uint64_t * ptr) {
+  anlock_write_unlock(ptr);
+}
+
+void anscheduler_lock_name(uint64_t * ptr, const char * name) {
+  anlock_name(ptr, name);
+}
+
+void anscheduler_lock_forget(uint64_t * ptr) {
+  anlock_forget(ptr);
+}
+
 void anscheduler_abort(const char * error) {
   fprintf(stderr, "[fatal]: %s\n", error);
   exit(1);
@@ -2,6 +2,12 @@
 
 void anscheduler_lock(uint64_t * ptr);
 void anscheduler_unlock(uint64_t * ptr);
+void anscheduler_read_lock(uint64_t * ptr);
+void anscheduler_read_unlock(uint64_t * ptr);
+void anscheduler_write_lock(uint64_t * ptr);
+void anscheduler_write_unlock(uint64_t * ptr);
+void anscheduler_lock_name(uint64_t * ptr, const char * name);
+void anscheduler_lock_forget(uint64_t * ptr);
 void anscheduler_abort(const char * error);
 void anscheduler_zero(void * buf, int len);
 void anscheduler_inc(uint64_t * ptr);
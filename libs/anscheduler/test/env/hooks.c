@@ -3,3 +3,6 @@
 void anscheduler_task_cleanup(task_t * task) {
 }
 
+void anscheduler_thread_cleanup(thread_t * thread) {
+}
+
@@ -68,6 +68,11 @@ void anscheduler_cpu_notify_invlpg(task_t * task) {
   // nothing to do here since we don't actually do paging
 }
 
+void anscheduler_cpu_notify_invlpg_range(task_t * task,
+                                         uint64_t start,
+                                         uint64_t count) {
+}
+
 void anscheduler_cpu_notify_dead(task_t * task) {
   int i;
   for (i = 0; i < cpuCount; i++) {
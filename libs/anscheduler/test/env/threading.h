@@ -23,6 +23,9 @@ thread_t * anscheduler_cpu_get_thread();
 void anscheduler_cpu_set_task(task_t * task);
 void anscheduler_cpu_set_thread(thread_t * thread);
 void anscheduler_cpu_notify_invlpg(task_t * task);
+void anscheduler_cpu_notify_invlpg_range(task_t * task,
+                                         uint64_t start,
+                                         uint64_t count);
 void anscheduler_cpu_notify_dead(task_t * task);
 void anscheduler_cpu_stack_run(void * arg, void (* fn)(void * a));
 void anscheduler_cpu_halt();
@@ -54,11 +54,11 @@ static void _user_thread_entry(void * rip) {
   
   // find the actual stack address
   task_t * task = anscheduler_cpu_get_task();
-  anscheduler_lock(&task->vmLock);
+  anscheduler_read_lock(&task->vmLock);
   uint16_t flags;
   uint64_t vpage = ((uint64_t)stackAddr) >> 12;
   uint64_t entry = anscheduler_vm_lookup(task->vm, vpage, &flags);
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_read_unlock(&task->vmLock);
   
   assert(flags & 1);
   
@@ -59,6 +59,23 @@ void anscheduler_vm_unmap(void * root, uint64_t vpage) {
   anscheduler_vm_map(root, vpage, 0, 0);
 }
 
+void anscheduler_vm_unmap_range(void * root,
+                                uint64_t vpage,
+                                uint64_t count,
+                                void * data,
+                                void (* fn)(void * data,
+                                            uint64_t page,
+                                            uint16_t flags)) {
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    uint16_t flags;
+    uint64_t page = anscheduler_vm_lookup(root, vpage + i, &flags);
+    if (!page && !flags) continue;
+    if (fn) fn(data, page, flags);
+    anscheduler_vm_unmap(root, vpage + i);
+  }
+}
+
 uint64_t anscheduler_vm_lookup(void * root,
                                uint64_t vpage,
                                uint16_t * flags) {
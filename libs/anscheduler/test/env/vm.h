@@ -12,6 +12,13 @@ bool anscheduler_vm_map(void * root,
                         uint64_t dpage,
                         uint16_t flags);
 void anscheduler_vm_unmap(void * root, uint64_t vpage);
+void anscheduler_vm_unmap_range(void * root,
+                                uint64_t vpage,
+                                uint64_t count,
+                                void * data,
+                                void (* fn)(void * data,
+                                            uint64_t page,
+                                            uint16_t flags));
 uint64_t anscheduler_vm_lookup(void * root,
                                uint64_t vpage,
                                uint16_t * flags);
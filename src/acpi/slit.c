@@ -0,0 +1,48 @@
+#include "slit.h"
+
+typedef struct {
+  uint32_t signature;
+  uint32_t length;
+  uint8_t revision;
+  uint8_t checksum;
+  char oemid[6];
+  uint64_t oemTableId;
+  uint32_t oemRevision;
+  uint32_t creatorId;
+  uint32_t creatorRev;
+  uint64_t count;
+} __attribute__((packed)) acpi_slit;
+
+static void * slit __attribute__((aligned(8))) = NULL;
+static acpi_slit slitHeader;
+
+bool acpi_slit_find() {
+  if (slit) return true;
+  if (!acpi_sdt_find()) return false;
+  
+  uint64_t i, count = acpi_sdt_count_tables();
+  for (i = 0; i < count; i++) {
+    void * phys = acpi_sdt_get_table(i);
+    kernpage_copy_physical(&slitHeader, phys, 4);
+    if (!memcmp(&slitHeader.signature, "SLIT", 4)) {
+      slit = phys;
+      kernpage_copy_physical(&slitHeader, phys, sizeof(slitHeader));
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+uint64_t acpi_slit_count() {
+  return slitHeader.count;
+}
+
+uint8_t acpi_slit_distance(uint64_t from, uint64_t to) {
+  if (from >= slitHeader.count || to >= slitHeader.count) return 0xff;
+  uint64_t offset = sizeof(slitHeader) + (from * slitHeader.count) + to;
+  if (offset >= slitHeader.length) return 0xff;
+  uint8_t distance;
+  kernpage_copy_physical(&distance, (void *)((uint64_t)slit + offset), 1);
+  return distance;
+}
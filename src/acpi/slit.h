@@ -0,0 +1,24 @@
+/**
+ * System Locality Information Table interface. This gives the relative
+ * distance between each pair of NUMA proximity domains.
+ */
+
+#include "sdt.h"
+
+/**
+ * Must be called before calling any other acpi_slit_ methods. This will
+ * automatically call acpi_sdt_find() for you.
+ * @return false if the system has no SLIT.
+ */
+bool acpi_slit_find();
+
+/**
+ * Returns the number of localities (proximity domains) in the SLIT.
+ */
+uint64_t acpi_slit_count();
+
+/**
+ * Returns the relative distance from one locality to another. A locality's
+ * distance to itself is normally 10. 0xff means the two are unreachable.
+ */
+uint8_t acpi_slit_distance(uint64_t from, uint64_t to);
@@ -0,0 +1,135 @@
+#include "srat.h"
+
+typedef struct {
+  uint32_t signature;
+  uint32_t length;
+  uint8_t revision;
+  uint8_t checksum;
+  char oemid[6];
+  uint64_t oemTableId;
+  uint32_t oemRevision;
+  uint32_t creatorId;
+  uint32_t creatorRev;
+  uint32_t reserved1;
+  uint64_t reserved2;
+} __attribute__((packed)) acpi_srat;
+
+typedef struct {
+  uint8_t type; // should be zero
+  uint8_t length;
+  uint8_t domainLow;
+  uint8_t apicId;
+  uint32_t flags; // bit 0 set = enabled
+  uint8_t sapicEid;
+  uint8_t domainHigh[3];
+  uint32_t clockDomain;
+} __attribute__((packed)) srat_entry_lapic;
+
+typedef struct {
+  uint8_t type; // should be 2
+  uint8_t length;
+  uint16_t reserved1;
+  uint32_t domain;
+  uint32_t x2apicId;
+  uint32_t flags; // bit 0 set = enabled
+  uint32_t clockDomain;
+  uint32_t reserved2;
+} __attribute__((packed)) srat_entry_x2apic;
+
+typedef void (* srat_iterator_t)(void * ui, void * entry,
+                                 uint8_t type, uint8_t len);
+
+typedef struct {
+  void * ui;
+  void * iter;
+} srat_iterator_ui_t;
+
+static void * srat __attribute__((aligned(8))) = NULL;
+static acpi_srat sratHeader;
+
+static void _srat_iterate(void * ui, srat_iterator_t iter);
+static void _cpu_iterator(srat_iterator_ui_t * iter,
+                          void * entry,
+                          uint8_t type,
+                          uint8_t len);
+static void _memory_iterator(srat_iterator_ui_t * iter,
+                             void * entry,
+                             uint8_t type,
+                             uint8_t len);
+
+bool acpi_srat_find() {
+  if (srat) return true;
+  if (!acpi_sdt_find()) return false;
+  
+  uint64_t i, count = acpi_sdt_count_tables();
+  for (i = 0; i < count; i++) {
+    void * phys = acpi_sdt_get_table(i);
+    kernpage_copy_physical(&sratHeader, phys, 4);
+    if (!memcmp(&sratHeader.signature, "SRAT", 4)) {
+      srat = phys;
+      kernpage_copy_physical(&sratHeader, phys, sizeof(sratHeader));
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+void acpi_srat_get_cpus(void * ui, srat_cpu_iterator_t fn) {
+  srat_iterator_ui_t iter;
+  iter.ui = ui;
+  iter.iter = fn;
+  _srat_iterate(&iter, (srat_iterator_t)_cpu_iterator);
+}
+
+void acpi_srat_get_memory(void * ui, srat_memory_iterator_t fn) {
+  srat_iterator_ui_t iter;
+  iter.ui = ui;
+  iter.iter = fn;
+  _srat_iterate(&iter, (srat_iterator_t)_memory_iterator);
+}
+
+static void _srat_iterate(void * ui, srat_iterator_t iter) {
+  uint64_t i = (uint64_t)srat + sizeof(sratHeader);
+  while (i + 2 < (uint64_t)srat + sratHeader.length) {
+    uint16_t typeAndLen;
+    kernpage_copy_physical(&typeAndLen, (void *)i, 2);
+    if (!(typeAndLen >> 8)) break; // corrupt table
+    iter(ui, (void *)i, typeAndLen & 0xff, typeAndLen >> 8);
+    i += (uint64_t)(typeAndLen >> 8);
+  }
+}
+
+static void _cpu_iterator(srat_iterator_ui_t * iter,
+                          void * entry,
+                          uint8_t type,
+                          uint8_t len) {
+  srat_cpu_iterator_t fn = iter->iter;
+  if (type == 0 && len >= sizeof(srat_entry_lapic)) {
+    srat_entry_lapic lapic;
+    kernpage_copy_physical(&lapic, entry, sizeof(lapic));
+    if (!(lapic.flags & 1)) return;
+    uint32_t domain = lapic.domainLow
+      | ((uint32_t)lapic.domainHigh[0] << 8)
+      | ((uint32_t)lapic.domainHigh[1] << 16)
+      | ((uint32_t)lapic.domainHigh[2] << 24);
+    fn(iter->ui, lapic.apicId, domain);
+  } else if (type == 2 && len >= sizeof(srat_entry_x2apic)) {
+    srat_entry_x2apic lapic;
+    kernpage_copy_physical(&lapic, entry, sizeof(lapic));
+    if (!(lapic.flags & 1)) return;
+    fn(iter->ui, lapic.x2apicId, lapic.domain);
+  }
+}
+
+static void _memory_iterator(srat_iterator_ui_t * iter,
+                             void * entry,
+                             uint8_t type,
+                             uint8_t len) {
+  if (type != 1 || len < sizeof(srat_memory_t)) return;
+  srat_memory_iterator_t fn = iter->iter;
+  srat_memory_t mem;
+  kernpage_copy_physical(&mem, entry, sizeof(mem));
+  if (!(mem.flags & 1)) return;
+  fn(iter->ui, &mem);
+}
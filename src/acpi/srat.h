@@ -0,0 +1,41 @@
+/**
+ * System Resource Affinity Table interface. Useful for figuring out which
+ * NUMA proximity domain each CPU and region of physical memory belongs to.
+ */
+
+#include "sdt.h"
+
+typedef struct {
+  uint8_t type; // should be 1
+  uint8_t length;
+  uint32_t domain;
+  uint16_t reserved1;
+  uint64_t base;
+  uint64_t length64;
+  uint32_t reserved2;
+  uint32_t flags; // bit 0 set = enabled
+  uint64_t reserved3;
+} __attribute__((packed)) srat_memory_t;
+
+typedef void (* srat_cpu_iterator_t)(void * ui,
+                                     uint32_t apicId,
+                                     uint32_t domain);
+typedef void (* srat_memory_iterator_t)(void * ui, srat_memory_t * mem);
+
+/**
+ * Must be called before calling any other acpi_srat_ methods. This will
+ * automatically call acpi_sdt_find() for you.
+ * @return false if the system has no SRAT (i.e. it is not NUMA)
+ */
+bool acpi_srat_find();
+
+/**
+ * Iterates over the enabled local APIC and x2APIC affinity entries.
+ */
+void acpi_srat_get_cpus(void * ui, srat_cpu_iterator_t iter);
+
+/**
+ * Iterates over the enabled memory affinity entries. The memory structure
+ * which is passed to the iterator has been copied into virtual memory.
+ */
+void acpi_srat_get_memory(void * ui, srat_memory_iterator_t iter);
@@ -11,7 +11,18 @@
   pop rbx ; cr3
   pop rax ; rsp
   mov rsp, rax
+  cr3_noflush rbx, rax
   mov cr3, rbx
   popaq
 %endmacro
 
+
+; Swap in the kernel's GS base if the interrupted code ran in user mode, or
+; swap it back out before returning there. %1 is the offset of the saved CS
+; from rsp.
+%macro swapgs_if_user 1
+  test qword [rsp + %1], 3
+  jz %%kernel
+  swapgs
+%%kernel:
+%endmacro
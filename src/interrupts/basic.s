@@ -13,49 +13,60 @@ extern int_interrupt_unknown
 extern thread_switch_to_kernpage, print
 
 %include "../pushaq.s"
+%include "../pcid.s"
 %include "../ctxswitch.s"
 
 handle_interrupt_exception:
+  swapgs_if_user 0x10
   beginframe
   mov rdi, [rsp + 0x80] ; vector argument
   call int_interrupt_exception
   endframe
   add rsp, 8
+  swapgs_if_user 8
   iretq
 
 ; we have a different handler for this because typically exceptions will try to
 ; access an error code and stuff
 handle_interrupt_exception_code:
+  swapgs_if_user 0x18
   beginframe
   mov rdi, [rsp + 0x80] ; vector argument
   mov rsi, [rsp + 0x88] ; error number argument (if one is pushed)
   call int_interrupt_exception_code
   endframe
   add rsp, 0x10
+  swapgs_if_user 8
   iretq
 
 handle_interrupt_irq:
+  swapgs_if_user 0x10
   beginframe
   mov rdi, [rsp + 0x80] ; vector argument
   call int_interrupt_irq
   endframe
   add rsp, 8
+  swapgs_if_user 8
   iretq
 
 handle_interrupt_ipi:
+  swapgs_if_user 0x10
   beginframe
   mov rdi, [rsp + 0x80] ; vector argument
   call int_interrupt_ipi
   endframe
   add rsp, 8
+  swapgs_if_user 8
   iretq
 
 handle_interrupt_unknown:
+  swapgs_if_user 0x10
   beginframe
   mov rdi, [rsp + 0x80] ; vector argument
   call int_interrupt_unknown
   endframe
   add rsp, 8
+  swapgs_if_user 8
   iretq
 
 global load_idtr
@@ -8,6 +8,7 @@
 #include <anscheduler/interrupts.h>
 #include <anscheduler/functions.h>
 #include <scheduler/interrupts.h>
+#include <scheduler/tlb.h>
 #include <anscheduler/paging.h>
 #include <anscheduler/task.h>
 #include <memory/kernpage.h>
@@ -142,8 +143,7 @@ void int_interrupt_irq(uint64_t vec) {
 }
 
 void int_interrupt_ipi(uint64_t vec) {
-  // 0x31 is page IPI; getting this interrupt will already do a context 
-  // switch and update the CR3
+  if (vec == 0x31) tlb_handle_ipi();
   if (lapic_is_in_service(vec)) {
     lapic_send_eoi();
   }
@@ -11,6 +11,10 @@
 
 static void * lapicPtr;
 static uint64_t lapicBusSpeed;
+static uint64_t tscSpeed;
+static uint64_t tscCalibrated;
+
+static uint64_t _read_tsc();
 
 void lapic_initialize() {
   if (!acpi_madt_count_lapics()) {
@@ -91,8 +95,11 @@ uint64_t lapic_calculate_bus_speed() {
   lapic_set_register(LAPIC_REG_LVT_TMR, 0xff);
   lapic_set_register(LAPIC_REG_TMRINITCNT, 0xffffffff);
   lapic_set_register(LAPIC_REG_TMRDIV, LAPIC_TIMER_DIV);
+  uint64_t tscStart = _read_tsc();
   pit_sleep(50);
   uint64_t value = lapic_get_register(LAPIC_REG_TMRCURRCNT);
+  tscCalibrated = _read_tsc();
+  tscSpeed = (tscCalibrated - tscStart) * 2L;
   lapic_set_register(LAPIC_REG_LVT_TMR, 0x10000);
   print(" value=0x");
   printHex(value);
@@ -104,6 +111,14 @@ uint64_t lapic_get_bus_speed() {
   return lapicBusSpeed;
 }
 
+uint64_t lapic_get_tsc_speed() {
+  return tscSpeed;
+}
+
+uint64_t lapic_get_tsc_calibrated() {
+  return tscCalibrated;
+}
+
 void lapic_send_eoi() {
   lapic_set_register(LAPIC_REG_EOI, 0);
 }
@@ -176,3 +191,8 @@ void lapic_timer_set(uint8_t vector, uint32_t count) {
   lapic_set_register(LAPIC_REG_TMRINITCNT, count);
 }
 
+static uint64_t _read_tsc() {
+  uint32_t lower, upper;
+  __asm__ __volatile__("rdtsc" : "=a" (lower), "=d" (upper));
+  return ((uint64_t)upper << 32) | lower;
+}
@@ -39,6 +39,18 @@ void lapic_clear_errors();
 uint64_t lapic_calculate_bus_speed();
 uint64_t lapic_get_bus_speed();
 
+/**
+ * Returns the TSC ticks per second, measured over the same PIT interval as the
+ * bus speed by lapic_calculate_bus_speed().
+ */
+uint64_t lapic_get_tsc_speed();
+
+/**
+ * Returns the TSC at the end of the calibration, which is the zero point of
+ * the clock tasks read from their info page.
+ */
+uint64_t lapic_get_tsc_calibrated();
+
 bool lapic_is_requested(uint8_t vector);
 bool lapic_is_in_service(uint8_t vector);
 
@@ -2,5 +2,6 @@
 #define __LIBKERN_STDDEF_H__
 
 #define NULL ((void *)0)
+#define offsetof(type, field) __builtin_offsetof(type, field)
 
 #endif
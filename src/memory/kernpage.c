@@ -4,30 +4,43 @@
 #include <shared/addresses.h>
 #include <anmem/alloc.h>
 #include <anmem/config.h>
+#include <anlock.h>
+#include <scheduler/cpu.h>
+#include "numa.h"
 
 static uint64_t phyMapCount = 0;
 static anmem_t anmemRoot;
 static uint64_t usedPages = 0;
+static bool anmemReady = false;
+
+// the first physical page which is not covered by the direct map
+static page_t directMapEnd = 0;
+
+// pages outside of the direct map (i.e. MMIO) mapped with kernpage_map()
+static kernpage_remap_t remaps[KERNPAGE_REMAP_MAX];
+static uint64_t remapCount = 0;
 
 static void _kernpage_get_regions();
 static void _kernpage_make_mapping();
+static void _kernpage_split_regions();
 static void _kernpage_configure_anmem();
+static void * _kernpage_alloc_local();
+static bool _kernpage_is_ram(page_t phys);
 
 // old kernpage functions
 static page_t _kernpage_next_physical();
 static page_t _kernpage_allocate_physical();
-static bool _kernpage_lin_map(page_t virt, page_t phys);
-
-// search functions
-static bool _kernpage_find_physical(uint64_t * table,
-                                    page_t page,
-                                    uint8_t depth,
-                                    page_t base,
-                                    page_t * virt);
+static bool _kernpage_lin_map(page_t virt, page_t phys, bool large);
 
 void kernpage_initialize() {
+  // startup/page_init.c identity mapped the first region for us
+  directMapEnd = LAST_VPAGE + 1;
   _kernpage_get_regions();
   _kernpage_make_mapping();
+
+  // kernpage_map() can use the old allocator to read the ACPI tables
+  numa_initialize();
+  _kernpage_split_regions();
   
   print("last pages: virtual=0x");
   printHex((uint64_t)LAST_VPAGE);
@@ -39,29 +52,14 @@ void kernpage_initialize() {
 }
 
 page_t kernpage_calculate_virtual(page_t phys) {
-  int i;
-  const kernpage_info * maps = (const kernpage_info *)PHYSICAL_MAP_ADDR;
-  uint64_t virtual = 0;
-  for (i = 0; i < phyMapCount; i++) {
-    if (maps[i].start > phys) return 0; // we've gone too far
-    if (maps[i].start <= phys && maps[i].start + maps[i].length > phys) {
-      return virtual + phys - maps[i].start;
-    }
-    virtual += maps[i].length;
-  }
-  return 0;
+  if (phys >= directMapEnd) return 0;
+  return phys + KERNPAGE_DIRECT_BASE;
 }
 
 page_t kernpage_calculate_physical(page_t virt) {
-  int i;
-  const kernpage_info * maps = (const kernpage_info *)PHYSICAL_MAP_ADDR;
-  for (i = 0; i < phyMapCount; i++) {
-    if (maps[i].start + maps[i].length > virt) {
-      return maps[i].start + virt;
-    }
-    virt -= maps[i].length;
-  }
-  return 0;
+  page_t phys = virt - KERNPAGE_DIRECT_BASE;
+  if (phys >= directMapEnd) return 0;
+  return phys;
 }
 
 uint64_t kernpage_last_virtual() {
@@ -87,6 +85,9 @@ bool kernpage_is_mapped(page_t page) {
     if (!(value & 0x03)) {
       return false;
     }
+    if (i && i < 3 && (value & 0x80)) {
+      return true; // 2MB or 1GB page
+    }
     uint64_t physPage = value >> 12;
     uint64_t virPage = kernpage_calculate_virtual(physPage);
     tablePtr = (uint64_t *)(virPage << 12);
@@ -109,7 +110,12 @@ bool kernpage_map(page_t virt, page_t phys) {
     uint64_t value = tablePtr[indices[i]];
     if (!(value & 0x03)) {
       // create a subtable
-      uint64_t newVirPage = kernpage_alloc_virtual();
+      uint64_t newVirPage;
+      if (anmemReady) {
+        newVirPage = kernpage_alloc_virtual();
+      } else {
+        newVirPage = kernpage_calculate_virtual(_kernpage_allocate_physical());
+      }
       if (!newVirPage) return false;
       uint64_t newPage = kernpage_calculate_physical(newVirPage);
       if (!newPage) return false;
@@ -120,6 +126,7 @@ bool kernpage_map(page_t virt, page_t phys) {
       tablePtr[indices[i]] = (newPage << 12) | 3;
       tablePtr = newData;
     } else {
+      if (value & 0x80) return false; // inside a large page
       uint64_t physPage = value >> 12;
       uint64_t virPage = kernpage_calculate_virtual(physPage);
       if (!virPage) return false;
@@ -130,6 +137,16 @@ bool kernpage_map(page_t virt, page_t phys) {
   tablePtr[indices[3]] = (phys << 12) | 3;
   invalidate_page(virt);
   if (virt > LAST_VPAGE) LAST_VPAGE = virt;
+
+  // remember where non-RAM pages went so kernpage_lookup_virtual() is cheap
+  if (virt - KERNPAGE_DIRECT_BASE >= directMapEnd) {
+    uint64_t idx = __sync_fetch_and_add(&remapCount, 1);
+    if (idx >= KERNPAGE_REMAP_MAX) {
+      die("too many pages mapped with kernpage_map()");
+    }
+    remaps[idx].phys = phys;
+    remaps[idx].virt = virt;
+  }
   return true;
 }
 
@@ -139,15 +156,26 @@ bool kernpage_lookup_virtual(page_t phys, page_t * virt) {
     return true;
   }
   
-  uint64_t quickResult = kernpage_calculate_virtual(phys);
-  if (quickResult) return quickResult;
+  // RAM is always in the direct map, but holes in the direct map are not
+  if (_kernpage_is_ram(phys)) {
+    *virt = kernpage_calculate_virtual(phys);
+    return true;
+  }
 
-  uint64_t * tablePtr = (uint64_t *)PML4_START;
-  return _kernpage_find_physical(tablePtr, phys, 3, 0, virt);
+  uint64_t i, count = remapCount;
+  if (count > KERNPAGE_REMAP_MAX) count = KERNPAGE_REMAP_MAX;
+  for (i = 0; i < count; i++) {
+    if (remaps[i].phys == phys) {
+      *virt = remaps[i].virt;
+      return true;
+    }
+  }
+  return false;
 }
 
 page_t kernpage_alloc_virtual() {
-  void * buffer = anmem_alloc_page(&anmemRoot);
+  void * buffer = _kernpage_alloc_local();
+  if (!buffer) buffer = anmem_alloc_page(&anmemRoot);
   if (!buffer) return 0;
   __sync_fetch_and_add(&usedPages, 1);
   return ((uint64_t)buffer) >> 12;
@@ -237,7 +265,7 @@ static void _kernpage_get_regions() {
   volatile kernpage_info * destMap = (kernpage_info *)PHYSICAL_MAP_ADDR;
 
   int count = 0, i;
-  while (mmapLength > 0 && count < 255) {
+  while (mmapLength > 0 && count < KERNPAGE_REGIONS_MAX) {
     // iterating maps
     mmap = next;
     next = (const mmap_info *)((const char *)mmap + mmap->size + 4);
@@ -309,26 +337,64 @@ static void _kernpage_make_mapping() {
   print("expanding physical map...\n");
   // map pages
   int i;
-  uint64_t j;
   const kernpage_info * maps = (const kernpage_info *)PHYSICAL_MAP_ADDR;
-  uint64_t virtual = 0, created = 0;
+  uint64_t created = 0, createdLarge = 0;
   print("last page (initial) = ");
   printHex(LAST_PAGE);
   print(", vpage = ");
   printHex(LAST_VPAGE);
   print("\n");
   for (i = 0; i < phyMapCount; i++) {
-    for (j = maps[i].start; j < maps[i].length + maps[i].start; j++) {
-      if (!kernpage_is_mapped(virtual)) {
-        _kernpage_lin_map(virtual, j);
+    page_t page = maps[i].start;
+    page_t end = maps[i].start + maps[i].length;
+    while (page < end) {
+      page_t virt = page + KERNPAGE_DIRECT_BASE;
+      if (!(page & 0x1ff) && page + 0x200 <= end) {
+        // try to use a 2MB page for the whole aligned chunk
+        if (_kernpage_lin_map(virt, page, true)) {
+          createdLarge++;
+          page += 0x200;
+          continue;
+        }
+      }
+      if (!kernpage_is_mapped(virt)) {
+        if (!_kernpage_lin_map(virt, page, false)) {
+          die("failed to expand direct map");
+        }
         created++;
       }
-      virtual++;
+      page++;
     }
   }
+  directMapEnd = LAST_VPAGE + 1 - KERNPAGE_DIRECT_BASE;
   print("mapped 0x");
   printHex(created);
-  print(" new pages to virtual memory\n");
+  print(" new pages and 0x");
+  printHex(createdLarge);
+  print(" large pages to virtual memory\n");
+}
+
+static void _kernpage_split_regions() {
+  // make sure every region lies on exactly one NUMA node
+  if (numa_node_count() < 2) return;
+  int i, j;
+  volatile kernpage_info * maps = (kernpage_info *)PHYSICAL_MAP_ADDR;
+  for (i = 0; i < phyMapCount; i++) {
+    page_t end = maps[i].start + maps[i].length;
+    page_t boundary = numa_next_boundary(maps[i].start);
+    if (!boundary || boundary >= end) continue;
+    if (phyMapCount >= KERNPAGE_REGIONS_MAX) {
+      print("too many regions to split at every NUMA boundary\n");
+      return;
+    }
+    for (j = phyMapCount; j > i + 1; j--) {
+      maps[j] = maps[j - 1];
+    }
+    maps[i + 1].start = boundary;
+    maps[i + 1].length = end - boundary;
+    maps[i].length = boundary - maps[i].start;
+    phyMapCount++;
+  }
 }
 
 static void _kernpage_configure_anmem() {
@@ -347,6 +413,7 @@ static void _kernpage_configure_anmem() {
   config.physPageOffset = 0;
   config.structSize = 0x10;
   config.structCount = phyMapCount;
+  config.directMapped = true;
 
   // 2^15 * 0x1000 = 128MiB
   bool result = anmem_configure(&config, &anmemRoot, 15, firstVpage);
@@ -354,6 +421,14 @@ static void _kernpage_configure_anmem() {
 
   result = anmem_init_structures(&anmemRoot);
   if (!result) die("anmem_init_structures() failed");
+  anmemReady = true;
+
+  uint64_t i;
+  for (i = 0; i < anmemRoot.count; i++) {
+    page_t start = anmemRoot.allocators[i].start;
+    anmemRoot.allocators[i].node = numa_node_for_page(start);
+    anlock_name(&anmemRoot.allocators[i].lock, "anmem section");
+  }
 
   print("anmem configured, skip=0x");
   printHex(firstVpage);
@@ -364,6 +439,46 @@ static void _kernpage_configure_anmem() {
   LAST_PAGE = 0;
 }
 
+/**
+ * Binary searches the sorted region list for the region containing `phys`.
+ */
+static bool _kernpage_is_ram(page_t phys) {
+  if (phys >= directMapEnd) return false;
+  const kernpage_info * maps = (const kernpage_info *)PHYSICAL_MAP_ADDR;
+  uint64_t low = 0, high = phyMapCount;
+  while (low < high) {
+    uint64_t mid = (low + high) >> 1;
+    if (maps[mid].start > phys) {
+      high = mid;
+    } else if (maps[mid].start + maps[mid].length <= phys) {
+      low = mid + 1;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void * _kernpage_alloc_local() {
+  uint64_t i, count = numa_node_count();
+  if (count < 2 || !cpu_count()) return NULL;
+  cpu_t * cpu = cpu_current();
+  if (!cpu) return NULL;
+
+  // the local node usually has pages, so remember where we found the last one
+  void * buffer = anmem_alloc_page_hint(&anmemRoot, cpu->numaNode,
+                                        &cpu->allocHint);
+  if (buffer) return buffer;
+
+  // fall back on the other nodes, in SLIT order
+  for (i = 1; i < count; i++) {
+    uint8_t node = numa_fallback(cpu->numaNode, i);
+    buffer = anmem_alloc_page_node(&anmemRoot, node);
+    if (buffer) return buffer;
+  }
+  return NULL;
+}
+
 /************************
  * Old kernpage methods *
  ************************/
@@ -393,15 +508,15 @@ static page_t _kernpage_allocate_physical() {
   return (LAST_PAGE = next);
 }
 
-static bool _kernpage_lin_map(page_t virt, page_t phys) {
-  int i;
+static bool _kernpage_lin_map(page_t virt, page_t phys, bool large) {
+  int i, depth = large ? 2 : 3;
   uint64_t indexInPT = virt % 0x200;
   uint64_t indexInPDT = (virt >> 9) % 0x200;
   uint64_t indexInPDPT = (virt >> 18) % 0x200;
   uint64_t indexInPML4 = (virt >> 27) % 0x200;
   uint64_t indices[4] = {indexInPML4, indexInPDPT, indexInPDT, indexInPT};
   volatile uint64_t * tablePtr = (uint64_t *)PML4_START;
-  for (i = 0; i < 3; i++) {
+  for (i = 0; i < depth; i++) {
     uint64_t value = tablePtr[indices[i]];
     if (!(value & 0x03)) {
       // create a subtable
@@ -415,51 +530,22 @@ static bool _kernpage_lin_map(page_t virt, page_t phys) {
       tablePtr[indices[i]] = (newPage << 12) | 3;
       tablePtr = newData;
     } else {
+      if (value & 0x80) return false; // already in a large page
       uint64_t physPage = value >> 12;
       uint64_t virPage = kernpage_calculate_virtual(physPage);
       if (!virPage) return false;
       tablePtr = (uint64_t *)(virPage << 12);
     }
   }
-  tablePtr[indices[3]] = (phys << 12) | 3;
-  invalidate_page(virt);
+  if (large) {
+    // a partially mapped chunk keeps its page table
+    if (tablePtr[indices[2]] & 0x03) return false;
+    tablePtr[indices[2]] = (phys << 12) | 0x83;
+    virt += 0x1ff;
+  } else {
+    tablePtr[indices[3]] = (phys << 12) | 3;
+    invalidate_page(virt);
+  }
   if (virt > LAST_VPAGE) LAST_VPAGE = virt;
   return true;
 }
-
-/**********************************
- * Searching (for love--and pages) *
- **********************************/
-
-static bool _kernpage_find_physical(uint64_t * table,
-                                    uint64_t page,
-                                    uint8_t depth,
-                                    page_t base,
-                                    page_t * virt) {
-  int i;
-  if (depth == 0) {
-    for (i = 0x1ff; i >= 0; i--) {
-      if (!(table[i] & 0x3)) continue;
-      if (table[i] >> 12 == page) {
-        *virt = base + i;
-        return true;
-      }
-    }
-    return false;
-  }
-
-  // recursive search
-  uint64_t eachSize = 1 << (9 * depth);
-  for (i = 0x1ff; i >= 0; i--) {
-    if (!(table[i] & 0x3)) continue;
-    uint64_t virPage = kernpage_calculate_virtual(table[i] >> 12);
-    uint64_t * nextTable = (uint64_t *)(virPage << 12);
-    bool result = _kernpage_find_physical(nextTable,
-                                          page,
-                                          depth - 1,
-                                          base + (eachSize * i),
-                                          virt);
-    if (result) return true;
-  }
-  return false;
-}
@@ -16,19 +16,43 @@ typedef struct {
   uint64_t length;
 } __attribute__((packed)) kernpage_info;
 
+typedef struct {
+  page_t phys;
+  page_t virt;
+} __attribute__((packed)) kernpage_remap_t;
+
+/**
+ * The most RAM regions kept at PHYSICAL_MAP_ADDR, including the ones made by
+ * splitting regions at NUMA node boundaries.
+ */
+#define KERNPAGE_REGIONS_MAX 0xff
+
+/**
+ * The virtual page where physical page 0 lives in the direct map. Every
+ * region of RAM is mapped at this fixed offset, using 2MB pages wherever the
+ * region allows it.
+ */
+#define KERNPAGE_DIRECT_BASE 0
+
+/**
+ * The maximum number of non-RAM pages (i.e. MMIO) which kernpage_map() will
+ * remember for kernpage_lookup_virtual(). Mapping more is fatal.
+ */
+#define KERNPAGE_REMAP_MAX 0x40
+
 /**
- * Initializes the kernel page tables to map to the entire physical address
- * space.
+ * Initializes the kernel page tables to direct map every region of RAM.
  */
 void kernpage_initialize();
 
 /**
- * Calculates the virtual page which maps to a physical page.
+ * Calculates the virtual page which maps to a physical page in the direct map.
+ * Returns 0 if the page is beyond the end of RAM.
  */
 page_t kernpage_calculate_virtual(page_t phys);
 
 /**
- * Calculates the physical page that a virtual page maps to.
+ * Calculates the physical page that a direct mapped virtual page maps to.
  */
 page_t kernpage_calculate_physical(page_t virt);
 
@@ -48,8 +72,8 @@ bool kernpage_is_mapped(page_t virt);
 bool kernpage_map(page_t virt, page_t phys);
 
 /**
- * Does a backwards search through the kernel page tables to find a virtual
- * page which maps to a physical page.
+ * Finds a virtual page which maps to a physical page. This works for RAM and
+ * for pages which were mapped with kernpage_map().
  */
 bool kernpage_lookup_virtual(page_t phys, page_t * virt);
 
@@ -0,0 +1,143 @@
+#include "numa.h"
+#include <stdio.h>
+#include <acpi/srat.h>
+#include <acpi/slit.h>
+
+typedef struct {
+  uint32_t apicId;
+  uint8_t node;
+} __attribute__((packed)) numa_cpu_t;
+
+static uint64_t nodeCount = 1;
+static uint32_t nodeDomains[NUMA_MAX_NODES];
+static uint8_t fallbacks[NUMA_MAX_NODES][NUMA_MAX_NODES];
+
+static numa_range_t ranges[NUMA_MAX_RANGES];
+static uint64_t rangeCount = 0;
+
+static numa_cpu_t cpus[NUMA_MAX_CPUS];
+static uint64_t cpuCount = 0;
+
+static uint8_t _node_for_domain(uint32_t domain);
+static void _add_cpu(void * unused, uint32_t apicId, uint32_t domain);
+static void _add_memory(void * unused, srat_memory_t * mem);
+static void _generate_fallbacks();
+static uint8_t _distance(uint8_t from, uint8_t to);
+
+void numa_initialize() {
+  nodeCount = 1;
+  nodeDomains[0] = 0;
+  rangeCount = 0;
+  cpuCount = 0;
+
+  if (acpi_srat_find()) {
+    nodeCount = 0;
+    acpi_srat_get_memory(NULL, _add_memory);
+    acpi_srat_get_cpus(NULL, _add_cpu);
+    if (!nodeCount) nodeCount = 1;
+  }
+  _generate_fallbacks();
+
+  print("NUMA nodes=0x");
+  printHex(nodeCount);
+  print(" ranges=0x");
+  printHex(rangeCount);
+  print(" cpus=0x");
+  printHex(cpuCount);
+  print("\n");
+}
+
+uint64_t numa_node_count() {
+  return nodeCount;
+}
+
+uint8_t numa_node_for_page(page_t page) {
+  uint64_t i;
+  for (i = 0; i < rangeCount; i++) {
+    if (ranges[i].start <= page && ranges[i].end > page) {
+      return ranges[i].node;
+    }
+  }
+  return 0;
+}
+
+uint8_t numa_node_for_apic(uint32_t apicId) {
+  uint64_t i;
+  for (i = 0; i < cpuCount; i++) {
+    if (cpus[i].apicId == apicId) return cpus[i].node;
+  }
+  return 0;
+}
+
+page_t numa_next_boundary(page_t page) {
+  page_t result = 0;
+  uint64_t i;
+  for (i = 0; i < rangeCount; i++) {
+    if (ranges[i].start > page && (!result || ranges[i].start < result)) {
+      result = ranges[i].start;
+    }
+    if (ranges[i].end > page && (!result || ranges[i].end < result)) {
+      result = ranges[i].end;
+    }
+  }
+  return result;
+}
+
+uint8_t numa_fallback(uint8_t node, uint64_t idx) {
+  if (node >= nodeCount || idx >= nodeCount) return 0;
+  return fallbacks[node][idx];
+}
+
+static uint8_t _node_for_domain(uint32_t domain) {
+  uint64_t i;
+  for (i = 0; i < nodeCount; i++) {
+    if (nodeDomains[i] == domain) return (uint8_t)i;
+  }
+  if (nodeCount == NUMA_MAX_NODES) return NUMA_MAX_NODES - 1;
+  nodeDomains[nodeCount] = domain;
+  return (uint8_t)(nodeCount++);
+}
+
+static void _add_cpu(void * unused, uint32_t apicId, uint32_t domain) {
+  if (cpuCount == NUMA_MAX_CPUS) return;
+  cpus[cpuCount].apicId = apicId;
+  cpus[cpuCount].node = _node_for_domain(domain);
+  cpuCount++;
+}
+
+static void _add_memory(void * unused, srat_memory_t * mem) {
+  if (rangeCount == NUMA_MAX_RANGES) return;
+  page_t start = mem->base >> 12;
+  page_t end = (mem->base + mem->length64) >> 12;
+  if (start >= end) return;
+  ranges[rangeCount].start = start;
+  ranges[rangeCount].end = end;
+  ranges[rangeCount].node = _node_for_domain(mem->domain);
+  rangeCount++;
+}
+
+static void _generate_fallbacks() {
+  bool hasSlit = nodeCount > 1 && acpi_slit_find();
+  uint64_t i, j, k;
+  for (i = 0; i < nodeCount; i++) {
+    // insertion sort by distance; the node itself always comes first
+    fallbacks[i][0] = (uint8_t)i;
+    uint64_t count = 1;
+    for (j = 0; j < nodeCount; j++) {
+      if (j == i) continue;
+      uint8_t dist = hasSlit ? _distance(i, j) : 0;
+      for (k = count; k > 1; k--) {
+        uint8_t other = fallbacks[i][k - 1];
+        uint8_t otherDist = hasSlit ? _distance(i, other) : 0;
+        if (otherDist <= dist) break;
+        fallbacks[i][k] = other;
+      }
+      fallbacks[i][k] = (uint8_t)j;
+      count++;
+    }
+  }
+}
+
+static uint8_t _distance(uint8_t from, uint8_t to) {
+  return acpi_slit_distance(nodeDomains[from], nodeDomains[to]);
+}
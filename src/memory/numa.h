@@ -0,0 +1,57 @@
+#ifndef __NUMA_H__
+#define __NUMA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * The maximum number of NUMA nodes which will be tracked. Proximity domains
+ * beyond this are folded into the last node.
+ */
+#define NUMA_MAX_NODES 0x10
+
+/**
+ * The maximum number of memory ranges and CPUs read from the SRAT.
+ */
+#define NUMA_MAX_RANGES 0x40
+#define NUMA_MAX_CPUS 0x100
+
+typedef struct {
+  page_t start;
+  page_t end;
+  uint8_t node;
+} __attribute__((packed)) numa_range_t;
+
+/**
+ * Reads the SRAT and SLIT (if present) and builds each node's fallback order.
+ * Systems without an SRAT are treated as having a single node.
+ */
+void numa_initialize();
+
+/**
+ * Returns the number of NUMA nodes; this is at least 1.
+ */
+uint64_t numa_node_count();
+
+/**
+ * Returns the node which a physical page belongs to, or 0 if unknown.
+ */
+uint8_t numa_node_for_page(page_t page);
+
+/**
+ * Returns the node which a local APIC ID belongs to, or 0 if unknown.
+ */
+uint8_t numa_node_for_apic(uint32_t apicId);
+
+/**
+ * Returns the first node boundary after `page`, or 0 if there is none. This
+ * is used to split physical regions so each lies on exactly one node.
+ */
+page_t numa_next_boundary(page_t page);
+
+/**
+ * Returns the `idx`th closest node to `node`, starting with `node` itself.
+ */
+uint8_t numa_fallback(uint8_t node, uint64_t idx);
+
+#endif
@@ -0,0 +1,10 @@
+; Set bit 63 of a CR3 value (register %1) if PCIDs are enabled on this CPU,
+; so that loading it keeps the translations cached for its PCID. The bit must
+; stay clear while CR4.PCIDE is off. Clobbers %2.
+%macro cr3_noflush 2
+  mov %2, cr4
+  bt %2, 17
+  jnc %%done
+  bts %1, 63
+%%done:
+%endmacro
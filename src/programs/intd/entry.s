@@ -1,9 +1,10 @@
 bits 64
 
-extern main, sys_exit
+extern main, sys_exit, tls_initialize
 
 section .entrypoint
 start:
+  call tls_initialize
   call main
   call sys_exit
 .hang:
@@ -21,6 +21,7 @@ int main() {
   clients = _clients;
 
   sys_wants_interrupts();
+  sys_set_priority(8); // forward interrupts ahead of ordinary work
 
   // connect to name server
   uint64_t fd = msgd_connect();
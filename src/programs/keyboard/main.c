@@ -46,6 +46,7 @@ int main() {
 
   uint64_t mask = 2;
   sys_write(intd, &mask, 8);
+  sys_set_priority(4); // drain the controller before it drops scancodes
 
   while (1) {
     while (1) {
@@ -1,92 +1,59 @@
 #include "lock.h"
 #include "system.h"
-#include <anlock.h>
 
-/**
- * Returns `true` if the lock was able to be locked, false if added but waiting.
- */
-static bool _lock_try_or_add(_th_queue_t * queue, basic_lock_t * lock);
-
-/**
- * Go through each thread in the waiting queue and see if we are one of them. If
- * we are, `false` is returned, otherwise `true`.
- * @param lock The lock.
- * @param remove If `true`, if this thread is found, remove it from the queue
- * before returning `false`.
- */
-static bool _lock_check_or_have(basic_lock_t * lock, bool remove);
+#define LOCK_UNLOCKED 0
+#define LOCK_LOCKED 1
+#define LOCK_CONTENDED 2
 
 void basic_lock_lock(basic_lock_t * lock) {
-  _th_queue_t thisQueue = {0, sys_thread_id()};
-  if (_lock_try_or_add(&thisQueue, lock)) return;
-  while (!_lock_check_or_have(lock, false)) {
-    // this thread will be woken on unlock anyway
-    sys_sleep(0xffffffffffffffff);
+  uint64_t state = __sync_val_compare_and_swap(&lock->state, LOCK_UNLOCKED,
+                                               LOCK_LOCKED);
+  if (state == LOCK_UNLOCKED) return;
+
+  // mark the lock contended so that the holder knows to wake us
+  if (state != LOCK_CONTENDED) {
+    state = __sync_lock_test_and_set(&lock->state, LOCK_CONTENDED);
+  }
+  while (state != LOCK_UNLOCKED) {
+    sys_futex_wait(&lock->state, LOCK_CONTENDED, 0);
+    state = __sync_lock_test_and_set(&lock->state, LOCK_CONTENDED);
   }
 }
 
-bool basic_lock_timedlock(basic_lock_t * lock, uint64_t micros) {
-  sys_clear_unsleep(); // prevent a spurrious wakeup
-
-  _th_queue_t thisQueue = {0, sys_thread_id()};
-  if (_lock_try_or_add(&thisQueue, lock)) return true;
-  sys_sleep(micros);
-
-  return _lock_check_or_have(lock, true);
+bool basic_lock_trylock(basic_lock_t * lock) {
+  return __sync_bool_compare_and_swap(&lock->state, LOCK_UNLOCKED,
+                                      LOCK_LOCKED);
 }
 
-void basic_lock_unlock(basic_lock_t * lock) {
-  anlock_lock(&lock->lock);
-  if (!lock->first) {
-    lock->isLocked = 0;
-    anlock_unlock(&lock->lock);
-    return;
-  }
-  _th_queue_t * th = lock->first;
-  if (!(lock->first = th->next)) {
-    lock->last = NULL;
+void basic_lock_lock_contended(basic_lock_t * lock) {
+  // never take the uncontended fast path, since sleepers we cannot see may
+  // have been requeued onto the lock
+  while (__sync_lock_test_and_set(&lock->state, LOCK_CONTENDED)
+         != LOCK_UNLOCKED) {
+    sys_futex_wait(&lock->state, LOCK_CONTENDED, 0);
   }
-  sys_unsleep(th->threadId);
-  anlock_unlock(&lock->lock);
 }
 
-static bool _lock_try_or_add(_th_queue_t * queue, basic_lock_t * lock) {
-  anlock_lock(&lock->lock);
-  if (!lock->isLocked) {
-    lock->isLocked = 1;
-    anlock_unlock(&lock->lock);
-    return true;
-  }
-  // push ourself to the waiting queue
-  if (lock->last) {
-    lock->last = (lock->last->next = queue);
-  } else {
-    lock->first = (lock->last = queue);
-  }
-  anlock_unlock(&lock->lock);
-  return false;
-}
+bool basic_lock_timedlock(basic_lock_t * lock, uint64_t micros) {
+  uint64_t state = __sync_val_compare_and_swap(&lock->state, LOCK_UNLOCKED,
+                                               LOCK_LOCKED);
+  if (state == LOCK_UNLOCKED) return true;
 
-static bool _lock_check_or_have(basic_lock_t * lock, bool remove) {
-  uint64_t selfId = sys_thread_id();
-  anlock_lock(&lock->lock);
-  _th_queue_t * aNode = lock->first;
-  _th_queue_t * last = NULL;
-  while (aNode) {
-    if (aNode->threadId == selfId) {
-      // remove it, unlock the lock, and return false
-      if (remove) {
-        if (last) last->next = aNode->next;
-        else lock->first = aNode->next;
-        if (!aNode->next) lock->last = last;
-      }
-      anlock_unlock(&lock->lock);
-      return false;
-    }
-    last = aNode;
-    aNode = aNode->next;
+  uint64_t deadline = sys_get_time() + micros;
+  if (state != LOCK_CONTENDED) {
+    state = __sync_lock_test_and_set(&lock->state, LOCK_CONTENDED);
+  }
+  while (state != LOCK_UNLOCKED) {
+    uint64_t now = sys_get_time();
+    if (now >= deadline) return false;
+    sys_futex_wait(&lock->state, LOCK_CONTENDED, deadline - now);
+    state = __sync_lock_test_and_set(&lock->state, LOCK_CONTENDED);
   }
-  anlock_unlock(&lock->lock);
   return true;
 }
 
+void basic_lock_unlock(basic_lock_t * lock) {
+  if (__sync_fetch_and_sub(&lock->state, 1) == LOCK_LOCKED) return;
+  lock->state = LOCK_UNLOCKED;
+  sys_futex_wake(&lock->state, 1);
+}
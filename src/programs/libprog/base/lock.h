@@ -5,23 +5,26 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-typedef struct _th_queue_t _th_queue_t;
-
-struct _th_queue_t {
-  _th_queue_t * next;
-  uint64_t threadId;
-} __attribute__((packed));
-
+/**
+ * A futex-backed mutex. The state is 0 when unlocked, 1 when locked, and 2
+ * when locked with threads possibly sleeping on it. Neither locking nor
+ * unlocking makes a syscall unless the lock is contended.
+ */
 typedef struct {
-  _th_queue_t * first;
-  _th_queue_t * last;
-  uint64_t isLocked;
-  uint64_t lock;
-} __attribute__((packed)) basic_lock_t;
+  uint64_t state;
+} basic_lock_t;
 
-#define BASIC_LOCK_INITIALIZER {NULL, NULL, 0, 0}
+#define BASIC_LOCK_INITIALIZER {0}
 
 void basic_lock_lock(basic_lock_t * lock);
+bool basic_lock_trylock(basic_lock_t * lock);
+
+/**
+ * Seize the lock and leave it marked contended, so that the next unlock wakes
+ * a sleeper. Use this after threads may have been moved onto the lock with
+ * sys_futex_requeue().
+ */
+void basic_lock_lock_contended(basic_lock_t * lock);
 bool basic_lock_timedlock(basic_lock_t * lock, uint64_t micros);
 void basic_lock_unlock(basic_lock_t * lock);
 
@@ -0,0 +1,40 @@
+#include "ring.h"
+#include "system.h"
+
+void ring_init(ring_t * ring) {
+  ring->sqHead = 0;
+  ring->sqTail = 0;
+  ring->cqHead = 0;
+  ring->cqTail = 0;
+}
+
+bool ring_push(ring_t * ring,
+               uint64_t op,
+               uint64_t arg1,
+               uint64_t arg2,
+               uint64_t arg3,
+               uint64_t userData) {
+  uint64_t tail = ring->sqTail;
+  if (tail - ring->sqHead >= RING_ENTRIES) return false;
+  ring_sqe_t * sqe = &ring->sq[tail & (RING_ENTRIES - 1)];
+  sqe->op = op;
+  sqe->args[0] = arg1;
+  sqe->args[1] = arg2;
+  sqe->args[2] = arg3;
+  sqe->userData = userData;
+  ring->sqTail = tail + 1;
+  return true;
+}
+
+uint64_t ring_submit(ring_t * ring) {
+  if (ring->sqHead == ring->sqTail) return 0;
+  return sys_ring_enter(ring);
+}
+
+bool ring_pop(ring_t * ring, ring_cqe_t * cqe) {
+  uint64_t head = ring->cqHead;
+  if (head == ring->cqTail) return false;
+  *cqe = ring->cq[head & (RING_ENTRIES - 1)];
+  ring->cqHead = head + 1;
+  return true;
+}
@@ -0,0 +1,72 @@
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stdtype.h>
+
+/**
+ * A submission/completion ring for batching syscalls. Queue operations with
+ * ring_push(), run them all with one ring_submit(), then collect a result for
+ * each with ring_pop(). The layout must match src/syscall/ring.h. A ring may
+ * only be pushed to and popped from by one thread at a time. The ring and
+ * every buffer named in an entry must be on the submitting thread's stack.
+ */
+
+#define RING_ENTRIES 0x40
+#define RING_RESULT_INVAL 0xffffffffffffffffL
+
+enum {
+  RING_OP_NOP,
+  RING_OP_OPEN, // () -> fd
+  RING_OP_CONNECT, // (fd, pid) -> 1 or 0
+  RING_OP_CLOSE, // (fd) -> 0
+  RING_OP_READ, // (fd, msg_t *) -> 1 or 0
+  RING_OP_WRITE, // (fd, ptr, len) -> 1 or 0
+  RING_OP_SLEEP, // (usec) -> 0
+  RING_OP_IN, // (port, size) -> value
+  RING_OP_OUT // (port, value, size) -> 0
+};
+
+typedef struct {
+  uint64_t op;
+  uint64_t args[3];
+  uint64_t userData;
+} __attribute__((packed)) ring_sqe_t;
+
+typedef struct {
+  uint64_t userData;
+  uint64_t result;
+} __attribute__((packed)) ring_cqe_t;
+
+typedef struct {
+  uint64_t sqHead;
+  uint64_t sqTail;
+  uint64_t cqHead;
+  uint64_t cqTail;
+  ring_sqe_t sq[RING_ENTRIES];
+  ring_cqe_t cq[RING_ENTRIES];
+} __attribute__((packed)) ring_t;
+
+void ring_init(ring_t * ring);
+
+/**
+ * Queue an operation. Returns false if the submission queue is full.
+ */
+bool ring_push(ring_t * ring,
+               uint64_t op,
+               uint64_t arg1,
+               uint64_t arg2,
+               uint64_t arg3,
+               uint64_t userData);
+
+/**
+ * Run every queued operation that fits in the completion queue. Returns the
+ * number of operations which were run.
+ */
+uint64_t ring_submit(ring_t * ring);
+
+/**
+ * Take the oldest completion. Returns false if there are none.
+ */
+bool ring_pop(ring_t * ring, ring_cqe_t * cqe);
+
+#endif
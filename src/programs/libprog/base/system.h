@@ -2,6 +2,7 @@
 #define __SYSTEM_H__
 
 #include <stdtype.h>
+#include <anlock.h>
 
 typedef struct {
   uint64_t reserved;
@@ -17,13 +18,30 @@ typedef struct {
   uint64_t flags;
 } pgf_t;
 
+#define SYSCALL_STAT_BUCKETS 0xc
+#define SYSCALL_STAT_MIN_SHIFT 7
+#define SYSCALL_STAT_RESET 1
+
+/**
+ * The counters for one syscall number. Bucket i of the histogram counts calls
+ * which took less than 2^(i + SYSCALL_STAT_MIN_SHIFT) TSC cycles, and the last
+ * bucket counts everything longer. `calls` also counts calls which never
+ * returned (e.g. exit), so the buckets may add up to less.
+ */
+typedef struct {
+  uint64_t calls;
+  uint64_t cycles;
+  uint32_t buckets[SYSCALL_STAT_BUCKETS];
+} __attribute__((packed)) syscall_stat_t;
+
 /**
  * Prints the NULL-terminated string `buffer`.
  */
 void sys_print(const char * buffer);
 
 /**
- * Returns the system time in microseconds
+ * Returns the system time in microseconds. This reads the TSC through the
+ * task info page when the kernel found it invariant, so it does not trap.
  */
 uint64_t sys_get_time();
 
@@ -115,7 +133,8 @@ uint64_t sys_out(uint64_t pin, uint64_t val, uint64_t size);
 void sys_color(uint8_t color);
 
 /**
- * Launch a new task and return an opened socket to it.
+ * Launch a new task and return an opened socket to it. The new task sets up
+ * its TLS before calling `code`, and exits when `code` returns.
  */
 uint64_t sys_fork(uint64_t code);
 
@@ -174,7 +193,9 @@ bool sys_invlpg(uint64_t fd);
 
 /**
  * Launch a thread which will automatically exit when you return. The stack on
- * this function call will be 16-byte aligned like the Mac ABI says.
+ * this function call will be 16-byte aligned like the Mac ABI says. The thread
+ * starts without a TLS block, so it must call tls_set() before touching any
+ * `__thread` variable (pthread_create() does this for you).
  */
 void sys_launch_thread(void (*)(void *), void * arg);
 
@@ -189,12 +210,12 @@ uint64_t sys_thread_id();
 void sys_unsleep(uint64_t threadId);
 
 /**
- * Returns the current UID.
+ * Returns the current UID, read from the task info page.
  */
 uint64_t sys_self_uid();
 
 /**
- * Returns the current PID.
+ * Returns the current PID, read from the task info page.
  */
 uint64_t sys_self_pid();
 
@@ -271,4 +292,84 @@ bool sys_batch_vmmap(uint64_t fd, uint64_t * buf, uint64_t count);
 
 void sys_clear_unsleep();
 
+/**
+ * Read a batch of page table entries from a remote task's address space,
+ * clearing their accessed flags. The first item in `buf` is the starting
+ * virtual page index; the entries are written to the items after it. At most
+ * 0x1ff pages may be sampled at once.
+ */
+bool sys_batch_vmsample(uint64_t fd, uint64_t * buf, uint64_t count);
+
+/**
+ * Reads the kernel's lock statistics for at most `max` lock names, sorted by
+ * the time spent waiting for them. Returns the number of entries read. The
+ * kernel only keeps statistics when it is built with LOCKSTAT=1.
+ */
+uint64_t sys_lockstat(anlock_stat_t * stats, uint64_t max);
+
+/**
+ * If the aligned word at `ptr` equals `expected`, sleep until sys_futex_wake()
+ * is called on it or `usec` microseconds pass (0 means forever). Returns true
+ * only if a wake ended the wait; callers must check their condition again
+ * either way.
+ */
+bool sys_futex_wait(uint64_t * ptr, uint64_t expected, uint64_t usec);
+
+/**
+ * Wake up to `count` threads waiting on `ptr`. Returns the number woken.
+ */
+uint64_t sys_futex_wake(uint64_t * ptr, uint64_t count);
+
+/**
+ * If the word at `ptr` equals `expected`, wake one thread waiting on it and
+ * move the rest to wait on `target` instead. Returns the number of threads
+ * woken or moved, or UINT64_MAX if the value did not match.
+ */
+uint64_t sys_futex_requeue(uint64_t * ptr,
+                           uint64_t expected,
+                           uint64_t * target);
+
+/**
+ * Set the FS base of the calling thread, which the kernel restores whenever
+ * the thread runs. Returns false for an address outside of the lower half.
+ */
+bool sys_set_fs_base(void * base);
+
+/**
+ * Take the priority inheritance futex at `ptr`. Its word is 0 when it is free
+ * and otherwise holds the owner's sys_thread_id() plus one, with the top bit
+ * set while other threads wait. The owner runs with at least the priority of
+ * the threads it blocks. Returns true once the caller owns the word; on false,
+ * look at the word again.
+ */
+bool sys_futex_lock_pi(uint64_t * ptr);
+
+/**
+ * Release a priority inheritance futex the caller owns, handing it to the
+ * highest-priority waiter. Returns false if the caller did not own it.
+ */
+bool sys_futex_unlock_pi(uint64_t * ptr);
+
+/**
+ * Set the calling thread's scheduling priority, from 0 (the default) to 0x10.
+ * Only root may go above 0. Runnable threads with a higher priority always run
+ * first.
+ */
+bool sys_set_priority(uint64_t priority);
+
+/**
+ * Run the operations queued in a submission ring; see base/ring.h. Returns
+ * the number of operations which were run.
+ */
+uint64_t sys_ring_enter(void * ring);
+
+/**
+ * Reads the kernel's syscall counters, summed over every CPU, into `stats`,
+ * indexed by syscall number. At most `max` entries are read; returns the
+ * number read. Pass SYSCALL_STAT_RESET in `flags` to clear the counters after
+ * reading them, which only root may do. Calls which the kernel answers
+ * without leaving the task's address space are not counted.
+ */
+uint64_t sys_syscallstat(syscall_stat_t * stats, uint64_t max, uint64_t flags);
+
 #endif
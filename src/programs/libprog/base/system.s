@@ -1,5 +1,7 @@
 bits 64
 
+extern tls_initialize
+
 section .text
 
 global sys_print
@@ -9,8 +11,8 @@ sys_print:
   syscall
   ret
 
-global sys_get_time
-sys_get_time:
+global __sys_get_time
+__sys_get_time:
   mov rdi, 1
   syscall
   ret
@@ -128,10 +130,16 @@ sys_color:
 
 global sys_fork
 sys_fork:
-  mov rsi, rdi
+  mov rdx, rdi
+  mov rsi, .forkStub
   mov rdi, 0x12
   syscall
   ret
+.forkStub:
+  mov rbx, rdi
+  call tls_initialize
+  call rbx
+  jmp sys_exit
 
 global sys_mem_usage
 sys_mem_usage:
@@ -225,18 +233,6 @@ sys_unsleep:
   syscall
   ret
 
-global sys_self_uid
-sys_self_uid:
-  mov rdi, 0x1f
-  syscall
-  ret
-
-global sys_self_pid
-sys_self_pid:
-  mov rdi, 0x20
-  syscall
-  ret
-
 global sys_vmread
 sys_vmread:
   mov rsi, rdi
@@ -337,3 +333,89 @@ sys_clear_unsleep:
   syscall
   ret
 
+global sys_batch_vmsample
+sys_batch_vmsample:
+  mov r8, rdx
+  mov rdx, rsi
+  mov rsi, rdi
+  mov rdi, 0x2f
+  syscall
+  ret
+
+global sys_lockstat
+sys_lockstat:
+  mov rdx, rsi
+  mov rsi, rdi
+  mov rdi, 0x30
+  syscall
+  ret
+
+global sys_futex_wait
+sys_futex_wait:
+  mov r8, rdx
+  mov rdx, rsi
+  mov rsi, rdi
+  mov rdi, 0x31
+  syscall
+  ret
+
+global sys_futex_wake
+sys_futex_wake:
+  mov rdx, rsi
+  mov rsi, rdi
+  mov rdi, 0x32
+  syscall
+  ret
+
+global sys_set_fs_base
+sys_set_fs_base:
+  mov rsi, rdi
+  mov rdi, 0x33
+  syscall
+  ret
+
+global sys_futex_requeue
+sys_futex_requeue:
+  mov r8, rdx
+  mov rdx, rsi
+  mov rsi, rdi
+  mov rdi, 0x34
+  syscall
+  ret
+
+global sys_futex_lock_pi
+sys_futex_lock_pi:
+  mov rsi, rdi
+  mov rdi, 0x35
+  syscall
+  ret
+
+global sys_futex_unlock_pi
+sys_futex_unlock_pi:
+  mov rsi, rdi
+  mov rdi, 0x36
+  syscall
+  ret
+
+global sys_set_priority
+sys_set_priority:
+  mov rsi, rdi
+  mov rdi, 0x37
+  syscall
+  ret
+
+global sys_ring_enter
+sys_ring_enter:
+  mov rsi, rdi
+  mov rdi, 0x38
+  syscall
+  ret
+
+global sys_syscallstat
+sys_syscallstat:
+  mov r8, rdx
+  mov rdx, rsi
+  mov rsi, rdi
+  mov rdi, 0x39
+  syscall
+  ret
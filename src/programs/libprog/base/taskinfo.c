@@ -0,0 +1,27 @@
+#include "taskinfo.h"
+#include "system.h"
+
+uint64_t __sys_get_time();
+
+const taskinfo_t * taskinfo_get() {
+  return (const taskinfo_t *)(TASKINFO_PAGE << 12);
+}
+
+uint64_t sys_self_pid() {
+  return taskinfo_get()->pid;
+}
+
+uint64_t sys_self_uid() {
+  return taskinfo_get()->uid;
+}
+
+uint64_t sys_get_time() {
+  const taskinfo_t * info = taskinfo_get();
+  if (!info->tscMult) return __sys_get_time();
+
+  uint32_t lower, upper;
+  __asm__ __volatile__("rdtsc" : "=a" (lower), "=d" (upper));
+  uint64_t ticks = (((uint64_t)upper << 32) | lower) - info->tscBase;
+  unsigned __int128 nanos = (unsigned __int128)ticks * info->tscMult;
+  return (uint64_t)(nanos >> 32) / 1000;
+}
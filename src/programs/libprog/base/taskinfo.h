@@ -0,0 +1,26 @@
+#ifndef __TASKINFO_H__
+#define __TASKINFO_H__
+
+#include <stdint.h>
+
+/**
+ * The kernel maps this read-only page into every task; the layout must match
+ * src/syscall/taskinfo.h. sys_self_pid() and sys_get_time() read it instead
+ * of trapping into the kernel.
+ */
+
+#define TASKINFO_PAGE 0xfffff
+
+typedef struct {
+  uint64_t pid;
+  uint64_t uid;
+  uint64_t tscBase;
+  uint64_t tscMult; // 0 if the TSC cannot be used as a clock
+} __attribute__((packed)) taskinfo_t;
+
+/**
+ * Returns the calling task's info page.
+ */
+const taskinfo_t * taskinfo_get();
+
+#endif
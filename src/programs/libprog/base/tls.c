@@ -0,0 +1,87 @@
+#include "tls.h"
+#include "system.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// the first thread's block comes from here when it fits, so that starting a
+// program does not require a heap
+#define TLS_INITIAL_BUFFER 0x200
+
+typedef struct tls_tcb tls_tcb_t;
+
+struct tls_tcb {
+  tls_tcb_t * self; // %fs:0, as the ABI requires
+  void * buffer; // the allocation this block was carved from, or NULL
+};
+
+// symbols from linker.ld
+extern char _tdata_start[];
+extern char _tdata_end[];
+extern char _tls_size[];
+extern char _tls_align[];
+
+static char initialBuffer[TLS_INITIAL_BUFFER] __attribute__((aligned(16)));
+
+static uint64_t _block_align();
+static uint64_t _block_size();
+static tls_tcb_t * _tls_setup(void * buffer);
+
+void * tls_create() {
+  uint64_t len = _block_size() + _block_align() + sizeof(tls_tcb_t);
+  void * buffer = malloc(len);
+  if (!buffer) return NULL;
+  tls_tcb_t * tcb = _tls_setup(buffer);
+  tcb->buffer = buffer;
+  return tcb;
+}
+
+void tls_destroy(void * tp) {
+  tls_tcb_t * tcb = tp;
+  if (tcb->buffer) free(tcb->buffer);
+}
+
+void tls_set(void * tp) {
+  sys_set_fs_base(tp);
+}
+
+void tls_initialize() {
+  uint64_t len = _block_size() + _block_align() + sizeof(tls_tcb_t);
+  if (len > TLS_INITIAL_BUFFER) {
+    void * tp = tls_create();
+    if (!tp) sys_abort();
+    tls_set(tp);
+  } else {
+    tls_set(_tls_setup(initialBuffer));
+  }
+}
+
+static uint64_t _block_align() {
+  uint64_t align = (uint64_t)_tls_align;
+  return align < sizeof(void *) ? sizeof(void *) : align;
+}
+
+static uint64_t _block_size() {
+  // the linker places variables relative to the size rounded up to the
+  // segment's own alignment, which may be smaller than _block_align()
+  uint64_t align = (uint64_t)_tls_align;
+  if (!align) align = 1;
+  return ((uint64_t)_tls_size + align - 1) & ~(align - 1);
+}
+
+static tls_tcb_t * _tls_setup(void * buffer) {
+  uint64_t align = _block_align();
+  uint64_t size = _block_size();
+  uint64_t dataSize = (uint64_t)(_tdata_end - _tdata_start);
+
+  // the thread pointer must be aligned like the block that sits beneath it
+  uint64_t tp = ((uint64_t)buffer + size + align - 1) & ~(align - 1);
+  char * block = (char *)(tp - size);
+  memcpy(block, _tdata_start, dataSize);
+  bzero(block + dataSize, size - dataSize);
+
+  tls_tcb_t * tcb = (tls_tcb_t *)tp;
+  tcb->self = tcb;
+  tcb->buffer = NULL;
+  return tcb;
+}
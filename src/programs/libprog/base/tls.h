@@ -0,0 +1,37 @@
+#ifndef __TLS_H__
+#define __TLS_H__
+
+#include <stdint.h>
+
+/**
+ * Thread-local storage for `__thread` variables, using the x86-64 ELF layout:
+ * the FS base points to a thread control block whose first word points to
+ * itself, and the TLS block sits directly below it. The linker script exports
+ * the image and size of the block.
+ */
+
+/**
+ * Allocate a new TLS block initialized from the program's .tdata and .tbss.
+ * Returns the thread pointer to pass to tls_set(), or NULL if no memory was
+ * available.
+ */
+void * tls_create();
+
+/**
+ * Free a block returned by tls_create(). The block must not be in use by any
+ * running thread.
+ */
+void tls_destroy(void * tp);
+
+/**
+ * Make `tp` the TLS block of the calling thread.
+ */
+void tls_set(void * tp);
+
+/**
+ * Create and install the TLS block of the first thread of a task. This is
+ * called by each program's entry point and by the stub sys_fork() launches.
+ */
+void tls_initialize();
+
+#endif
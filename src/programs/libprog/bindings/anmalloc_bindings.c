@@ -1,6 +1,10 @@
 #include "include/anmalloc_bindings.h"
 #include <unistd.h>
 
+// every thread owns 0x100 pages of stack starting at this page, indexed by
+// the same number that sys_thread_id() returns
+#define BINDINGS_USER_STACKS_PAGE 0x200000
+
 void * anmalloc_sbrk(intptr_t incr) {
   return sbrk(incr);
 }
@@ -17,3 +21,8 @@ void anmalloc_unlock(anmalloc_lock_t * lock) {
   basic_lock_unlock(lock);
 }
 
+uint64_t anmalloc_thread_id() {
+  uint64_t rsp;
+  __asm__("mov %%rsp, %0" : "=r" (rsp));
+  return ((rsp >> 12) - BINDINGS_USER_STACKS_PAGE) >> 8;
+}
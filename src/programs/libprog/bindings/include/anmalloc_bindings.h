@@ -10,4 +10,5 @@ int anmalloc_brk(const void * addr);
 
 void anmalloc_lock(anmalloc_lock_t * lock);
 void anmalloc_unlock(anmalloc_lock_t * lock);
+uint64_t anmalloc_thread_id();
 
@@ -1,6 +1,7 @@
-#include <pthread.h>
+#include <errno.h>
+
+static __thread int errnoValue = 0;
 
 int * __errno() {
-  return &pthread_current()->errno;
+  return &errnoValue;
 }
-
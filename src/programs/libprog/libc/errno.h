@@ -8,6 +8,7 @@ int * __errno();
 #define	EPERM		1		/* Operation not permitted */
 #define	EDEADLK		11		/* Resource deadlock avoided */
 #define	ENOMEM		12		/* Cannot allocate memory */
+#define	EBUSY		16		/* Device or resource busy */
 #define	EINVAL		22		/* Invalid argument */
 #define EAGAIN          35              /* Resource temporarily unavailable */
 #define ENOTSUP         45              /* Operation not supported */
@@ -6,7 +6,7 @@ void free(void * buf) {
 }
 
 void * malloc(size_t size) {
-  return anmalloc_alloc((uint64_t)size);
+  return anmalloc_alloc_from((uint64_t)size, __builtin_return_address(0));
 }
 
 int posix_memalign(void ** ptr, size_t align, size_t size) {
@@ -3,13 +3,14 @@
 #include <system.h>
 #include <stdlib.h>
 #include <strings.h>
+#include <anmalloc/anmalloc.h>
+#include <base/tls.h>
 
-static pthread_t * runningThreads __attribute__((aligned(8))) = NULL;
-static uint64_t runningCount __attribute__((aligned(8))) = 0;
-static basic_lock_t runningLock = BASIC_LOCK_INITIALIZER;
+// the first thread of a task was not started by pthread_create()
+static struct pthread mainThread = {.isRunning = true, .isReferenced = true};
+static __thread pthread_t currentThread = NULL;
 
-static void _push_thread(pthread_t thread);
-static void _pop_thread(pthread_t thread);
+static void _free_thread(pthread_t thread);
 static void _thread_entry(pthread_t thread);
 
 int pthread_attr_init(pthread_attr_t * attr) {
@@ -39,6 +40,10 @@ int pthread_create(pthread_t * thread,
   pthread_t val = malloc(sizeof(struct pthread));
   if (!val) return ENOMEM;
   bzero(val, sizeof(struct pthread));
+  if (!(val->tls = tls_create())) {
+    free(val);
+    return ENOMEM;
+  }
   val->isReferenced = attr ? !attr->detachState : 1;
   val->isRunning = true;
   val->arg = arg;
@@ -52,8 +57,7 @@ int pthread_join(pthread_t thread, void ** retValue) {
   basic_lock_lock(&thread->lock);
   if (!thread->isRunning) {
     if (retValue) *retValue = thread->retValue;
-    _pop_thread(thread);
-    free(thread);
+    _free_thread(thread);
     return 0;
   }
   thread->isJoining = true;
@@ -64,8 +68,7 @@ int pthread_join(pthread_t thread, void ** retValue) {
     basic_lock_lock(&thread->lock);
     if (!thread->isRunning) {
       if (retValue) *retValue = thread->retValue;
-      _pop_thread(thread);
-      free(thread);
+      _free_thread(thread);
       return 0;
     }
     basic_lock_unlock(&thread->lock);
@@ -78,8 +81,7 @@ int pthread_detach(pthread_t thread) {
   basic_lock_lock(&thread->lock);
   thread->isReferenced = false;
   if (!thread->isRunning) {
-    _pop_thread(thread);
-    free(thread);
+    _free_thread(thread);
   } else {
     basic_lock_unlock(&thread->lock);
   }
@@ -92,8 +94,9 @@ void pthread_exit(void * value) {
   basic_lock_lock(&cur->lock);
   cur->retValue = value;
   if (!cur->isReferenced) {
-    _pop_thread(cur);
-    free(cur);
+    // nothing may touch a __thread variable once our own block is gone
+    _free_thread(cur);
+    anmalloc_thread_flush();
     sys_thread_exit();
   }
 
@@ -103,62 +106,28 @@ void pthread_exit(void * value) {
   }
   basic_lock_unlock(&cur->lock);
 
+  anmalloc_thread_flush();
   sys_thread_exit();
 }
 
 pthread_t pthread_current() {
-  basic_lock_lock(&runningLock);
-  uint64_t i;
-  uint64_t selfId = sys_thread_id();
-  for (i = 0; i < runningCount; i++) {
-    if (runningThreads[i]->threadId == selfId) {
-      if (!runningThreads[i]->isRunning) continue;
-      basic_lock_unlock(&runningLock);
-      return runningThreads[i];
-    }
-  }
-  basic_lock_unlock(&runningLock);
-  return NULL;
+  return currentThread ? currentThread : &mainThread;
 }
 
-static void _push_thread(pthread_t thread) {
-  basic_lock_lock(&runningLock);
-  runningCount++;
-  runningThreads = realloc(runningThreads, sizeof(pthread_t) * runningCount);
-  runningThreads[runningCount - 1] = thread;
-  basic_lock_unlock(&runningLock);
+pthread_t pthread_self() {
+  return pthread_current();
 }
 
-static void _pop_thread(pthread_t thread) {
-  basic_lock_lock(&runningLock);
-  if (runningCount == 1) {
-    runningCount = 0;
-    free(runningThreads);
-    runningThreads = NULL;
-    basic_lock_unlock(&runningLock);
-    return;
-  }
-
-  bool found = false;
-  uint64_t i;
-  for (i = 0; i < runningCount; i++) {
-    if (runningThreads[i] == thread) {
-      found = true;
-    } else if (found) {
-      runningThreads[i - 1] = runningThreads[i];
-    }
-  }
-
-  runningCount--;
-  runningThreads = realloc(runningThreads, sizeof(pthread_t) * runningCount);
-
-  basic_lock_unlock(&runningLock);
+static void _free_thread(pthread_t thread) {
+  if (thread == &mainThread) return;
+  tls_destroy(thread->tls);
+  free(thread);
 }
 
 static void _thread_entry(pthread_t thread) {
+  tls_set(thread->tls);
+  currentThread = thread;
   thread->threadId = sys_thread_id();
-  _push_thread(thread);
   void * val = thread->method(thread->arg);
   pthread_exit(val);
 }
-
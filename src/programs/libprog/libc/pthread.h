@@ -5,13 +5,14 @@
 #include <stdbool.h>
 #include <pthread_mutex.h>
 #include <pthread_cond.h>
+#include <pthread_rwlock.h>
 
 #define PTHREAD_CREATE_JOINABLE 0
 #define PTHREAD_CREATE_DETACHED 1
 
 struct pthread {
   // only to be modified on the thread in question
-  int errno, reserved1;
+  void * tls; // thread pointer of the thread's TLS block
   void * arg;
   void * (* method)(void *);
 
@@ -46,6 +47,12 @@ int pthread_join(pthread_t thread, void ** retValue);
 int pthread_detach(pthread_t thread);
 void pthread_exit(void * value);
 
+/**
+ * Returns the calling thread. The first thread of a task gets a static
+ * structure which can never be joined or detached. This is a single load from
+ * TLS and never makes a syscall.
+ */
 pthread_t pthread_current();
+pthread_t pthread_self();
 
 #endif
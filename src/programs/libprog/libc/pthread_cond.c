@@ -1,10 +1,12 @@
 #include "pthread_cond.h"
 #include <system.h>
 #include <strings.h>
-#include <anlock.h>
+#include <errno.h>
 #include <assert.h>
 
-static bool _cond_contains(pthread_cond_t * cond);
+static int _cond_wait(pthread_cond_t * c,
+                      pthread_mutex_t * m,
+                      uint64_t deadline);
 
 int pthread_condattr_init(pthread_condattr_t * attr) {
   return 0;
@@ -20,68 +22,68 @@ int pthread_cond_init(pthread_cond_t * c, pthread_condattr_t * attr) {
 }
 
 int pthread_cond_wait(pthread_cond_t * c, pthread_mutex_t * m) {
-  // put ourselves in the queue
-  _th_queue_t th;
-  th.next = NULL;
-  th.threadId = sys_thread_id();
-  anlock_lock(&c->fieldLock);
-  if (c->last) {
-    c->last->next = &th;
-    c->last = &th;
-  } else {
-    c->last = (c->first = &th);
-  }
-  anlock_unlock(&c->fieldLock);
-  pthread_mutex_unlock(m);
-  while (1) {
-    sys_sleep(UINT64_MAX);
-    if (!_cond_contains(c)) break;
-  }
-  pthread_mutex_lock(m);
-  return 0;
+  return _cond_wait(c, m, 0);
+}
+
+int pthread_cond_timedwait(pthread_cond_t * c,
+                           pthread_mutex_t * m,
+                           const struct timespec * abstime) {
+  uint64_t deadline = (uint64_t)abstime->tv_sec * 1000000L
+    + (uint64_t)abstime->tv_nsec / 1000L;
+  if (!deadline) deadline = 1; // 0 means no deadline to _cond_wait()
+  return _cond_wait(c, m, deadline);
 }
 
 int pthread_cond_signal(pthread_cond_t * c) {
-  anlock_lock(&c->fieldLock);
-  if (c->first) {
-    _th_queue_t * first = c->first;
-    if (!(c->first = first->next)) {
-      c->last = NULL;
-    }
-    sys_unsleep(first->threadId);
-  }
-  anlock_unlock(&c->fieldLock);
+  if (!c->waiters) return 0;
+  __sync_fetch_and_add(&c->seq, 1);
+  sys_futex_wake(&c->seq, 1);
   return 0;
 }
 
 int pthread_cond_broadcast(pthread_cond_t * c) {
-  anlock_lock(&c->fieldLock);
-  while (c->first) {
-    sys_unsleep(c->first->threadId);
-    c->first = c->first->next;
+  if (!c->waiters) return 0;
+  uint64_t seq = __sync_add_and_fetch(&c->seq, 1);
+  if (c->mutex->protocol == PTHREAD_PRIO_INHERIT) {
+    // the kernel hands PI futexes over itself, so waiters cannot be requeued
+    sys_futex_wake(&c->seq, UINT64_MAX);
+    return 0;
+  }
+  uint64_t res = sys_futex_requeue(&c->seq, seq, &c->mutex->lock.state);
+  if (res == UINT64_MAX) {
+    // somebody bumped the sequence after us; fall back to waking everyone
+    sys_futex_wake(&c->seq, UINT64_MAX);
   }
-  c->first = (c->last = NULL);
-  anlock_unlock(&c->fieldLock);
   return 0;
 }
 
 int pthread_cond_destroy(pthread_cond_t * c) {
-  assert(c->first == NULL);
-  assert(c->last == NULL);
+  assert(c->waiters == 0);
   return 0;
 }
 
-static bool _cond_contains(pthread_cond_t * cond) {
-  anlock_lock(&cond->fieldLock);
-  _th_queue_t * node = cond->first;
-  while (node) {
-    if (node->threadId == sys_thread_id()) {
-      anlock_unlock(&cond->fieldLock);
-      return true;
+static int _cond_wait(pthread_cond_t * c,
+                      pthread_mutex_t * m,
+                      uint64_t deadline) {
+  c->mutex = m;
+  c->waiters++;
+  uint64_t seq = c->seq;
+  pthread_mutex_unlock(m);
+
+  int result = 0;
+  if (!deadline) {
+    sys_futex_wait(&c->seq, seq, 0);
+  } else {
+    uint64_t now = sys_get_time();
+    if (now >= deadline) {
+      result = ETIMEDOUT;
+    } else if (!sys_futex_wait(&c->seq, seq, deadline - now)) {
+      if (c->seq == seq && sys_get_time() >= deadline) result = ETIMEDOUT;
     }
-    node = node->next;
   }
-  anlock_unlock(&cond->fieldLock);
-  return false;
-}
 
+  // we may have been requeued onto the mutex behind other sleepers
+  __pthread_mutex_cond_lock(m);
+  c->waiters--;
+  return result;
+}
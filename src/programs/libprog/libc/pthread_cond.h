@@ -2,14 +2,20 @@
 #define __PTHREAD_COND_H__
 
 #include "pthread_mutex.h"
+#include <time.h>
 
-#define PTHREAD_COND_INITIALIZER {NULL, NULL, 0}
+#define PTHREAD_COND_INITIALIZER {0, 0, NULL}
 
+/**
+ * Waiters sleep on `seq` with a futex, and every signal or broadcast bumps it.
+ * A broadcast wakes one waiter and requeues the rest onto the mutex, so they
+ * are woken one at a time as the mutex is passed along.
+ */
 typedef struct {
-  _th_queue_t * first;
-  _th_queue_t * last;
-  uint64_t fieldLock;
-} __attribute__((packed)) pthread_cond_t;
+  uint64_t seq;
+  uint64_t waiters; // changed only while holding the mutex
+  pthread_mutex_t * mutex; // the mutex the waiters passed in
+} pthread_cond_t;
 
 typedef struct {
 } __attribute__((packed)) pthread_condattr_t;
@@ -19,6 +25,14 @@ int pthread_condattr_destroy(pthread_condattr_t * attr);
 
 int pthread_cond_init(pthread_cond_t * c, pthread_condattr_t * attr);
 int pthread_cond_wait(pthread_cond_t * c, pthread_mutex_t * m);
+
+/**
+ * Like pthread_cond_wait(), but returns ETIMEDOUT once `abstime` passes.
+ * `abstime` is measured on the same clock as sys_get_time().
+ */
+int pthread_cond_timedwait(pthread_cond_t * c,
+                           pthread_mutex_t * m,
+                           const struct timespec * abstime);
 int pthread_cond_signal(pthread_cond_t * c);
 int pthread_cond_broadcast(pthread_cond_t * c);
 int pthread_cond_destroy(pthread_cond_t * c);
@@ -1,11 +1,21 @@
 #include <pthread_mutex.h>
+#include <pthread.h>
 #include <errno.h>
 #include <strings.h>
-#include <system.h>
 #include <assert.h>
+#include <system.h>
+
+static __thread uint64_t piThreadId = 0;
+
+static void _adaptive_lock(pthread_mutex_t * mutex);
+static uint64_t _pi_thread_id();
+static void _pi_lock(pthread_mutex_t * mutex);
+static bool _pi_trylock(pthread_mutex_t * mutex);
+static void _pi_unlock(pthread_mutex_t * mutex);
 
 int pthread_mutexattr_init(pthread_mutexattr_t * attr) {
   attr->type = 0;
+  attr->protocol = PTHREAD_PRIO_NONE;
   return 0;
 }
 
@@ -24,15 +34,30 @@ int pthread_mutexattr_settype(pthread_mutexattr_t * attr, int type) {
   return 0;
 }
 
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t * attr,
+                                  int * protocol) {
+  *protocol = (int)attr->protocol;
+  return 0;
+}
+
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t * attr, int protocol) {
+  if (protocol < 0 || protocol > 1) return EINVAL;
+  attr->protocol = protocol;
+  return 0;
+}
+
 int pthread_mutex_init(pthread_mutex_t * mutex,
                        const pthread_mutexattr_t * attr) {
   bzero(mutex, sizeof(pthread_mutex_t));
-  if (attr) mutex->type = attr->type;
+  if (attr) {
+    mutex->type = attr->type;
+    mutex->protocol = attr->protocol;
+  }
   return 0;
 }
 
 int pthread_mutex_lock(pthread_mutex_t * mutex) {
-  uint64_t threadId = sys_thread_id() + 1;
+  uint64_t threadId = (uint64_t)pthread_current();
   if (mutex->holdingThread == threadId) {
     if (mutex->type != PTHREAD_MUTEX_RECURSIVE) {
       return EDEADLK;
@@ -41,25 +66,115 @@ int pthread_mutex_lock(pthread_mutex_t * mutex) {
     return 0;
   }
 
-  basic_lock_lock(&mutex->lock);
+  if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+    _pi_lock(mutex);
+  } else {
+    _adaptive_lock(mutex);
+  }
+  mutex->holdingThread = threadId;
+  mutex->holdingCount = 1;
+  return 0;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t * mutex) {
+  uint64_t threadId = (uint64_t)pthread_current();
+  if (mutex->holdingThread == threadId) {
+    if (mutex->type != PTHREAD_MUTEX_RECURSIVE) {
+      return EDEADLK;
+    }
+    mutex->holdingCount++;
+    return 0;
+  }
+
+  if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+    if (!_pi_trylock(mutex)) return EBUSY;
+  } else if (!basic_lock_trylock(&mutex->lock)) {
+    return EBUSY;
+  }
   mutex->holdingThread = threadId;
   mutex->holdingCount = 1;
   return 0;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t * mutex) {
-  if (mutex->holdingThread != sys_thread_id() + 1) {
+  if (mutex->holdingThread != (uint64_t)pthread_current()) {
     return EPERM;
   }
   if (!--mutex->holdingCount) {
     mutex->holdingThread = 0;
-    basic_lock_unlock(&mutex->lock);
+    if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+      _pi_unlock(mutex);
+    } else {
+      basic_lock_unlock(&mutex->lock);
+    }
   }
   return 0;
 }
 
+int __pthread_mutex_cond_lock(pthread_mutex_t * mutex) {
+  // condition variables never requeue onto PI mutexes
+  if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+    _pi_lock(mutex);
+  } else {
+    basic_lock_lock_contended(&mutex->lock);
+  }
+  mutex->holdingThread = (uint64_t)pthread_current();
+  mutex->holdingCount = 1;
+  return 0;
+}
+
 int pthread_mutex_destroy(pthread_mutex_t * mutex) {
   assert(mutex->holdingCount == 0);
   return 0;
 }
 
+static void _adaptive_lock(pthread_mutex_t * mutex) {
+  if (basic_lock_trylock(&mutex->lock)) return;
+
+  // poll up to twice as long as recent acquisitions have needed
+  uint64_t limit = mutex->spins * 2 + 0x10;
+  if (limit > PTHREAD_MUTEX_SPIN_MAX) limit = PTHREAD_MUTEX_SPIN_MAX;
+  uint64_t count = 0;
+  while (1) {
+    if (count++ >= limit) {
+      basic_lock_lock(&mutex->lock);
+      break;
+    }
+    __asm__ __volatile__("pause" : : : "memory");
+    if (*((volatile uint64_t *)&mutex->lock.state)) continue;
+    if (basic_lock_trylock(&mutex->lock)) break;
+  }
+  // the average is only a heuristic, so racing updates to it are harmless
+  int64_t delta = ((int64_t)count - (int64_t)mutex->spins) / 8;
+  mutex->spins += delta;
+}
+
+static uint64_t _pi_thread_id() {
+  // the kernel identifies the owner of a PI futex by its thread ID plus one
+  if (!piThreadId) piThreadId = sys_thread_id() + 1;
+  return piThreadId;
+}
+
+static void _pi_lock(pthread_mutex_t * mutex) {
+  uint64_t tid = _pi_thread_id();
+  if (__sync_bool_compare_and_swap(&mutex->lock.state, 0, tid)) return;
+  while (!sys_futex_lock_pi(&mutex->lock.state)) {
+    // we were not handed the lock; it may have been released meanwhile
+    uint64_t state = *((volatile uint64_t *)&mutex->lock.state);
+    if ((state & 0xffffffff) == tid) break;
+    if (state) continue;
+    if (__sync_bool_compare_and_swap(&mutex->lock.state, 0, tid)) break;
+  }
+}
+
+static bool _pi_trylock(pthread_mutex_t * mutex) {
+  uint64_t tid = _pi_thread_id();
+  return __sync_bool_compare_and_swap(&mutex->lock.state, 0, tid);
+}
+
+static void _pi_unlock(pthread_mutex_t * mutex) {
+  uint64_t tid = _pi_thread_id();
+  // the waiters bit makes this fail, so the kernel can pick the next owner
+  if (__sync_bool_compare_and_swap(&mutex->lock.state, tid, 0)) return;
+  sys_futex_unlock_pi(&mutex->lock.state);
+}
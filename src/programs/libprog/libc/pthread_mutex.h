@@ -9,19 +9,28 @@
 #define PTHREAD_MUTEX_NORMAL 0
 #define PTHREAD_MUTEX_ERRORCHECK 1
 #define PTHREAD_MUTEX_RECURSIVE 2
-#define PTHREAD_MUTEX_INITIALIZER {BASIC_LOCK_INITIALIZER, 0, 0, 0}
+#define PTHREAD_MUTEX_INITIALIZER {BASIC_LOCK_INITIALIZER, 0, 0, 0, 0, 0}
+
+#define PTHREAD_PRIO_NONE 0
+#define PTHREAD_PRIO_INHERIT 1
+
+// upper bound on how many times a contended lock polls before sleeping
+#define PTHREAD_MUTEX_SPIN_MAX 0x100
 
 struct pthread_mutex {
   basic_lock_t lock; // seize this to serialize holding of the lock
 
-  uint64_t holdingThread; // thread ID holding the lock, + 1; 0 is unheld
+  uint64_t holdingThread; // pthread_t holding the lock; 0 is unheld
   uint64_t holdingCount; // number of levels of lock (0 = unlocked)
 
   int64_t type;
-} __attribute__((packed));
+  uint64_t spins; // running average of polls it took to get the lock
+  int64_t protocol; // with PTHREAD_PRIO_INHERIT, lock.state is a PI futex
+};
 
 struct pthread_mutexattr {
   int64_t type;
+  int64_t protocol;
 } __attribute__((packed));
 
 typedef struct pthread_mutex pthread_mutex_t;
@@ -31,11 +40,34 @@ int pthread_mutexattr_init(pthread_mutexattr_t * attr);
 int pthread_mutexattr_destroy(pthread_mutexattr_t * attr);
 int pthread_mutexattr_gettype(const pthread_mutexattr_t * attr, int * type);
 int pthread_mutexattr_settype(pthread_mutexattr_t * attr, int type);
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t * attr,
+                                  int * protocol);
+
+/**
+ * With PTHREAD_PRIO_INHERIT, a thread holding the mutex runs with at least the
+ * priority of the threads waiting for it, so a low-priority holder cannot be
+ * starved by medium-priority work while a high-priority thread waits.
+ */
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t * attr, int protocol);
 
 int pthread_mutex_init(pthread_mutex_t * mutex,
                        const pthread_mutexattr_t * attr);
+
+/**
+ * Lock a mutex. A contended mutex is polled for a while before the caller
+ * sleeps, since it is usually released soon by a thread on another CPU. The
+ * number of polls adapts to how long the mutex has recently taken to become
+ * free.
+ */
 int pthread_mutex_lock(pthread_mutex_t * mutex);
+int pthread_mutex_trylock(pthread_mutex_t * mutex);
 int pthread_mutex_unlock(pthread_mutex_t * mutex);
 int pthread_mutex_destroy(pthread_mutex_t * mutex);
 
+/**
+ * Lock a mutex from pthread_cond_wait(), keeping it marked contended so that
+ * waiters a broadcast requeued onto it are woken in turn.
+ */
+int __pthread_mutex_cond_lock(pthread_mutex_t * mutex);
+
 #endif
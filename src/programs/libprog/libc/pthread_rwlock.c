@@ -0,0 +1,120 @@
+#include "pthread_rwlock.h"
+#include <system.h>
+#include <strings.h>
+#include <errno.h>
+#include <assert.h>
+
+#define RWLOCK_READERS 0xffffffffL
+#define RWLOCK_WRITER (1L << 32)
+#define RWLOCK_WAITER (1L << 33) // one unit of the waiting writer count
+
+static bool _read_blocked(uint64_t state);
+static void _wake_writer(pthread_rwlock_t * lock);
+static void _wake_readers(pthread_rwlock_t * lock);
+
+int pthread_rwlock_init(pthread_rwlock_t * lock,
+                        const pthread_rwlockattr_t * attr) {
+  bzero(lock, sizeof(pthread_rwlock_t));
+  return 0;
+}
+
+int pthread_rwlock_destroy(pthread_rwlock_t * lock) {
+  assert(lock->state == 0);
+  return 0;
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t * lock) {
+  while (1) {
+    uint64_t state = lock->state;
+    if (!_read_blocked(state)) {
+      if (__sync_bool_compare_and_swap(&lock->state, state, state + 1)) {
+        return 0;
+      }
+      continue;
+    }
+
+    // announce ourselves before sampling the sequence, so that an unlock
+    // which misses our count must have happened before we re-check
+    __sync_fetch_and_add(&lock->readersWaiting, 1);
+    uint64_t seq = lock->readSeq;
+    if (_read_blocked(lock->state)) {
+      sys_futex_wait(&lock->readSeq, seq, 0);
+    }
+    __sync_fetch_and_sub(&lock->readersWaiting, 1);
+  }
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t * lock) {
+  uint64_t state = lock->state;
+  while (!_read_blocked(state)) {
+    if (__sync_bool_compare_and_swap(&lock->state, state, state + 1)) {
+      return 0;
+    }
+    state = lock->state;
+  }
+  return EBUSY;
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t * lock) {
+  if (__sync_bool_compare_and_swap(&lock->state, 0, RWLOCK_WRITER)) {
+    return 0;
+  }
+
+  // registering as a waiting writer holds back any new readers
+  __sync_fetch_and_add(&lock->state, RWLOCK_WAITER);
+  while (1) {
+    uint64_t seq = lock->writeSeq;
+    uint64_t state = lock->state;
+    if (!(state & (RWLOCK_READERS | RWLOCK_WRITER))) {
+      uint64_t newState = (state - RWLOCK_WAITER) | RWLOCK_WRITER;
+      if (__sync_bool_compare_and_swap(&lock->state, state, newState)) {
+        return 0;
+      }
+      continue;
+    }
+    sys_futex_wait(&lock->writeSeq, seq, 0);
+  }
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t * lock) {
+  if (__sync_bool_compare_and_swap(&lock->state, 0, RWLOCK_WRITER)) {
+    return 0;
+  }
+  return EBUSY;
+}
+
+int pthread_rwlock_unlock(pthread_rwlock_t * lock) {
+  uint64_t state = lock->state;
+  if (state & RWLOCK_WRITER) {
+    state = __sync_sub_and_fetch(&lock->state, RWLOCK_WRITER);
+    if (state >= RWLOCK_WAITER) {
+      _wake_writer(lock);
+    } else {
+      _wake_readers(lock);
+    }
+    return 0;
+  }
+
+  if (!(state & RWLOCK_READERS)) return EPERM;
+  state = __sync_sub_and_fetch(&lock->state, 1);
+  if (!(state & RWLOCK_READERS) && state >= RWLOCK_WAITER) {
+    _wake_writer(lock);
+  }
+  return 0;
+}
+
+static bool _read_blocked(uint64_t state) {
+  return (state & RWLOCK_WRITER) || state >= RWLOCK_WAITER;
+}
+
+static void _wake_writer(pthread_rwlock_t * lock) {
+  __sync_fetch_and_add(&lock->writeSeq, 1);
+  sys_futex_wake(&lock->writeSeq, 1);
+}
+
+static void _wake_readers(pthread_rwlock_t * lock) {
+  __sync_fetch_and_add(&lock->readSeq, 1);
+  if (lock->readersWaiting) {
+    sys_futex_wake(&lock->readSeq, UINT64_MAX);
+  }
+}
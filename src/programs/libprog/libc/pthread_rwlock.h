@@ -0,0 +1,35 @@
+#ifndef __PTHREAD_RWLOCK_H__
+#define __PTHREAD_RWLOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PTHREAD_RWLOCK_INITIALIZER {0, 0, 0, 0}
+
+/**
+ * A writer-preferring reader-writer lock. Once a writer is waiting, new
+ * readers block until every waiting writer has had its turn. Readers and
+ * writers sleep on separate futex words, so waking writers one at a time does
+ * not disturb blocked readers and vice versa.
+ */
+typedef struct {
+  uint64_t state; // active readers, the writer bit and waiting writers
+  uint64_t readersWaiting; // readers asleep (or about to sleep) on readSeq
+  uint64_t readSeq; // bumped to wake readers
+  uint64_t writeSeq; // bumped to wake a writer
+} pthread_rwlock_t;
+
+typedef struct {
+} __attribute__((packed)) pthread_rwlockattr_t;
+
+int pthread_rwlock_init(pthread_rwlock_t * lock,
+                        const pthread_rwlockattr_t * attr);
+int pthread_rwlock_destroy(pthread_rwlock_t * lock);
+
+int pthread_rwlock_rdlock(pthread_rwlock_t * lock);
+int pthread_rwlock_tryrdlock(pthread_rwlock_t * lock);
+int pthread_rwlock_wrlock(pthread_rwlock_t * lock);
+int pthread_rwlock_trywrlock(pthread_rwlock_t * lock);
+int pthread_rwlock_unlock(pthread_rwlock_t * lock);
+
+#endif
@@ -18,11 +18,12 @@ int sem_destroy(sem_t * sem) {
 
 int sem_wait(sem_t * sem) {
   pthread_mutex_lock(&sem->mutex);
-  sem->count--;
-  if (sem->count < 0) {
+  // condition variables may wake spuriously, so re-check the count
+  while (sem->count <= 0) {
     int res = pthread_cond_wait(&sem->cond, &sem->mutex);
     assert(!res);
   }
+  sem->count--;
   pthread_mutex_unlock(&sem->mutex);
   return 0;
 }
@@ -40,9 +41,8 @@ int sem_trywait(sem_t * sem) {
 
 int sem_post(sem_t * sem) {
   pthread_mutex_lock(&sem->mutex);
-  if (++sem->count <= 0) {
-    pthread_cond_signal(&sem->cond);
-  }
+  sem->count++;
+  pthread_cond_signal(&sem->cond);
   pthread_mutex_unlock(&sem->mutex);
   return 0;
 }
@@ -8,7 +8,7 @@ typedef struct {
   pthread_cond_t cond;
   pthread_mutex_t mutex;
   int64_t count;
-} __attribute__((packed)) sem_t;
+} sem_t;
 
 int sem_init(sem_t * sem, int pshared, unsigned int value);
 int sem_destroy(sem_t * sem);
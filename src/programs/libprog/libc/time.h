@@ -9,6 +9,11 @@
 typedef uint64_t clock_t;
 typedef uint64_t time_t;
 
+struct timespec {
+  time_t tv_sec;
+  long tv_nsec;
+};
+
 struct tm {
   int32_t tm_sec;
   int32_t tm_min;
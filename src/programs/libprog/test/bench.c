@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#define LOCK_BASIC 0
+#define LOCK_MUTEX 1
+#define LOCK_RWLOCK 2
+
+#define TABLE_SIZE 0x10
+
+typedef struct {
+  int kind;
+  int writePercent;
+  unsigned int seed;
+} bench_t;
+
+void bench_basic_lock();
+void bench_basic_unlock();
+void bench_mutex_lock();
+void bench_mutex_unlock();
+void bench_rwlock_rdlock();
+void bench_rwlock_wrlock();
+void bench_rwlock_unlock();
+
+static volatile uint64_t table[TABLE_SIZE];
+static volatile int startFlag;
+static int iterations = 100000;
+
+void * bench_thread(void * ptr);
+double run_bench(int kind, int writePercent, int threads);
+double current_time();
+
+int main(int argc, const char * argv[]) {
+  int counts[] = {1, 2, 4, 8};
+  int i;
+  if (argc > 1) iterations = atoi(argv[1]);
+
+  printf("exclusive      basic_lock ns/op   pthread_mutex ns/op\n");
+  for (i = 0; i < 4; i++) {
+    double basic = run_bench(LOCK_BASIC, 100, counts[i]);
+    double mutex = run_bench(LOCK_MUTEX, 100, counts[i]);
+    printf("%2d threads     %16.1lf   %19.1lf\n", counts[i], basic, mutex);
+  }
+
+  printf("\n90%% reads      basic_lock ns/op   pthread_rwlock ns/op\n");
+  for (i = 0; i < 4; i++) {
+    double basic = run_bench(LOCK_BASIC, 10, counts[i]);
+    double rwlock = run_bench(LOCK_RWLOCK, 10, counts[i]);
+    printf("%2d threads     %16.1lf   %20.1lf\n", counts[i], basic, rwlock);
+  }
+  return 0;
+}
+
+double run_bench(int kind, int writePercent, int threads) {
+  pthread_t list[8];
+  bench_t infos[8];
+  startFlag = 0;
+
+  int i;
+  for (i = 0; i < threads; i++) {
+    infos[i].kind = kind;
+    infos[i].writePercent = writePercent;
+    infos[i].seed = i + 1;
+    pthread_create(&list[i], NULL, bench_thread, &infos[i]);
+  }
+  double start = current_time();
+  startFlag = 1;
+  for (i = 0; i < threads; i++) {
+    pthread_join(list[i], NULL);
+  }
+  double duration = current_time() - start;
+  for (i = 1; i < TABLE_SIZE; i++) {
+    if (table[i] != table[0]) {
+      fprintf(stderr, "table is inconsistent!\n");
+      exit(1);
+    }
+  }
+  return duration * 1e9 / (double)(iterations * threads);
+}
+
+void * bench_thread(void * ptr) {
+  bench_t * info = (bench_t *)ptr;
+  while (!startFlag);
+  int i, j;
+  for (i = 0; i < iterations; i++) {
+    int isWrite = (rand_r(&info->seed) % 100) < info->writePercent;
+    if (info->kind == LOCK_BASIC) {
+      bench_basic_lock();
+    } else if (info->kind == LOCK_MUTEX) {
+      bench_mutex_lock();
+    } else if (isWrite) {
+      bench_rwlock_wrlock();
+    } else {
+      bench_rwlock_rdlock();
+    }
+
+    if (isWrite) {
+      for (j = 0; j < TABLE_SIZE; j++) table[j]++;
+    } else {
+      // a writer holding the lock at the same time would show up here
+      uint64_t first = table[0];
+      for (j = 1; j < TABLE_SIZE; j++) {
+        if (table[j] != first) {
+          fprintf(stderr, "reader saw a partial write!\n");
+          exit(1);
+        }
+      }
+    }
+
+    if (info->kind == LOCK_BASIC) {
+      bench_basic_unlock();
+    } else if (info->kind == LOCK_MUTEX) {
+      bench_mutex_unlock();
+    } else {
+      bench_rwlock_unlock();
+    }
+  }
+  return NULL;
+}
+
+double current_time() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+}
@@ -0,0 +1,46 @@
+/**
+ * Built against libprog's headers rather than the host's, and exposes each
+ * lock to bench.c through plain functions so the two pthread.h files never
+ * meet in one translation unit.
+ */
+
+#include <pthread.h>
+#include <lock.h>
+
+static __thread struct pthread self;
+
+static basic_lock_t basicLock = BASIC_LOCK_INITIALIZER;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+pthread_t pthread_current() {
+  return &self;
+}
+
+void bench_basic_lock() {
+  basic_lock_lock(&basicLock);
+}
+
+void bench_basic_unlock() {
+  basic_lock_unlock(&basicLock);
+}
+
+void bench_mutex_lock() {
+  pthread_mutex_lock(&mutex);
+}
+
+void bench_mutex_unlock() {
+  pthread_mutex_unlock(&mutex);
+}
+
+void bench_rwlock_rdlock() {
+  pthread_rwlock_rdlock(&rwlock);
+}
+
+void bench_rwlock_wrlock() {
+  pthread_rwlock_wrlock(&rwlock);
+}
+
+void bench_rwlock_unlock() {
+  pthread_rwlock_unlock(&rwlock);
+}
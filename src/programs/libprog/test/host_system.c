@@ -0,0 +1,55 @@
+/**
+ * Implements the few libprog system calls the locks need on top of Linux, so
+ * that they can be benchmarked on a development machine. Linux futexes are 32
+ * bits wide, so these only watch the low half of each word; every word the
+ * locks sleep on stays far below 2^32 during a benchmark run.
+ */
+
+#define _GNU_SOURCE
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+
+uint64_t sys_get_time() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return spec.tv_sec * 1000000L + spec.tv_nsec / 1000L;
+}
+
+bool sys_futex_wait(uint64_t * ptr, uint64_t expected, uint64_t usec) {
+  struct timespec timeout = {usec / 1000000L, (usec % 1000000L) * 1000L};
+  long res = syscall(SYS_futex, (uint32_t *)ptr, FUTEX_WAIT_PRIVATE,
+                     (uint32_t)expected, usec ? &timeout : NULL, NULL, 0);
+  return res == 0;
+}
+
+uint64_t sys_futex_wake(uint64_t * ptr, uint64_t count) {
+  int num = count > 0x7fffffff ? 0x7fffffff : (int)count;
+  return syscall(SYS_futex, (uint32_t *)ptr, FUTEX_WAKE_PRIVATE, num,
+                 NULL, NULL, 0);
+}
+
+uint64_t sys_thread_id() {
+  return syscall(SYS_gettid);
+}
+
+bool sys_futex_lock_pi(uint64_t * ptr) {
+  // nothing here sets the waiters bit, so the caller simply polls the word
+  sched_yield();
+  return false;
+}
+
+bool sys_futex_unlock_pi(uint64_t * ptr) {
+  return false;
+}
+
+void __assert(const char * msg, const char * file, int line) {
+  fprintf(stderr, "%s:%d: assertion failed: %s\n", file, line, msg);
+  abort();
+}
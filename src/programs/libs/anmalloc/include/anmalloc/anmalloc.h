@@ -1,3 +1,6 @@
+#ifndef __ANMALLOC_H__
+#define __ANMALLOC_H__
+
 #include <anmalloc_bindings.h>
 #include <stdint.h>
 
@@ -6,12 +9,77 @@
 // - anmalloc_brk
 // - anmalloc_lock
 // - anmalloc_unlock
+// - anmalloc_thread_id
 // and these other defines
 // - ANMALLOC_LOCK_INIT
 // - anmalloc_lock_t
 
+#define ANMALLOC_BUCKET_COUNT 0x20
+
+/**
+ * A snapshot of the allocator's counters. Objects are bucketed by the log2 of
+ * the number of bytes actually reserved for them, so bucket 5 holds 0x20-byte
+ * chunks. While other threads are allocating, the snapshot may be slightly
+ * inconsistent.
+ */
+typedef struct {
+  uint64_t liveBytes; // bytes reserved by allocations which are not yet freed
+  uint64_t peakBytes; // the highest liveBytes has ever been
+  uint64_t heapBytes; // bytes currently taken from the break
+  uint64_t slabBytes; // bytes of the heap held by small-object slabs
+  uint64_t allocCount;
+  uint64_t freeCount;
+  uint64_t requestedBytes; // total bytes ever requested
+  uint64_t reservedBytes; // total bytes ever reserved to satisfy requests
+  uint64_t liveObjects[ANMALLOC_BUCKET_COUNT];
+  uint64_t allocObjects[ANMALLOC_BUCKET_COUNT];
+} anmalloc_stats_t;
+
+/**
+ * One entry of the sampled allocation profile.
+ */
+typedef struct {
+  void * site; // return address of the allocating call
+  uint64_t samples;
+  uint64_t bytes; // bytes requested by the sampled allocations
+} anmalloc_site_t;
+
 void anmalloc_free(void * buf);
 void * anmalloc_alloc(uint64_t size);
+
+/**
+ * Like anmalloc_alloc(), but attributes the allocation to `site` instead of
+ * the caller when profiling. Wrappers such as malloc() should use this.
+ */
+void * anmalloc_alloc_from(uint64_t size, void * site);
 void * anmalloc_aligned(uint64_t alignment, uint64_t size);
 void * anmalloc_realloc(void * ptr, uint64_t size);
 uint64_t anmalloc_used();
+
+/**
+ * Hands the calling thread's cached slabs back to the shared pool. Call this
+ * before a thread exits so that its memory does not sit idle until the
+ * thread ID is reused.
+ */
+void anmalloc_thread_flush();
+
+/**
+ * Fills out a snapshot of the allocator's statistics. The internal
+ * fragmentation caused by rounding requests up is
+ * `reservedBytes - requestedBytes`.
+ */
+void anmalloc_get_stats(anmalloc_stats_t * stats);
+
+/**
+ * Records the allocation site of one in every `interval` allocations made by
+ * each thread. Pass 0 to stop sampling.
+ */
+void anmalloc_set_sampling(uint64_t interval);
+
+/**
+ * Copies up to `max` sampled allocation sites into `sites`, ordered by sample
+ * count, and returns the number copied.
+ */
+uint64_t anmalloc_get_sites(anmalloc_site_t * sites, uint64_t max);
+
+#endif
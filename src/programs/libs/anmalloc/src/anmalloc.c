@@ -5,15 +5,81 @@
 #include <stdbool.h>
 #include <analloc.h>
 
+#ifndef ANMALLOC_CACHE_COUNT
+#define ANMALLOC_CACHE_COUNT 0x40
+#endif
+
+#define ANMALLOC_CLASS_COUNT 7
+#define ANMALLOC_MIN_CLASS 0x10
+#define ANMALLOC_MAX_CLASS (ANMALLOC_MIN_CLASS << (ANMALLOC_CLASS_COUNT - 1))
+#define ANMALLOC_SLAB_SIZE 0x4000
+#define ANMALLOC_SLAB_HEADER 0x80
+#define ANMALLOC_SLAB_MAGIC 0x736c616261736c62UL
+#define ANMALLOC_CENTRAL_OWNER 0xffffffffffffffffUL
+#define ANMALLOC_FLUSH_INTERVAL 0x100
+#define ANMALLOC_CACHE_SLABS 4
+
+#ifndef ANMALLOC_SITE_COUNT
+#define ANMALLOC_SITE_COUNT 0x40
+#endif
+
 typedef struct {
   uint64_t used;
   analloc_struct_t alloc;
 } __attribute__((packed)) prefix_t;
 
+typedef struct slab slab_t;
+
+/**
+ * A slab is a single ANMALLOC_SLAB_SIZE buddy block which is carved into
+ * objects of one size class. Only the owning cache touches `freeList`,
+ * `next`, `bump` and `used`; other threads push objects onto `remoteFree`.
+ */
+struct slab {
+  uint64_t magic;
+  slab_t * next;
+  slab_t * last;
+  uint64_t owner;
+  uint64_t objSize;
+  uint64_t bump;
+  uint64_t used;
+  void * freeList;
+  void * remoteFree;
+};
+
+/**
+ * Counters which are only modified by one thread (or under `lock` for the
+ * central cache) and summed up when statistics are requested.
+ */
+typedef struct {
+  uint64_t allocCount;
+  uint64_t freeCount;
+  uint64_t requestedBytes;
+  uint64_t reservedBytes;
+  uint64_t liveObjects[ANMALLOC_BUCKET_COUNT];
+  uint64_t allocObjects[ANMALLOC_BUCKET_COUNT];
+} counters_t;
+
+typedef struct {
+  slab_t * partial[ANMALLOC_CLASS_COUNT];
+  slab_t * full[ANMALLOC_CLASS_COUNT];
+  uint64_t operations;
+  uint64_t untilSample;
+  counters_t counters;
+} cache_t;
+
 static anmalloc_lock_t lock = ANMALLOC_LOCK_INITIALIZER;
 static bool isInitialized = false;
 static uint64_t allocatorCount = 0;
 static void * baseBreak = NULL;
+static cache_t caches[ANMALLOC_CACHE_COUNT];
+static cache_t centralCache;
+
+static uint64_t liveBytes __attribute__((aligned(8))) = 0;
+static uint64_t peakBytes __attribute__((aligned(8))) = 0;
+static uint64_t slabBytes = 0; // protected by `lock`
+static uint64_t sampleInterval = 0;
+static anmalloc_site_t sites[ANMALLOC_SITE_COUNT];
 
 static void _ensure_initialized();
 static uint64_t _allocator_offset(uint64_t alloc);
@@ -21,42 +87,63 @@ static void * _allocator_base(uint64_t alloc);
 static uint64_t _allocator_lookup(void * buf);
 #define _allocator_prefix(x) ((prefix_t *)_allocator_base(x))
 
-static void * _raw_alloc(uint64_t size);
+static void * _raw_alloc(uint64_t size, uint64_t * reserved);
 static bool _create_allocator();
 static bool _release_allocator();
+static uint64_t _raw_free(void * buf);
 
-void anmalloc_free(void * buf) {
-  anmalloc_lock(&lock);
+static int _size_class(uint64_t size);
+static cache_t * _thread_cache(uint64_t * owner);
+static slab_t * _slab_lookup(void * buf);
+static void * _cache_alloc(cache_t * cache, uint64_t owner, int class);
+static void _cache_free(cache_t * cache, slab_t * slab, void * buf);
+static void _cache_flush(cache_t * cache, uint64_t owner);
+static slab_t * _cache_refill(cache_t * cache, uint64_t owner, int class);
+static void _slab_remote_free(slab_t * slab, void * buf);
+static void _slab_drain(slab_t * slab);
+static void _slab_release(cache_t * cache, slab_t * slab, int class);
+static void _slab_unlink(slab_t ** list, slab_t * slab);
+static void _slab_push(slab_t ** list, slab_t * slab);
+static void * _small_alloc(uint64_t size, void * site);
+static bool _small_free(void * buf);
 
-  uint64_t allocator = _allocator_lookup(buf);
-  assert(allocator < allocatorCount);
+static int _bucket(uint64_t size);
+static void _record_alloc(cache_t * cache, uint64_t size, uint64_t reserved);
+static void _record_free(cache_t * cache, uint64_t reserved);
+static void _record_site(cache_t * cache, uint64_t size, void * site);
 
-  prefix_t * prefix = _allocator_prefix(allocator);
-  uint64_t size;
-  void * ptr = analloc_mem_start(&prefix->alloc, buf, &size);
-  assert(ptr != NULL);
-  prefix->used -= size;
+void anmalloc_free(void * buf) {
+  if (_small_free(buf)) return;
 
-  analloc_free(&prefix->alloc, ptr, size);
+  anmalloc_lock(&lock);
+  _record_free(&centralCache, _raw_free(buf));
   while (_release_allocator());
-
   anmalloc_unlock(&lock);
 }
 
 void * anmalloc_alloc(uint64_t size) {
+  return anmalloc_alloc_from(size, __builtin_return_address(0));
+}
+
+void * anmalloc_alloc_from(uint64_t size, void * site) {
+  if (size <= ANMALLOC_MAX_CLASS) return _small_alloc(size, site);
+
   anmalloc_lock(&lock);
   _ensure_initialized();
 
   void * buf;
-  while (!(buf = _raw_alloc(size))) {
+  uint64_t reserved;
+  while (!(buf = _raw_alloc(size, &reserved))) {
     if (!_create_allocator()) {
       while (_release_allocator());
       anmalloc_unlock(&lock);
       return NULL;
     }
   }
+  _record_alloc(&centralCache, size, reserved);
 
   anmalloc_unlock(&lock);
+  _record_site(NULL, size, site);
   return buf;
 }
 
@@ -68,26 +155,40 @@ void * anmalloc_aligned(uint64_t align, uint64_t size) {
   uint64_t nextPower;
   for (nextPower = 0; (1 << nextPower) < align; nextPower++);
   if (((uint64_t)baseBreak) & ((1 << nextPower) - 1)) {
+    anmalloc_unlock(&lock);
     return NULL;
   }
   anmalloc_unlock(&lock);
   
+  void * site = __builtin_return_address(0);
   if ((1 << nextPower) == align) {
     // the normal malloc will be properly aligned
-    return anmalloc_alloc(align > size ? align : size);
+    return anmalloc_alloc_from(align > size ? align : size, site);
   }
 
-  void * result = anmalloc_alloc((align > size ? align : size) + align);
+  void * result = anmalloc_alloc_from((align > size ? align : size) + align,
+                                      site);
   if (!result) return NULL;
   uint64_t remainder = ((uint64_t)result) % align;
   result += align - remainder;
-  anmalloc_unlock(&lock);
   return result;
 }
 
 void * anmalloc_realloc(void * ptr, uint64_t size) {
   if (!ptr) return anmalloc_alloc(size);
   if (!size) size = 1;
+
+  slab_t * slab = _slab_lookup(ptr);
+  if (slab) {
+    uint64_t offset = (uint64_t)(ptr - (void *)slab);
+    if (offset % slab->objSize) return NULL;
+    if (size <= slab->objSize) return ptr;
+    void * buffer = anmalloc_alloc_from(size, __builtin_return_address(0));
+    if (!buffer) return NULL;
+    memcpy(buffer, ptr, slab->objSize);
+    anmalloc_free(ptr);
+    return buffer;
+  }
   
   anmalloc_lock(&lock);
   _ensure_initialized();
@@ -105,24 +206,100 @@ void * anmalloc_realloc(void * ptr, uint64_t size) {
 
   uint64_t newSize = size;
   void * newMem = analloc_realloc(&prefix->alloc, ptr, oldSize, &newSize, 0);
-  anmalloc_unlock(&lock);
   if (newMem) {
     prefix->used += newSize;
     prefix->used -= oldSize;
+    _record_free(&centralCache, oldSize);
+    _record_alloc(&centralCache, size, newSize);
+    anmalloc_unlock(&lock);
     return newMem;
   }
+  anmalloc_unlock(&lock);
 
-  void * buffer = anmalloc_alloc(size);
+  void * buffer = anmalloc_alloc_from(size, __builtin_return_address(0));
   if (!buffer) return NULL;
   memcpy(buffer, ptr, oldSize > size ? size : oldSize);
   anmalloc_free(ptr);
   return buffer;
 }
 
+void anmalloc_thread_flush() {
+  uint64_t owner;
+  cache_t * cache = _thread_cache(&owner);
+  if (!cache) return;
+  _cache_flush(cache, owner);
+
+  anmalloc_lock(&lock);
+  int class;
+  for (class = 0; class < ANMALLOC_CLASS_COUNT; class++) {
+    slab_t * slab;
+    while ((slab = cache->partial[class])) {
+      _slab_unlink(&cache->partial[class], slab);
+      slab->owner = ANMALLOC_CENTRAL_OWNER;
+      _slab_push(&centralCache.partial[class], slab);
+    }
+    while ((slab = cache->full[class])) {
+      _slab_unlink(&cache->full[class], slab);
+      slab->owner = ANMALLOC_CENTRAL_OWNER;
+      _slab_push(&centralCache.full[class], slab);
+    }
+  }
+  _cache_flush(&centralCache, ANMALLOC_CENTRAL_OWNER);
+  while (_release_allocator());
+  anmalloc_unlock(&lock);
+}
+
 uint64_t anmalloc_used() {
-  if (!allocatorCount) return 0;
-  
-  return (0x100000 << (allocatorCount - 1));
+  return liveBytes;
+}
+
+void anmalloc_get_stats(anmalloc_stats_t * stats) {
+  uint64_t i, j;
+  for (i = 0; i < sizeof(anmalloc_stats_t) / 8; i++) {
+    ((uint64_t *)stats)[i] = 0;
+  }
+
+  anmalloc_lock(&lock);
+  stats->heapBytes = allocatorCount ? _allocator_offset(allocatorCount) : 0;
+  stats->slabBytes = slabBytes;
+
+  for (i = 0; i <= ANMALLOC_CACHE_COUNT; i++) {
+    counters_t * counters = (i == ANMALLOC_CACHE_COUNT
+      ? &centralCache.counters : &caches[i].counters);
+    stats->allocCount += counters->allocCount;
+    stats->freeCount += counters->freeCount;
+    stats->requestedBytes += counters->requestedBytes;
+    stats->reservedBytes += counters->reservedBytes;
+    for (j = 0; j < ANMALLOC_BUCKET_COUNT; j++) {
+      stats->liveObjects[j] += counters->liveObjects[j];
+      stats->allocObjects[j] += counters->allocObjects[j];
+    }
+  }
+  anmalloc_unlock(&lock);
+
+  stats->liveBytes = liveBytes;
+  stats->peakBytes = peakBytes;
+}
+
+void anmalloc_set_sampling(uint64_t interval) {
+  sampleInterval = interval;
+}
+
+uint64_t anmalloc_get_sites(anmalloc_site_t * out, uint64_t max) {
+  anmalloc_lock(&lock);
+  uint64_t count = 0, i;
+  for (i = 0; i < ANMALLOC_SITE_COUNT; i++) {
+    if (!sites[i].site) continue;
+    // insertion sort by descending sample count, keeping the top `max`
+    uint64_t j = count < max ? count++ : max;
+    while (j > 0 && out[j - 1].samples < sites[i].samples) {
+      if (j < max) out[j] = out[j - 1];
+      j--;
+    }
+    if (j < max) out[j] = sites[i];
+  }
+  anmalloc_unlock(&lock);
+  return count;
 }
 
 static void _ensure_initialized() {
@@ -150,7 +327,21 @@ static uint64_t _allocator_lookup(void * buf) {
   return allocator;
 }
 
-static void * _raw_alloc(uint64_t size) {
+static uint64_t _raw_free(void * buf) {
+  uint64_t allocator = _allocator_lookup(buf);
+  assert(allocator < allocatorCount);
+
+  prefix_t * prefix = _allocator_prefix(allocator);
+  uint64_t size;
+  void * ptr = analloc_mem_start(&prefix->alloc, buf, &size);
+  assert(ptr != NULL);
+  prefix->used -= size;
+
+  analloc_free(&prefix->alloc, ptr, size);
+  return size;
+}
+
+static void * _raw_alloc(uint64_t size, uint64_t * reserved) {
   uint64_t i;
   for (i = 0; i < allocatorCount; i++) {
     prefix_t * pref = _allocator_prefix(i);
@@ -158,6 +349,7 @@ static void * _raw_alloc(uint64_t size) {
     void * buff = analloc_alloc(&pref->alloc, &sizeOut, 0);
     if (buff) {
       pref->used += sizeOut;
+      (*reserved) = sizeOut;
       return buff;
     }
   }
@@ -189,3 +381,352 @@ static bool _release_allocator() {
   return true;
 }
 
+static int _size_class(uint64_t size) {
+  int class = 0;
+  while ((ANMALLOC_MIN_CLASS << class) < size) class++;
+  return class;
+}
+
+/**
+ * Returns the calling thread's cache, or NULL if the thread ID is too large
+ * to have one, in which case the central cache must be used under `lock`.
+ */
+static cache_t * _thread_cache(uint64_t * owner) {
+  uint64_t thread = anmalloc_thread_id();
+  if (thread >= ANMALLOC_CACHE_COUNT) return NULL;
+  (*owner) = thread;
+  return &caches[thread];
+}
+
+/**
+ * Returns the slab containing `buf`, or NULL if `buf` came from a plain buddy
+ * allocation. Slabs are aligned to ANMALLOC_SLAB_SIZE relative to the break
+ * and start with a magic number tied to their own address.
+ */
+static slab_t * _slab_lookup(void * buf) {
+  if (!isInitialized || buf < baseBreak) return NULL;
+  uint64_t offset = (uint64_t)(buf - baseBreak);
+  slab_t * slab = baseBreak + (offset & ~(ANMALLOC_SLAB_SIZE - 1UL));
+  if ((void *)slab == buf) return NULL;
+  if (slab->magic != (ANMALLOC_SLAB_MAGIC ^ (uint64_t)slab)) return NULL;
+  return slab;
+}
+
+static void * _small_alloc(uint64_t size, void * site) {
+  int class = _size_class(size);
+  uint64_t owner;
+  cache_t * cache = _thread_cache(&owner);
+  if (cache) {
+    void * buf = _cache_alloc(cache, owner, class);
+    if (!buf) return NULL;
+    _record_alloc(cache, size, ANMALLOC_MIN_CLASS << class);
+    _record_site(cache, size, site);
+    return buf;
+  }
+
+  anmalloc_lock(&lock);
+  _ensure_initialized();
+  void * buf = _cache_alloc(&centralCache, ANMALLOC_CENTRAL_OWNER, class);
+  if (buf) _record_alloc(&centralCache, size, ANMALLOC_MIN_CLASS << class);
+  anmalloc_unlock(&lock);
+  if (buf) _record_site(NULL, size, site);
+  return buf;
+}
+
+static bool _small_free(void * buf) {
+  slab_t * slab = _slab_lookup(buf);
+  if (!slab) return false;
+
+  uint64_t owner;
+  cache_t * cache = _thread_cache(&owner);
+  uint64_t objSize = slab->objSize;
+  if (cache && slab->owner == owner) {
+    _cache_free(cache, slab, buf);
+    _record_free(cache, objSize);
+    return true;
+  }
+
+  if (slab->owner == ANMALLOC_CENTRAL_OWNER) {
+    anmalloc_lock(&lock);
+    // the slab may have been adopted by a thread while we waited
+    if (slab->owner == ANMALLOC_CENTRAL_OWNER) {
+      _cache_free(&centralCache, slab, buf);
+      _record_free(&centralCache, objSize);
+      while (_release_allocator());
+      anmalloc_unlock(&lock);
+      return true;
+    }
+    anmalloc_unlock(&lock);
+  }
+
+  _slab_remote_free(slab, buf);
+  if (cache) {
+    _record_free(cache, objSize);
+  } else {
+    anmalloc_lock(&lock);
+    _record_free(&centralCache, objSize);
+    anmalloc_unlock(&lock);
+  }
+  return true;
+}
+
+static void * _cache_alloc(cache_t * cache, uint64_t owner, int class) {
+  if (++cache->operations % ANMALLOC_FLUSH_INTERVAL == 0) {
+    _cache_flush(cache, owner);
+  }
+
+  slab_t * slab = cache->partial[class];
+  if (!slab) {
+    slab = _cache_refill(cache, owner, class);
+    if (!slab) return NULL;
+  }
+
+  void * buf;
+  if (slab->freeList) {
+    buf = slab->freeList;
+    slab->freeList = *((void **)buf);
+  } else {
+    buf = ((void *)slab) + slab->bump;
+    slab->bump += slab->objSize;
+  }
+  slab->used++;
+
+  if (!slab->freeList && slab->bump + slab->objSize > ANMALLOC_SLAB_SIZE) {
+    _slab_drain(slab);
+    if (!slab->freeList) {
+      _slab_unlink(&cache->partial[class], slab);
+      _slab_push(&cache->full[class], slab);
+    }
+  }
+  return buf;
+}
+
+static void _cache_free(cache_t * cache, slab_t * slab, void * buf) {
+  int class = _size_class(slab->objSize);
+  uint64_t offset = (uint64_t)(buf - (void *)slab);
+  buf -= offset % slab->objSize;
+
+  bool wasFull = !slab->freeList
+    && slab->bump + slab->objSize > ANMALLOC_SLAB_SIZE;
+  *((void **)buf) = slab->freeList;
+  slab->freeList = buf;
+  slab->used--;
+
+  if (wasFull) {
+    _slab_unlink(&cache->full[class], slab);
+    _slab_push(&cache->partial[class], slab);
+  }
+  if (!slab->used) {
+    _slab_drain(slab);
+    if (!slab->used) _slab_release(cache, slab, class);
+  }
+}
+
+/**
+ * Periodic maintenance: collect objects freed by other threads, return empty
+ * slabs to the buddy allocators and hand surplus partial slabs to the
+ * central cache so that other threads can use them.
+ */
+static void _cache_flush(cache_t * cache, uint64_t owner) {
+  int class;
+  for (class = 0; class < ANMALLOC_CLASS_COUNT; class++) {
+    slab_t * slab = cache->full[class];
+    while (slab) {
+      slab_t * next = slab->next;
+      _slab_drain(slab);
+      if (slab->freeList) {
+        _slab_unlink(&cache->full[class], slab);
+        _slab_push(&cache->partial[class], slab);
+      }
+      slab = next;
+    }
+
+    uint64_t kept = 0;
+    slab = cache->partial[class];
+    while (slab) {
+      slab_t * next = slab->next;
+      _slab_drain(slab);
+      if (!slab->used) {
+        _slab_release(cache, slab, class);
+      } else if (++kept > ANMALLOC_CACHE_SLABS
+                 && owner != ANMALLOC_CENTRAL_OWNER) {
+        anmalloc_lock(&lock);
+        _slab_unlink(&cache->partial[class], slab);
+        slab->owner = ANMALLOC_CENTRAL_OWNER;
+        _slab_push(&centralCache.partial[class], slab);
+        anmalloc_unlock(&lock);
+      }
+      slab = next;
+    }
+  }
+}
+
+/**
+ * Finds a slab with free objects for a cache, first by collecting remote
+ * frees, then by adopting a partial slab from the central cache, and
+ * finally by carving a new slab out of the buddy allocators.
+ */
+static slab_t * _cache_refill(cache_t * cache, uint64_t owner, int class) {
+  slab_t * slab = cache->full[class];
+  while (slab) {
+    slab_t * next = slab->next;
+    _slab_drain(slab);
+    if (slab->freeList) {
+      _slab_unlink(&cache->full[class], slab);
+      _slab_push(&cache->partial[class], slab);
+      return slab;
+    }
+    slab = next;
+  }
+
+  bool central = owner == ANMALLOC_CENTRAL_OWNER;
+  if (!central) {
+    anmalloc_lock(&lock);
+    _ensure_initialized();
+    if ((slab = centralCache.partial[class])) {
+      _slab_unlink(&centralCache.partial[class], slab);
+      slab->owner = owner;
+      anmalloc_unlock(&lock);
+      _slab_push(&cache->partial[class], slab);
+      return slab;
+    }
+  }
+
+  uint64_t reserved;
+  while (!(slab = _raw_alloc(ANMALLOC_SLAB_SIZE, &reserved))) {
+    if (!_create_allocator()) {
+      while (_release_allocator());
+      if (!central) anmalloc_unlock(&lock);
+      return NULL;
+    }
+  }
+  slabBytes += reserved;
+  if (!central) anmalloc_unlock(&lock);
+
+  uint64_t objSize = ANMALLOC_MIN_CLASS << class;
+  slab->magic = ANMALLOC_SLAB_MAGIC ^ (uint64_t)slab;
+  slab->owner = owner;
+  slab->objSize = objSize;
+  slab->bump = objSize > ANMALLOC_SLAB_HEADER ? objSize : ANMALLOC_SLAB_HEADER;
+  slab->used = 0;
+  slab->freeList = NULL;
+  slab->remoteFree = NULL;
+  _slab_push(&cache->partial[class], slab);
+  return slab;
+}
+
+static void _slab_remote_free(slab_t * slab, void * buf) {
+  uint64_t offset = (uint64_t)(buf - (void *)slab);
+  buf -= offset % slab->objSize;
+
+  void * head;
+  do {
+    head = slab->remoteFree;
+    *((void **)buf) = head;
+  } while (!__sync_bool_compare_and_swap(&slab->remoteFree, head, buf));
+}
+
+static void _slab_drain(slab_t * slab) {
+  if (!slab->remoteFree) return;
+  void * list = __sync_lock_test_and_set(&slab->remoteFree, NULL);
+  while (list) {
+    void * next = *((void **)list);
+    *((void **)list) = slab->freeList;
+    slab->freeList = list;
+    slab->used--;
+    list = next;
+  }
+}
+
+static void _slab_release(cache_t * cache, slab_t * slab, int class) {
+  _slab_unlink(&cache->partial[class], slab);
+  slab->magic = 0;
+
+  bool central = cache == &centralCache;
+  if (!central) anmalloc_lock(&lock);
+  slabBytes -= _raw_free(slab);
+  if (!central) {
+    while (_release_allocator());
+    anmalloc_unlock(&lock);
+  }
+}
+
+static void _slab_unlink(slab_t ** list, slab_t * slab) {
+  if (slab->last) slab->last->next = slab->next;
+  else (*list) = slab->next;
+  if (slab->next) slab->next->last = slab->last;
+  slab->next = (slab->last = NULL);
+}
+
+static void _slab_push(slab_t ** list, slab_t * slab) {
+  slab->last = NULL;
+  slab->next = *list;
+  if (*list) (*list)->last = slab;
+  (*list) = slab;
+}
+
+static int _bucket(uint64_t size) {
+  int bucket = 0;
+  while (bucket < ANMALLOC_BUCKET_COUNT - 1 && (1UL << bucket) < size) {
+    bucket++;
+  }
+  return bucket;
+}
+
+static void _record_alloc(cache_t * cache, uint64_t size, uint64_t reserved) {
+  counters_t * counters = &cache->counters;
+  int bucket = _bucket(reserved);
+  counters->allocCount++;
+  counters->requestedBytes += size;
+  counters->reservedBytes += reserved;
+  counters->liveObjects[bucket]++;
+  counters->allocObjects[bucket]++;
+
+  uint64_t live = __sync_add_and_fetch(&liveBytes, reserved);
+  uint64_t peak;
+  while ((peak = peakBytes) < live) {
+    if (__sync_bool_compare_and_swap(&peakBytes, peak, live)) break;
+  }
+}
+
+static void _record_free(cache_t * cache, uint64_t reserved) {
+  counters_t * counters = &cache->counters;
+  counters->freeCount++;
+  counters->liveObjects[_bucket(reserved)]--;
+  __sync_sub_and_fetch(&liveBytes, reserved);
+}
+
+/**
+ * Counts down to the next sampled allocation for a cache, or for the central
+ * cache if `cache` is NULL, and charges the allocation to its site.
+ */
+static void _record_site(cache_t * cache, uint64_t size, void * site) {
+  if (!sampleInterval || !site) return;
+  if (cache) {
+    if (cache->untilSample) {
+      cache->untilSample--;
+      return;
+    }
+    cache->untilSample = sampleInterval - 1;
+    anmalloc_lock(&lock);
+  } else {
+    anmalloc_lock(&lock);
+    if (centralCache.untilSample) {
+      centralCache.untilSample--;
+      anmalloc_unlock(&lock);
+      return;
+    }
+    centralCache.untilSample = sampleInterval - 1;
+  }
+
+  uint64_t i, idx = (((uint64_t)site) >> 2) % ANMALLOC_SITE_COUNT;
+  for (i = 0; i < ANMALLOC_SITE_COUNT; i++) {
+    anmalloc_site_t * entry = &sites[(idx + i) % ANMALLOC_SITE_COUNT];
+    if (entry->site && entry->site != site) continue;
+    entry->site = site;
+    entry->samples++;
+    entry->bytes += size;
+    break;
+  }
+  anmalloc_unlock(&lock);
+}
@@ -41,6 +41,13 @@ void anmalloc_unlock(anmalloc_lock_t * lock) {
   pthread_mutex_unlock(lock);
 }
 
+uint64_t anmalloc_thread_id() {
+  static uint64_t nextId = 0;
+  static __thread uint64_t threadId = 0;
+  if (!threadId) threadId = __sync_add_and_fetch(&nextId, 1);
+  return threadId - 1;
+}
+
 uint64_t __anmalloc_brk_size() {
   return used;
 }
@@ -8,6 +8,7 @@ void * anmalloc_sbrk(intptr_t incr);
 int anmalloc_brk(const void * addr);
 void anmalloc_lock(anmalloc_lock_t * lock);
 void anmalloc_unlock(anmalloc_lock_t * lock);
+uint64_t anmalloc_thread_id();
 
 // extra functions
 uint64_t __anmalloc_brk_size();
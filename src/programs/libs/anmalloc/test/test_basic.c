@@ -1,17 +1,22 @@
 #include <anmalloc/anmalloc.h>
 #include <stdio.h>
 #include <assert.h>
+#include <pthread.h>
 
 void test_units();
 void test_breaking();
 void test_realloc();
 void test_alignment();
+void test_threads();
+void test_stats();
 
 int main(int argc, const char * argv[]) {
   test_units();
   test_breaking();
   test_realloc();
   test_alignment();
+  test_threads();
+  test_stats();
   return 0;
 }
 
@@ -123,3 +128,86 @@ void test_alignment() {
   
   printf(" passed!\n");
 }
+
+static void * shared[4][0x100];
+
+static void * test_threads_thread(void * arg) {
+  uint64_t index = (uint64_t)arg;
+  uint64_t i, j;
+  for (i = 0; i < 0x40; i++) {
+    for (j = 0; j < 0x100; j++) {
+      // free what the previous thread allocated, then allocate our own
+      void ** slot = &shared[(index + 1) % 4][j];
+      void * buff = __sync_lock_test_and_set(slot, NULL);
+      if (buff) anmalloc_free(buff);
+      buff = anmalloc_alloc(1 + ((i * j) % 0x400));
+      assert(buff != NULL);
+      buff = __sync_lock_test_and_set(&shared[index][j], buff);
+      if (buff) anmalloc_free(buff);
+    }
+  }
+  anmalloc_thread_flush();
+  return NULL;
+}
+
+void test_threads() {
+  printf("testing thread caches... ");
+  
+  pthread_t threads[4];
+  uint64_t i, j;
+  for (i = 0; i < 4; i++) {
+    pthread_create(&threads[i], NULL, test_threads_thread, (void *)i);
+  }
+  for (i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < 0x100; j++) {
+      if (shared[i][j]) anmalloc_free(shared[i][j]);
+    }
+  }
+  anmalloc_thread_flush();
+  assert(__anmalloc_brk_size() == 0);
+  
+  printf(" passed!\n");
+}
+
+void test_stats() {
+  printf("testing statistics... ");
+  
+  anmalloc_stats_t before, after;
+  anmalloc_get_stats(&before);
+  assert(before.liveBytes == 0);
+  assert(before.heapBytes == 0);
+  
+  anmalloc_set_sampling(1);
+  void * buff = anmalloc_alloc(0x30);
+  void * buff1 = anmalloc_alloc(0x80001);
+  anmalloc_get_stats(&after);
+  assert(after.liveBytes == 0x100040);
+  assert(after.peakBytes >= 0x100040);
+  assert(after.heapBytes == 0x400000);
+  assert(after.slabBytes == 0x4000);
+  assert(after.allocCount == before.allocCount + 2);
+  assert(after.requestedBytes - before.requestedBytes == 0x80031);
+  assert(after.reservedBytes - before.reservedBytes == 0x100040);
+  assert(after.liveObjects[6] == 1);
+  assert(after.liveObjects[20] == 1);
+  
+  anmalloc_site_t sites[4];
+  assert(anmalloc_get_sites(sites, 4) == 2);
+  assert(sites[0].samples == 1 && sites[1].samples == 1);
+  assert(sites[0].bytes + sites[1].bytes == 0x80031);
+  anmalloc_set_sampling(0);
+  
+  anmalloc_free(buff);
+  anmalloc_free(buff1);
+  anmalloc_get_stats(&after);
+  assert(after.liveBytes == 0);
+  assert(after.heapBytes == 0);
+  assert(after.freeCount == before.freeCount + 2);
+  assert(after.liveObjects[6] == 0);
+  assert(anmalloc_used() == 0);
+  
+  printf(" passed!\n");
+}
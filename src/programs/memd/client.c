@@ -37,6 +37,15 @@ client_t * client_find(uint64_t pid) {
   return false;
 }
 
+uint64_t client_count() {
+  return clientCount;
+}
+
+client_t * client_at(uint64_t index) {
+  if (index >= clientCount) return NULL;
+  return &clients[index];
+}
+
 void client_delete(client_t * client) {
   clientCount--;
   if (!clientCount) {
@@ -1,6 +1,11 @@
+#ifndef __CLIENT_H__
+#define __CLIENT_H__
+
 #include <stdlib.h>
 #include <stdbool.h>
 
+#define ANSCHEDULER_TASK_DATA_PAGE 0x10200000
+
 /**
  * Represents a connected memd client.
  */
@@ -23,8 +28,21 @@ client_t * client_get(uint64_t fd);
  */
 client_t * client_find(uint64_t pid);
 
+/**
+ * Returns the number of connected clients.
+ */
+uint64_t client_count();
+
+/**
+ * Returns the client at an index in the client list, or NULL if the index is
+ * out of bounds. Indexes are only stable until the next client_get() or
+ * client_delete().
+ */
+client_t * client_at(uint64_t index);
+
 /**
  * Delete a client.
  */
 void client_delete(client_t * client);
 
+#endif
@@ -0,0 +1,70 @@
+#include "compress.h"
+#include <string.h>
+
+#define COMPRESS_PAGE_WORDS 0x200
+#define COMPRESS_RUN_FLAG 0x80
+#define COMPRESS_MAX_TOKEN 0x80
+
+static uint64_t _run_length(const uint64_t * page, uint64_t i);
+
+uint64_t compress_page(const uint64_t * page, uint8_t * out, uint64_t max) {
+  uint64_t off = 0;
+  uint64_t i = 0;
+  while (i < COMPRESS_PAGE_WORDS) {
+    uint64_t run = _run_length(page, i);
+    if (run > 1) {
+      if (off + 9 > max) return 0;
+      out[off] = COMPRESS_RUN_FLAG | (uint8_t)(run - 1);
+      memcpy(&out[off + 1], &page[i], 8);
+      off += 9;
+      i += run;
+      continue;
+    }
+
+    // gather literals until the next run of two or more words
+    uint64_t count = 1;
+    while (i + count < COMPRESS_PAGE_WORDS && count < COMPRESS_MAX_TOKEN) {
+      if (_run_length(page, i + count) > 1) break;
+      count++;
+    }
+    if (off + 1 + (count << 3) > max) return 0;
+    out[off] = (uint8_t)(count - 1);
+    memcpy(&out[off + 1], &page[i], count << 3);
+    off += 1 + (count << 3);
+    i += count;
+  }
+  return off;
+}
+
+bool decompress_page(const uint8_t * in, uint64_t len, uint64_t * page) {
+  uint64_t off = 0;
+  uint64_t i = 0;
+  while (off < len) {
+    uint8_t token = in[off++];
+    uint64_t count = (uint64_t)(token & ~COMPRESS_RUN_FLAG) + 1;
+    if (i + count > COMPRESS_PAGE_WORDS) return false;
+    if (token & COMPRESS_RUN_FLAG) {
+      if (off + 8 > len) return false;
+      uint64_t word;
+      memcpy(&word, &in[off], 8);
+      off += 8;
+      uint64_t j;
+      for (j = 0; j < count; j++) page[i + j] = word;
+    } else {
+      if (off + (count << 3) > len) return false;
+      memcpy(&page[i], &in[off], count << 3);
+      off += count << 3;
+    }
+    i += count;
+  }
+  return i == COMPRESS_PAGE_WORDS;
+}
+
+static uint64_t _run_length(const uint64_t * page, uint64_t i) {
+  uint64_t count = 1;
+  while (i + count < COMPRESS_PAGE_WORDS && count < COMPRESS_MAX_TOKEN) {
+    if (page[i + count] != page[i]) break;
+    count++;
+  }
+  return count;
+}
@@ -0,0 +1,19 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Compress a 4KB page into `out`. The page is treated as a sequence of 64-bit
+ * words, and runs of identical words (most commonly zero) are collapsed.
+ * @param page The page to compress
+ * @param out The output buffer
+ * @param max The size of `out`
+ * @return The number of bytes written, or 0 if the page did not fit in `max`
+ * bytes.
+ */
+uint64_t compress_page(const uint64_t * page, uint8_t * out, uint64_t max);
+
+/**
+ * Decompress data produced by compress_page().
+ * @return false if the data was malformed.
+ */
+bool decompress_page(const uint8_t * in, uint64_t len, uint64_t * page);
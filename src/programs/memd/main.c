@@ -1,4 +1,6 @@
 #include "client.h"
+#include "swap.h"
+#include "zero.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -8,11 +10,12 @@
 #include <keyedbits/buff_encoder.h>
 #include <keyedbits/validation.h>
 
-#define ANSCHEDULER_TASK_DATA_PAGE 0x10200000
+#define PAGE_FAULT_WRITE 2
 
 void handle_messages(uint64_t fd);
 void handle_faults();
 void handle_client_fault(client_t * cli, pgf_t * fault);
+bool handle_zero_write(client_t * cli, uint64_t pg);
 
 const char * client_request(kb_buff_t * kb, uint64_t * start, uint64_t * count);
 void handle_client_request(client_t * cli,
@@ -30,6 +33,7 @@ void main() {
     uint64_t fd = sys_poll();
     if (fd + 1) handle_messages(fd);
     handle_faults();
+    swap_balance();
   }
 }
 
@@ -86,9 +90,32 @@ void handle_client_fault(client_t * cli, pgf_t * fault) {
 
   sys_shift_fault();
 
-  // if the page has already been allocated, retry
   uint64_t pg = index - ANSCHEDULER_TASK_DATA_PAGE;
-  if (cli->pages[pg]) return;
+  if (cli->pages[pg] & SWAP_PAGE_FLAG) {
+    if (!swap_page_in(cli, pg)) {
+      sys_mem_fault(cli->pid);
+      return;
+    }
+    sys_wake_thread(cli->fd, fault->threadId);
+    return;
+  }
+
+  bool isWrite = (fault->flags & PAGE_FAULT_WRITE) != 0;
+  if ((cli->pages[pg] & ZERO_PAGE_FLAG) && isWrite) {
+    if (!handle_zero_write(cli, pg)) {
+      sys_mem_fault(cli->pid);
+      return;
+    }
+    sys_wake_thread(cli->fd, fault->threadId);
+    return;
+  }
+
+  // if the page has already been allocated (or was handed back by the swap
+  // tier after this fault was queued), retry
+  if (cli->pages[pg]) {
+    sys_wake_thread(cli->fd, fault->threadId);
+    return;
+  }
 
   uint64_t grabCount;
   uint64_t maxCount = 0x20;
@@ -99,19 +126,46 @@ void handle_client_fault(client_t * cli, pgf_t * fault) {
   }
 
   uint64_t addrs[0x21];
-  sys_batch_alloc(&addrs[1], grabCount);
   uint64_t i;
+  addrs[0] = index;
+
+  // reads of untouched memory share the zero page until they are written to
+  uint64_t zeroEntry = isWrite ? 0 : zero_page_entry();
+  if (zeroEntry) {
+    for (i = 0; i < grabCount; i++) {
+      cli->pages[pg + i] = ZERO_PAGE_FLAG;
+      addrs[i + 1] = zeroEntry;
+    }
+    sys_batch_vmmap(cli->fd, addrs, grabCount);
+    sys_invlpg(cli->fd);
+    sys_wake_thread(cli->fd, fault->threadId);
+    return;
+  }
+
+  sys_batch_alloc(&addrs[1], grabCount);
   for (i = 0; i < grabCount; i++) {
     cli->pages[pg + i] = addrs[i + 1];
-    addrs[i + 1] |= 7;
+    addrs[i + 1] |= SWAP_RESIDENT_FLAGS;
   }
-  addrs[0] = index;
+  swap_add_resident(grabCount);
 
   sys_batch_vmmap(cli->fd, addrs, grabCount);
   sys_invlpg(cli->fd);
   sys_wake_thread(cli->fd, fault->threadId);
 }
 
+bool handle_zero_write(client_t * cli, uint64_t pg) {
+  uint64_t phys = zero_page_copy();
+  if (!phys) return false;
+
+  cli->pages[pg] = phys;
+  sys_vmmap(cli->fd, ANSCHEDULER_TASK_DATA_PAGE + pg,
+            phys | SWAP_RESIDENT_FLAGS);
+  sys_invlpg(cli->fd);
+  swap_add_resident(1);
+  return true;
+}
+
 const char * client_request(kb_buff_t * kb,
                             uint64_t * start,
                             uint64_t * count) {
@@ -194,7 +248,7 @@ bool handle_client_free(client_t * cli, uint64_t start, uint64_t count) {
   uint64_t i = 0;
   while (i < count) {
     uint64_t pg = start + i;
-    if (i + 0x20 > count) {
+    if (i + 0x20 <= count) {
       sys_batch_vmunmap(cli->fd, ANSCHEDULER_TASK_DATA_PAGE + pg, 0x20);
       i += 0x20;
     } else {
@@ -206,8 +260,12 @@ bool handle_client_free(client_t * cli, uint64_t start, uint64_t count) {
 
   for (i = 0; i < count; i++) {
     uint64_t pg = start + i;
-    if (cli->pages[pg]) {
+    if (cli->pages[pg] & ZERO_PAGE_FLAG) continue;
+    if (cli->pages[pg] & SWAP_PAGE_FLAG) {
+      swap_release(cli->pages[pg]);
+    } else if (cli->pages[pg]) {
       sys_free_page(cli->pages[pg]);
+      swap_remove_resident(1);
     }
   }
   
@@ -0,0 +1,177 @@
+#include "swap.h"
+#include "compress.h"
+#include "zero.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <base/system.h>
+
+typedef struct {
+  uint8_t * data;
+  uint64_t len;
+} __attribute__((packed)) swap_slot_t;
+
+static swap_slot_t * slots = NULL;
+static uint64_t slotCount = 0;
+static uint64_t * freeSlots = NULL;
+static uint64_t freeCount = 0;
+
+static uint64_t residentCount = 0;
+static uint64_t handClient = 0;
+static uint64_t handPage = 0;
+
+static uint8_t buffer[SWAP_MAX_COMPRESSED];
+
+static void _sweep(client_t * cli, uint64_t start, uint64_t count);
+static void _swap_out(client_t * cli, uint64_t * victims, uint64_t count);
+static uint64_t _store(const uint64_t * page);
+static void _release_slot(uint64_t slot);
+
+void swap_add_resident(uint64_t count) {
+  residentCount += count;
+}
+
+void swap_remove_resident(uint64_t count) {
+  residentCount -= count;
+}
+
+void swap_balance() {
+  if (residentCount <= SWAP_RESIDENT_HIGH) return;
+
+  // sweep every page at most twice, enough to give referenced pages their
+  // second chance without spinning when nothing will compress
+  uint64_t i, budget = 0;
+  for (i = 0; i < client_count(); i++) {
+    budget += client_at(i)->pageCount;
+  }
+  budget <<= 1;
+
+  while (residentCount > SWAP_RESIDENT_LOW && budget) {
+    client_t * cli = client_at(handClient);
+    if (!cli) {
+      if (!handClient) return;
+      handClient = 0;
+      handPage = 0;
+      continue;
+    }
+    if (handPage >= cli->pageCount) {
+      handClient++;
+      handPage = 0;
+      continue;
+    }
+
+    uint64_t count = cli->pageCount - handPage;
+    if (count > SWAP_BATCH) count = SWAP_BATCH;
+    if (count > budget) count = budget;
+    uint64_t start = handPage;
+    handPage += count;
+    budget -= count;
+    _sweep(cli, start, count);
+  }
+}
+
+bool swap_page_in(client_t * cli, uint64_t pg) {
+  uint64_t slot = cli->pages[pg] >> 12;
+  assert(slot < slotCount && slots[slot].data);
+
+  uint64_t phys = sys_alloc_page();
+  if (!phys) return false;
+  sys_self_vmmap(SWAP_SCRATCH_PAGE, phys | 3);
+  sys_self_invlpg();
+
+  uint64_t * page = (uint64_t *)(SWAP_SCRATCH_PAGE << 12);
+  if (!decompress_page(slots[slot].data, slots[slot].len, page)) {
+    sys_free_page(phys);
+    return false;
+  }
+  _release_slot(slot);
+
+  cli->pages[pg] = phys;
+  sys_vmmap(cli->fd, ANSCHEDULER_TASK_DATA_PAGE + pg,
+            phys | SWAP_RESIDENT_FLAGS);
+  sys_invlpg(cli->fd);
+  residentCount++;
+  return true;
+}
+
+void swap_release(uint64_t entry) {
+  _release_slot(entry >> 12);
+}
+
+static void _sweep(client_t * cli, uint64_t start, uint64_t count) {
+  uint64_t list[SWAP_BATCH + 1];
+  list[0] = ANSCHEDULER_TASK_DATA_PAGE + start;
+  if (!sys_batch_vmsample(cli->fd, list, count)) return;
+
+  uint64_t victims[SWAP_BATCH];
+  uint64_t i, victimCount = 0;
+  for (i = 0; i < count; i++) {
+    uint64_t entry = cli->pages[start + i];
+    if (!entry || (entry & (SWAP_PAGE_FLAG | ZERO_PAGE_FLAG))) continue;
+    // the sample cleared the flag, so this page is a victim next time around
+    if (list[i + 1] & SWAP_ACCESSED_FLAG) continue;
+    victims[victimCount++] = start + i;
+  }
+  if (victimCount) _swap_out(cli, victims, victimCount);
+}
+
+static void _swap_out(client_t * cli, uint64_t * victims, uint64_t count) {
+  uint64_t i;
+
+  // take the pages away from the client before reading them, otherwise a
+  // write could land after the page was compressed
+  for (i = 0; i < count; i++) {
+    sys_vmmap(cli->fd, ANSCHEDULER_TASK_DATA_PAGE + victims[i],
+              SWAP_PAGE_FLAG);
+    sys_self_vmmap(SWAP_SCRATCH_PAGE + i, cli->pages[victims[i]] | 3);
+  }
+  sys_invlpg(cli->fd);
+  sys_self_invlpg();
+
+  for (i = 0; i < count; i++) {
+    uint64_t pg = victims[i];
+    uint64_t vpage = ANSCHEDULER_TASK_DATA_PAGE + pg;
+    uint64_t slot = _store((uint64_t *)((SWAP_SCRATCH_PAGE + i) << 12));
+    if (!(slot + 1)) {
+      // incompressible; give the page back as it was
+      sys_vmmap(cli->fd, vpage, cli->pages[pg] | SWAP_RESIDENT_FLAGS);
+      continue;
+    }
+    sys_free_page(cli->pages[pg]);
+    cli->pages[pg] = (slot << 12) | SWAP_PAGE_FLAG;
+    sys_vmmap(cli->fd, vpage, cli->pages[pg]);
+    residentCount--;
+  }
+}
+
+static uint64_t _store(const uint64_t * page) {
+  uint64_t len = compress_page(page, buffer, SWAP_MAX_COMPRESSED);
+  if (!len) return UINT64_MAX;
+
+  uint8_t * data = malloc(len);
+  if (!data) return UINT64_MAX;
+  memcpy(data, buffer, len);
+
+  uint64_t slot;
+  if (freeCount) {
+    slot = freeSlots[--freeCount];
+  } else {
+    slot = slotCount++;
+    slots = realloc(slots, sizeof(swap_slot_t) * slotCount);
+    assert(slots != NULL);
+  }
+  slots[slot].data = data;
+  slots[slot].len = len;
+  return slot;
+}
+
+static void _release_slot(uint64_t slot) {
+  free(slots[slot].data);
+  slots[slot].data = NULL;
+  slots[slot].len = 0;
+
+  freeCount++;
+  freeSlots = realloc(freeSlots, sizeof(uint64_t) * freeCount);
+  assert(freeSlots != NULL);
+  freeSlots[freeCount - 1] = slot;
+}
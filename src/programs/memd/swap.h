@@ -0,0 +1,69 @@
+#ifndef __SWAP_H__
+#define __SWAP_H__
+
+/**
+ * A compressed, in-memory swap tier. When the number of resident client pages
+ * crosses a high watermark, a clock hand sweeps over every client's data
+ * pages, giving referenced pages a second chance and compressing the rest
+ * into buffers owned by memd. Swapped pages are left in the client's page
+ * table as non-present entries which fault back into the pager.
+ */
+
+#include "client.h"
+
+/**
+ * Set in a client page entry (and the task's page table entry) when the page
+ * lives in the swap store. The rest of the entry is the slot index shifted
+ * left by 12.
+ */
+#define SWAP_PAGE_FLAG 0x400
+#define SWAP_ACCESSED_FLAG 0x20
+
+/**
+ * Flags for resident client pages. These are mapped with the accessed flag
+ * already set so that a page faulted in right before a sweep is not evicted
+ * before the client gets a chance to touch it.
+ */
+#define SWAP_RESIDENT_FLAGS 0x27
+
+#ifndef SWAP_RESIDENT_HIGH
+#define SWAP_RESIDENT_HIGH 0x8000
+#endif
+
+#ifndef SWAP_RESIDENT_LOW
+#define SWAP_RESIDENT_LOW 0x7000
+#endif
+
+#define SWAP_BATCH 0x20
+#define SWAP_SCRATCH_PAGE 0x7ffffff00
+#define SWAP_MAX_COMPRESSED 0xc00
+
+/**
+ * Account for `count` pages which have been mapped into a client.
+ */
+void swap_add_resident(uint64_t count);
+
+/**
+ * Account for `count` resident pages which have been freed.
+ */
+void swap_remove_resident(uint64_t count);
+
+/**
+ * Compress pages until the resident count is below SWAP_RESIDENT_LOW, if it
+ * is above SWAP_RESIDENT_HIGH.
+ */
+void swap_balance();
+
+/**
+ * Decompress a swapped page into a new physical page and map it back into the
+ * client. The caller is responsible for waking the faulting thread.
+ * @return false if no memory was available or the slot was corrupt.
+ */
+bool swap_page_in(client_t * cli, uint64_t pg);
+
+/**
+ * Release the swap slot referenced by a swapped client page entry.
+ */
+void swap_release(uint64_t entry);
+
+#endif
@@ -0,0 +1,28 @@
+#include "zero.h"
+#include <strings.h>
+#include <base/system.h>
+
+static uint64_t zeroPage = 0;
+
+static uint64_t _alloc_zeroed();
+
+uint64_t zero_page_entry() {
+  if (!zeroPage) {
+    zeroPage = _alloc_zeroed();
+    if (!zeroPage) return 0;
+  }
+  return zeroPage | ZERO_PAGE_FLAGS;
+}
+
+uint64_t zero_page_copy() {
+  return _alloc_zeroed();
+}
+
+static uint64_t _alloc_zeroed() {
+  uint64_t phys = sys_alloc_page();
+  if (!phys) return 0;
+  sys_self_vmmap(ZERO_SCRATCH_PAGE, phys | 3);
+  sys_self_invlpg();
+  bzero((void *)(ZERO_SCRATCH_PAGE << 12), 0x1000);
+  return phys;
+}
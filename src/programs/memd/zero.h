@@ -0,0 +1,38 @@
+#ifndef __ZERO_H__
+#define __ZERO_H__
+
+/**
+ * A single, read-only page of zeroes which is shared by every client. Read
+ * faults on untouched data pages map this page, and the first write to such a
+ * page replaces it with a private copy.
+ */
+
+#include "swap.h"
+
+/**
+ * Set in a client page entry when the page is backed by the zero page. These
+ * entries are not resident memory and must never be freed.
+ */
+#define ZERO_PAGE_FLAG 0x800
+
+/**
+ * Present, user, and accessed, but never writable.
+ */
+#define ZERO_PAGE_FLAGS 0x25
+
+#define ZERO_SCRATCH_PAGE (SWAP_SCRATCH_PAGE + SWAP_BATCH)
+
+/**
+ * Returns the page table entry to map a client page to the zero page,
+ * allocating the zero page on first use.
+ * @return 0 if the zero page could not be allocated.
+ */
+uint64_t zero_page_entry();
+
+/**
+ * Allocate a private, zeroed page to replace the zero page on a write fault.
+ * @return The physical address of the page, or 0 on failure.
+ */
+uint64_t zero_page_copy();
+
+#endif
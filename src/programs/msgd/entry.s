@@ -1,9 +1,10 @@
 bits 64
 
-extern main
+extern main, tls_initialize
 
 section .entrypoint
 start:
+  call tls_initialize
   call main
 .hang:
   jmp .hang
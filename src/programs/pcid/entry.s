@@ -1,10 +1,11 @@
 bits 64
 
-extern main, sys_exit
+extern main, sys_exit, tls_initialize
 
 section .entrypoint
 global start
 start:
+  call tls_initialize
   call main
   call sys_exit
 .hang:
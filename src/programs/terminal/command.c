@@ -0,0 +1,11 @@
+#include "command.h"
+
+void command_wait(msg_t * msg) {
+  while (1) {
+    uint64_t fd = sys_poll();
+    if (fd != 0) sys_close(fd);
+    while (sys_read(0, msg)) {
+      if (msg->type == 1) return;
+    }
+  }
+}
@@ -0,0 +1,12 @@
+#ifndef __COMMAND_H__
+#define __COMMAND_H__
+
+#include <stdio.h>
+
+/**
+ * Waits for the message with the command line which the terminal sends every
+ * command it starts, closing any other connections in the meantime.
+ */
+void command_wait(msg_t * msg);
+
+#endif
@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include "command.h"
+#include <anmalloc/anmalloc.h>
+
+#define HEAPSTAT_SITES 8
+
+void command_heapstat() {
+  msg_t msg;
+  command_wait(&msg);
+
+  anmalloc_stats_t stats;
+  anmalloc_get_stats(&stats);
+  printf("live 0x%x bytes, peak 0x%x, heap 0x%x (0x%x in slabs)\n",
+         stats.liveBytes, stats.peakBytes, stats.heapBytes, stats.slabBytes);
+  printf("%u allocs, %u frees, 0x%x requested, 0x%x rounding waste\n",
+         stats.allocCount, stats.freeCount, stats.requestedBytes,
+         stats.reservedBytes - stats.requestedBytes);
+
+  printf("size        live      total\n");
+  int i;
+  for (i = 0; i < ANMALLOC_BUCKET_COUNT; i++) {
+    if (!stats.allocObjects[i]) continue;
+    printf("0x%x    %u    %u\n", 1UL << i, stats.liveObjects[i],
+           stats.allocObjects[i]);
+  }
+
+  anmalloc_site_t sites[HEAPSTAT_SITES];
+  uint64_t count = anmalloc_get_sites(sites, HEAPSTAT_SITES);
+  if (count) printf("sampled sites:\n");
+  for (i = 0; i < count; i++) {
+    printf("  0x%x: %u samples, 0x%x bytes\n", sites[i].site,
+           sites[i].samples, sites[i].bytes);
+  }
+  sys_exit();
+}
@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include "command.h"
+
+#define LOCKSTAT_COUNT 0x10
+
+void command_lockstat() {
+  msg_t msg;
+  command_wait(&msg);
+
+  anlock_stat_t stats[LOCKSTAT_COUNT];
+  uint64_t count = sys_lockstat(stats, LOCKSTAT_COUNT);
+  if (!count) {
+    printf("no lock statistics; build the kernel with LOCKSTAT=1\n");
+    sys_exit();
+  }
+
+  printf("lock               acquired   contended  spin cycles  max hold\n");
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    printf("%s    %u    %u    0x%x    0x%x\n", stats[i].name,
+           stats[i].acquisitions, stats[i].contended, stats[i].spinCycles,
+           stats[i].maxHoldCycles);
+  }
+  sys_exit();
+}
@@ -1,6 +1,7 @@
 #include <base/msgd.h>
 #include <stdio.h>
 #include <string.h>
+#include <anmalloc/anmalloc.h>
 
 #include "echo.h"
 #include "count.h"
@@ -11,8 +12,13 @@
 #include "allocer.h"
 #include "threadtest.h"
 #include "floattest.h"
+#include "heapstat.h"
+#include "lockstat.h"
+#include "ringbench.h"
+#include "syscallstat.h"
 
 #define BUFF_SIZE 0xff
+#define HEAP_SAMPLE_INTERVAL 0x10
 
 static uint64_t keyboard = 0;
 static char * buffer = NULL;
@@ -27,6 +33,7 @@ static bool is_command(const char * cmd);
 int main() {
   char _buffer[BUFF_SIZE + 1];
   buffer = _buffer;
+  anmalloc_set_sampling(HEAP_SAMPLE_INTERVAL);
 
   char * keyboardName = "keyboard";
   msgd_connect_services(1, (const char **)&keyboardName, &keyboard, 3);
@@ -134,6 +141,14 @@ static void process_cmd() {
     method = (uint64_t)command_threadtest;
   } else if (is_command("floattest")) {
     method = (uint64_t)command_floattest;
+  } else if (is_command("heapstat")) {
+    method = (uint64_t)command_heapstat;
+  } else if (is_command("lockstat")) {
+    method = (uint64_t)command_lockstat;
+  } else if (is_command("ringbench")) {
+    method = (uint64_t)command_ringbench;
+  } else if (is_command("syscallstat")) {
+    method = (uint64_t)command_syscallstat;
   } else {
     printf("[terminal]: `%s` unknown command\n", buffer);
     prompt();
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <base/ring.h>
+#include "command.h"
+
+#define RINGBENCH_ROUNDS 0x400
+#define RINGBENCH_BATCH 0x10 // the kernel queues at most 0x10 messages
+
+static uint64_t accept_self(uint64_t * out);
+static uint64_t run_plain(uint64_t out, uint64_t in);
+static uint64_t run_ring(uint64_t out, uint64_t in);
+static void report(const char * name, uint64_t usec);
+
+void command_ringbench() {
+  msg_t msg;
+  command_wait(&msg);
+
+  uint64_t out;
+  uint64_t in = accept_self(&out);
+  if (!(in + 1)) {
+    printf("failed to connect to self\n");
+    sys_exit();
+  }
+  report("syscalls", run_plain(out, in));
+  report("ring    ", run_ring(out, in));
+  sys_close(out);
+  sys_close(in);
+  sys_exit();
+}
+
+static uint64_t accept_self(uint64_t * out) {
+  msg_t msg;
+  *out = sys_open();
+  if (!(*out + 1)) return *out;
+  if (!sys_connect(*out, sys_self_pid())) return 0xffffffffffffffffL;
+  while (1) {
+    uint64_t fd = sys_poll();
+    if (!(fd + 1)) continue;
+    if (fd == 0) {
+      while (sys_read(0, &msg));
+      continue;
+    }
+    while (sys_read(fd, &msg));
+    return fd;
+  }
+}
+
+static uint64_t run_plain(uint64_t out, uint64_t in) {
+  msg_t msg;
+  uint64_t start = sys_get_time();
+  uint64_t i, j;
+  for (i = 0; i < RINGBENCH_ROUNDS; i++) {
+    for (j = 0; j < RINGBENCH_BATCH; j++) {
+      sys_write(out, &j, sizeof(j));
+    }
+    for (j = 0; j < RINGBENCH_BATCH; j++) {
+      sys_read(in, &msg);
+    }
+  }
+  return sys_get_time() - start;
+}
+
+static uint64_t run_ring(uint64_t out, uint64_t in) {
+  // the kernel only copies to and from the stack, so everything lives here
+  msg_t msg;
+  ring_t ring;
+  ring_init(&ring);
+  uint64_t start = sys_get_time();
+  uint64_t i, j;
+  for (i = 0; i < RINGBENCH_ROUNDS; i++) {
+    for (j = 0; j < RINGBENCH_BATCH; j++) {
+      ring_push(&ring, RING_OP_WRITE, out, (uint64_t)&i, sizeof(i), j);
+    }
+    for (j = 0; j < RINGBENCH_BATCH; j++) {
+      ring_push(&ring, RING_OP_READ, in, (uint64_t)&msg, 0, j);
+    }
+    ring_submit(&ring);
+    ring_cqe_t cqe;
+    while (ring_pop(&ring, &cqe));
+  }
+  return sys_get_time() - start;
+}
+
+static void report(const char * name, uint64_t usec) {
+  uint64_t count = RINGBENCH_ROUNDS * RINGBENCH_BATCH;
+  if (!usec) usec = 1;
+  printf("%s  %u messages in %u usec, %u messages/sec\n", name, count, usec,
+         count * 1000000 / usec);
+}
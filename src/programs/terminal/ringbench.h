@@ -0,0 +1 @@
+void command_ringbench();
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include "command.h"
+
+#define SYSCALLSTAT_MAX 0x40
+#define SYSCALLSTAT_TOP 0x10
+
+static const char * names[] = {
+  "print", "get_time", "sleep", "exit", "thread_exit", "wants_interrupts",
+  "get_interrupts", "open_socket", "connect", "close_socket", "write", "read",
+  "poll", "remote_pid", "remote_uid", "in", "out", "set_color", "fork",
+  "mem_usage", "kill", "allocate_page", "allocate_aligned", "free_page",
+  "free_aligned", "vmmap", "vmunmap", "invlpg", "thread_launch", "thread_id",
+  "unsleep", "self_uid", "self_pid", "self_vm_read", "become_pager",
+  "get_fault", "self_vmmap", "self_vmunmap", "self_invlpg", "shift_fault",
+  "abort", "mem_fault", "wake_thread", "batch_vmunmap", "batch_alloc",
+  "batch_vmmap", "clear_unsleep", "batch_vmsample", "lockstat", "futex_wait",
+  "futex_wake", "set_fs_base", "futex_requeue", "futex_lock_pi",
+  "futex_unlock_pi", "set_priority", "ring_enter", "syscallstat"
+};
+
+static bool has_argument(msg_t * msg, const char * arg);
+static uint64_t percentile(syscall_stat_t * stat, uint64_t percent);
+
+void command_syscallstat() {
+  msg_t msg;
+  command_wait(&msg);
+  bool byCount = has_argument(&msg, "count");
+  bool reset = has_argument(&msg, "reset");
+
+  syscall_stat_t stats[SYSCALLSTAT_MAX];
+  uint64_t count = sys_syscallstat(stats, SYSCALLSTAT_MAX,
+                                   reset ? SYSCALL_STAT_RESET : 0);
+
+  // selection sort the top entries to the front of `order`
+  uint64_t order[SYSCALLSTAT_MAX];
+  uint64_t i, j;
+  for (i = 0; i < count; i++) order[i] = i;
+  for (i = 0; i < count && i < SYSCALLSTAT_TOP; i++) {
+    for (j = i + 1; j < count; j++) {
+      syscall_stat_t * best = &stats[order[i]];
+      syscall_stat_t * stat = &stats[order[j]];
+      if (byCount ? stat->calls > best->calls : stat->cycles > best->cycles) {
+        uint64_t temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+      }
+    }
+  }
+
+  printf("syscall            calls      cycles      p50 <      p99 <\n");
+  for (i = 0; i < count && i < SYSCALLSTAT_TOP; i++) {
+    syscall_stat_t * stat = &stats[order[i]];
+    if (!stat->calls) break;
+    const char * name = "?";
+    if (order[i] < sizeof(names) / sizeof(names[0])) name = names[order[i]];
+    printf("0x%x %s    %u    0x%x    0x%x    0x%x\n", order[i], name,
+           stat->calls, stat->cycles, percentile(stat, 50),
+           percentile(stat, 99));
+  }
+  if (reset) printf("syscall statistics reset\n");
+  sys_exit();
+}
+
+static bool has_argument(msg_t * msg, const char * arg) {
+  uint64_t len = strlen(arg);
+  uint64_t i;
+  for (i = 0; i + len <= msg->len; i++) {
+    if (i && msg->message[i - 1] != ' ') continue;
+    if (memcmp(msg->message + i, arg, len)) continue;
+    if (i + len == msg->len || msg->message[i + len] == ' ') return true;
+  }
+  return false;
+}
+
+// returns the bucket bound below which `percent` of the calls finished, or 0
+// if they fall in the last, unbounded bucket
+static uint64_t percentile(syscall_stat_t * stat, uint64_t percent) {
+  // only calls which returned are in the histogram
+  uint64_t returned = 0;
+  int i;
+  for (i = 0; i < SYSCALL_STAT_BUCKETS; i++) returned += stat->buckets[i];
+  if (!returned) return 0;
+
+  uint64_t target = (returned * percent + 99) / 100;
+  uint64_t seen = 0;
+  for (i = 0; i < SYSCALL_STAT_BUCKETS - 1; i++) {
+    seen += stat->buckets[i];
+    if (seen >= target) return 1UL << (i + SYSCALL_STAT_MIN_SHIFT);
+  }
+  return 0;
+}
@@ -164,8 +164,7 @@ static void test_condition_bcast() {
     assert(!res);
   }
   assert(bcast.count == 0x20);
-  assert(!cond.first);
-  assert(!cond.last);
+  assert(!cond.waiters);
 
   pthread_mutex_destroy(&lock);
   pthread_cond_destroy(&cond);
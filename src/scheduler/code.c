@@ -2,8 +2,21 @@
 #include <anscheduler/functions.h>
 #include <anscheduler/task.h>
 
+// the most pages _fault_around_prepare() looks at
+#define FAULT_AROUND_SPAN (CODE_FAULT_AROUND_MIN + CODE_FAULT_AROUND_MAX + 1)
+
 static void _free_code(code_t * code);
 static page_t _alloc_code_page(code_t * code, page_t page);
+static page_t _code_page_count(code_t * code);
+static uint64_t _fault_around_prepare(code_t * code,
+                                      task_t * task,
+                                      page_t codePage,
+                                      page_t * firstOut,
+                                      page_t * phyPages);
+static void _fault_around_install(task_t * task,
+                                  page_t first,
+                                  uint64_t count,
+                                  page_t * phyPages);
 
 static page_t _lookup_page(code_t * code, page_t codePage);
 static bool _map_page(code_t * code, page_t codePage, page_t mapping);
@@ -40,10 +53,10 @@ bool code_handle_page_fault(code_t * code,
   page_t codePage = taskPage - ANSCHEDULER_TASK_CODE_PAGE;
 
   // if it's mapped, return
-  anscheduler_lock(&thread->task->vmLock);
+  anscheduler_read_lock(&thread->task->vmLock);
   uint16_t _flags;
   anscheduler_vm_lookup(thread->task->vm, taskPage, &_flags);
-  anscheduler_unlock(&thread->task->vmLock);
+  anscheduler_read_unlock(&thread->task->vmLock);
   if ((_flags & 7) == 7) return true;
   if ((_flags & 5) && !(flags & 2)) return true;
 
@@ -67,17 +80,26 @@ bool code_handle_page_fault(code_t * code,
     phyFlags = 5; // user, read-only, present
   }
 
-  // map the entry
-  anscheduler_lock(&thread->task->vmLock);
+  // read in the pages around a read fault before taking the write lock
+  page_t aroundPages[FAULT_AROUND_SPAN];
+  page_t aroundFirst = 0;
+  uint64_t aroundCount = 0;
+  if (!(flags & 2)) {
+    aroundCount = _fault_around_prepare(code, thread->task, codePage,
+                                        &aroundFirst, aroundPages);
+  }
+
+  // map the entries
+  anscheduler_write_lock(&thread->task->vmLock);
   anscheduler_vm_map(thread->task->vm, taskPage, phyPage, phyFlags);
-  anscheduler_unlock(&thread->task->vmLock);
+  _fault_around_install(thread->task, aroundFirst, aroundCount, aroundPages);
+  anscheduler_write_unlock(&thread->task->vmLock);
   return true;
 }
 
 void code_task_cleanup(code_t * code, task_t * task) {
   // free write pages
-  page_t codePageCount = code->kernpageLen >> 12;
-  if (code->kernpageLen & 0xfff) codePageCount++;
+  page_t codePageCount = _code_page_count(code);
   uint64_t i;
   for (i = 0; i < codePageCount; i++) {
     uint16_t flags;
@@ -99,7 +121,7 @@ static void _free_code(code_t * code) {
     if (!code->pageTables[i]) continue;
     for (j = 0; j < 0x200; j++) {
       void * buffer = code->pageTables[i][j];
-      if (!buffer) break;
+      if (!buffer) continue;
       anscheduler_cpu_lock();
       anscheduler_free(buffer);
       anscheduler_cpu_unlock();
@@ -127,6 +149,87 @@ static page_t _alloc_code_page(code_t * code, page_t page) {
   return ((page_t)buffer) >> 12;
 }
 
+static page_t _code_page_count(code_t * code) {
+  page_t count = code->kernpageLen >> 12;
+  if (code->kernpageLen & 0xfff) count++;
+  return count;
+}
+
+static uint64_t _fault_around_prepare(code_t * code,
+                                      task_t * task,
+                                      page_t codePage,
+                                      page_t * firstOut,
+                                      page_t * phyPages) {
+  page_t pageCount = _code_page_count(code);
+
+  // a run of mapped pages right behind this one means sequential access
+  uint64_t window = 0;
+  anscheduler_read_lock(&task->vmLock);
+  while (window < CODE_FAULT_AROUND_MAX && window < codePage) {
+    uint16_t flags;
+    page_t page = ANSCHEDULER_TASK_CODE_PAGE + codePage - window - 1;
+    anscheduler_vm_lookup(task->vm, page, &flags);
+    if (!flags) break;
+    window++;
+  }
+  if (window < CODE_FAULT_AROUND_MIN) window = CODE_FAULT_AROUND_MIN;
+
+  page_t first = codePage > CODE_FAULT_AROUND_MIN
+    ? codePage - CODE_FAULT_AROUND_MIN : 0;
+  page_t last = codePage + window;
+  if (last >= pageCount) last = pageCount - 1;
+
+  // mark the pages which the task does not have yet with a 1
+  page_t page;
+  for (page = first; page <= last; page++) {
+    uint16_t flags = 0;
+    if (page != codePage) {
+      page_t taskPage = ANSCHEDULER_TASK_CODE_PAGE + page;
+      anscheduler_vm_lookup(task->vm, taskPage, &flags);
+    }
+    phyPages[page - first] = (page == codePage || flags) ? 0 : 1;
+  }
+  anscheduler_read_unlock(&task->vmLock);
+
+  // fill the code cache without holding the task's vmLock
+  for (page = first; page <= last; page++) {
+    if (!phyPages[page - first]) continue;
+    phyPages[page - first] = 0;
+
+    page_t vPage = _lookup_page(code, page);
+    if (!vPage) {
+      // only read ahead; pages behind us are mapped if they are resident
+      if (page < codePage) continue;
+      vPage = _alloc_code_page(code, page);
+      if (!vPage) break;
+      if (!_map_page(code, page, vPage)) {
+        anscheduler_free((void *)(vPage << 12));
+        break;
+      }
+    }
+    phyPages[page - first] = anscheduler_vm_physical(vPage);
+  }
+  (*firstOut) = first;
+  return page - first;
+}
+
+static void _fault_around_install(task_t * task,
+                                  page_t first,
+                                  uint64_t count,
+                                  page_t * phyPages) {
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    if (!phyPages[i]) continue;
+
+    // another thread may have faulted the page in meanwhile
+    uint16_t flags;
+    page_t taskPage = ANSCHEDULER_TASK_CODE_PAGE + first + i;
+    anscheduler_vm_lookup(task->vm, taskPage, &flags);
+    if (flags) continue;
+    if (!anscheduler_vm_map(task->vm, taskPage, phyPages[i], 5)) return;
+  }
+}
+
 static page_t _lookup_page(code_t * code, page_t codePage) {
   uint64_t rootIndex = codePage >> 9;
   uint64_t subIndex = codePage & 0x1ff;
@@ -6,6 +6,20 @@ typedef struct code_t code_t;
 #include <anscheduler/types.h>
 #define CODE_PAGE_TABLE_COUNT 0x1fd
 
+/**
+ * The number of code pages around a read fault which are mapped in along with
+ * it. The window grows toward CODE_FAULT_AROUND_MAX as a task keeps faulting
+ * in consecutive pages. Pages ahead of the fault are read into the shared code
+ * cache if they are not there yet; pages behind it are only mapped if they
+ * are already resident.
+ */
+#ifndef CODE_FAULT_AROUND_MIN
+#define CODE_FAULT_AROUND_MIN 4
+#endif
+#ifndef CODE_FAULT_AROUND_MAX
+#define CODE_FAULT_AROUND_MAX 0x10
+#endif
+
 struct code_t {
   uint64_t retainCount; // atomic
 
@@ -38,7 +52,8 @@ void code_release(code_t * code);
 /**
  * Allocate the designated page which triggered a fault. When this has finished,
  * it will return `true` or `false`. If `true` is returned, the task should be
- * resumed. Otherwise, it should be terminated.
+ * resumed. Otherwise, it should be terminated. Read faults also map in the
+ * surrounding window of code pages (see CODE_FAULT_AROUND_MIN).
  * @critical
  */
 bool code_handle_page_fault(code_t * code,
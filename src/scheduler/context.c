@@ -1,5 +1,6 @@
 #include "context.h"
 #include "cpu.h"
+#include "pcid.h"
 #include <string.h>
 #include <shared/addresses.h>
 #include <anscheduler/task.h>
@@ -12,6 +13,9 @@ void anscheduler_thread_run(task_t * task, thread_t * thread) {
   tss_t * tss = cpu->tss;
   uint64_t kStack = thread->stack + ANSCHEDULER_TASK_KERN_STACKS_PAGE;
   tss->rsp[0] = ((kStack + 1) << 12);
+  if (thread->state.cr3 != PML4_START) {
+    thread->state.cr3 = pcid_cr3(task, thread->state.cr3);
+  }
   syscall_setup_for_thread(thread);
   thread_run_state(thread);
 }
@@ -36,10 +40,10 @@ void * thread_resume_kernel_stack(thread_t * thread) {
   } else {
     task_t * task = thread->task;
     page_t vmStack = thread->stack + ANSCHEDULER_TASK_KERN_STACKS_PAGE;
-    anscheduler_lock(&task->vmLock);
+    anscheduler_read_lock(&task->vmLock);
     uint16_t flags;
     page_t physical = anscheduler_vm_lookup(task->vm, vmStack, &flags);
-    anscheduler_unlock(&task->vmLock);
+    anscheduler_read_unlock(&task->vmLock);
     return (void *)((1L + kernpage_calculate_virtual(physical)) << 12);
   }
 }
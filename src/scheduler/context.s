@@ -3,6 +3,7 @@ extern anscheduler_cpu_get_thread
 extern kernpage_calculate_virtual
 
 %include "../shared/addresses.s"
+%include "../pcid.s"
 
 global anscheduler_save_return_state
 anscheduler_save_return_state:
@@ -119,6 +120,11 @@ thread_run_state:
   pop r15
   pop rbp
 
+  ; user code runs with the kernel's GS base swapped out
+  test qword [rsp + 8], 3 ; CS
+  jz .iret
+  swapgs
+.iret:
   iretq
 
 ; void thread_switch_to_kernpage();
@@ -140,6 +146,7 @@ thread_switch_to_kernpage:
   mov rsp, rax
 
   mov rax, PML4_START
+  cr3_noflush rax, rcx
   mov cr3, rax
 .return:
   ret
@@ -202,8 +209,10 @@ universal_table_lookup:
   shl rsi, 12 ; make the kernpageAddress a real memory address
   mov rcx, cr3
   mov rax, PML4_START
+  cr3_noflush rax, rdx
   mov cr3, rax
   mov rax, [rdi+rsi] ; rax is return value
+  cr3_noflush rcx, rdx
   mov cr3, rcx
   ret
 
@@ -237,6 +246,8 @@ universal_page_lookup:
   mov rcx, rax
   and rcx, 1 ; make sure first bit is set in page entry
   jz .pageNotFound
+  mov rdx, 0x000ffffffffff000 ; strip the table counts in the ignored bits
+  and rax, rdx
   shr rax, 12
   mov [rbp - 0x10], rax
 
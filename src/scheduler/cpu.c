@@ -1,10 +1,19 @@
 #include "cpu.h"
 #include <interrupts/lapic.h>
 #include <memory/kernpage.h>
+#include <memory/numa.h>
+#include <stdio.h>
 #include <libkern_base.h>
+#include <stddef.h>
+#include <syscall/config.h>
+#include <anscheduler/functions.h>
 
 static cpu_t * firstCPU = NULL;
 static uint64_t count = 0;
+static cpu_t cpus[CPU_MAX] __attribute__((aligned(0x40)));
+
+// the GS base of a CPU which has not been added yet; its `self` is NULL
+cpu_t cpuPlaceholder __attribute__((aligned(0x40)));
 
 uint64_t cpu_count() {
   return count;
@@ -26,17 +35,25 @@ void cpu_add(cpu_t * cpu) {
 }
 
 void cpu_add_current(page_t stack) {
-  uint64_t page = kernpage_alloc_virtual();
-
-  if (!page) return;
-  zero_page(page);
+  if (count >= CPU_MAX) die("too many CPUs for the cpu_t table");
 
-  cpu_t * cpu = (cpu_t *)(page << 12);
+  cpu_t * cpu = &cpus[count];
+  anscheduler_zero(cpu, sizeof(cpu_t));
+  cpu->self = cpu;
   cpu->cpuId = lapic_get_id();
+  cpu->numaNode = numa_node_for_apic(cpu->cpuId);
   cpu->baseStack = stack;
   cpu->tssSelector = (uint16_t)gdt_get_size();
   cpu->tss = gdt_add_tss();
   cpu_add(cpu);
+
+  // nothing runs in user mode yet, so the kernel's GS base is the live one
+  msr_write(MSR_GS_BASE, (uint64_t)cpu);
+  msr_write(MSR_KERNEL_GS_BASE, 0);
+}
+
+cpu_t * cpu_first() {
+  return firstCPU;
 }
 
 cpu_t * cpu_lookup(uint32_t ident) {
@@ -49,7 +66,11 @@ cpu_t * cpu_lookup(uint32_t ident) {
 }
 
 cpu_t * cpu_current() {
-  return cpu_lookup(lapic_get_id());
+  cpu_t * cpu;
+  __asm__ __volatile__("mov %%gs:%c1, %0"
+                       : "=r" (cpu)
+                       : "i" (offsetof(cpu_t, self)));
+  return cpu;
 }
 
 void * cpu_dedicated_stack() {
@@ -71,15 +92,20 @@ void anscheduler_cpu_unlock() {
 }
 
 task_t * anscheduler_cpu_get_task() {
-  cpu_t * cpu = cpu_current();
-  if (!cpu) return NULL;
-  return cpu->task;
+  // the placeholder's fields are NULL, so this needs no check
+  task_t * task;
+  __asm__ __volatile__("mov %%gs:%c1, %0"
+                       : "=r" (task)
+                       : "i" (offsetof(cpu_t, task)));
+  return task;
 }
 
 thread_t * anscheduler_cpu_get_thread() {
-  cpu_t * cpu = cpu_current();
-  if (!cpu) return NULL;
-  return cpu->thread;
+  thread_t * thread;
+  __asm__ __volatile__("mov %%gs:%c1, %0"
+                       : "=r" (thread)
+                       : "i" (offsetof(cpu_t, thread)));
+  return thread;
 }
 
 void anscheduler_cpu_set_task(task_t * task) {
@@ -95,13 +121,15 @@ void anscheduler_cpu_set_thread(thread_t * thread) {
 }
 
 void anscheduler_cpu_notify_invlpg(task_t * task) {
-  cpu_t * cpu = firstCPU;
-  while (cpu) {
-    if (cpu->task == task) {
-      lapic_send_ipi(cpu->cpuId, 0x31, 0, 1, 0);
-    }
-    cpu = cpu->next;
-  }
+  tlb_queue_full(task);
+  tlb_flush_pending(task);
+}
+
+void anscheduler_cpu_notify_invlpg_range(task_t * task,
+                                         uint64_t start,
+                                         uint64_t count) {
+  tlb_queue(task, start, count);
+  tlb_flush_pending(task);
 }
 
 void anscheduler_cpu_notify_dead(task_t * task) {
@@ -1,25 +1,69 @@
 #include <anscheduler/types.h>
 #include "gdt.h"
+#include "tlb.h"
+#include "pcid.h"
+#include <anlock.h>
+#include <syscall/stats.h>
 
 /**
  * The cpu_ functions helps manage the CPU list and access CPU specific fields.
  */
 
+#define CPU_LOCK_SLOTS 8
+#define CPU_READ_SLOTS 4
+
+// cpu_t structures live in the kernel image, which every task maps, so that
+// the syscall entry can use them before it switches page tables
+#define CPU_MAX 0x20
+
 typedef struct cpu_t cpu_t;
 
-struct cpu_t {
-  cpu_t * next; // linked list
-  page_t baseStack;
+/**
+ * The MCS queue node for one lock held or awaited by a CPU.
+ */
+typedef struct {
+  anlock_node_t node;
+  uint64_t * lock;
+} __attribute__((packed)) cpu_lock_slot_t;
 
+/**
+ * While a CPU runs kernel code, its GS base points at its cpu_t. User code
+ * runs with the GS base swapped out into MSR_KERNEL_GS_BASE, and every entry
+ * from user mode swaps it back in.
+ */
+struct cpu_t {
+  cpu_t * self; // so cpu_current() is a single load
   task_t * task;
   thread_t * thread;
+  uint64_t taskStack; // running thread's kernel stack, as mapped in its task
+  uint64_t kernStack; // the same stack in the kernel's address space
+
+  cpu_t * next; // linked list
+  page_t baseStack;
 
   tss_t * tss;
   uint32_t cpuId;
   uint16_t tssSelector;
+  uint8_t numaNode;
+  uint64_t allocHint; // the anmem allocator which last gave us a local page
+
+  // the shootdown this CPU has been asked to perform, if any
+  tlb_request_t * volatile tlbRequest;
+
+  // address spaces which have a PCID on this CPU
+  uint8_t pcidEnabled;
+  uint64_t pcidClock;
+  pcid_slot_t pcids[PCID_SLOTS];
 
-  // code which runs when syscall happens; should push rsp and rcx etc.
-  uint8_t syscallCode[32];
+  // MCS nodes for the locks this CPU is holding or waiting on
+  cpu_lock_slot_t lockSlots[CPU_LOCK_SLOTS];
+
+  // reader-writer locks this CPU holds for reading; a writer waits until no
+  // CPU lists its lock here
+  uint64_t * volatile readSlots[CPU_READ_SLOTS];
+
+  // SYSCALL_COUNT counters, allocated by the first syscall on this CPU
+  syscall_stat_t * syscallStats;
 } __attribute__((packed));
 
 /**
@@ -38,13 +82,18 @@ void cpu_add(cpu_t * cpu);
  */
 void cpu_add_current(page_t stack);
 
+/**
+ * Returns the first CPU in the CPU list.
+ */
+cpu_t * cpu_first();
+
 /**
  * Finds a CPU in the CPU list with a given APIC ID.
  */
 cpu_t * cpu_lookup(uint32_t ident);
 
 /**
- * Finds the CPU in the list with the current local APIC ID.
+ * Returns the CPU we are running on, or NULL before it has been added.
  */
 cpu_t * cpu_current();
 
@@ -60,6 +109,9 @@ thread_t * anscheduler_cpu_get_thread();
 void anscheduler_cpu_set_task(task_t * task);
 void anscheduler_cpu_set_thread(thread_t * thread);
 void anscheduler_cpu_notify_invlpg(task_t * task);
+void anscheduler_cpu_notify_invlpg_range(task_t * task,
+                                         uint64_t start,
+                                         uint64_t count);
 void anscheduler_cpu_notify_dead(task_t * task);
 void anscheduler_cpu_stack_run(void * arg, void (* fn)(void *));
 void anscheduler_cpu_halt();
@@ -1,8 +1,40 @@
 #include "general.h"
+#include "cpu.h"
 #include <memory/kernpage.h>
 #include <anlock.h>
 #include <stdio.h>
 
+/**
+ * Reader-writer locks keep their readers in per-CPU slots, so readers only
+ * ever write to their own cpu_t. The lock word itself is a ticket lock which
+ * only writers take; readers merely watch it.
+ */
+
+#define RW_WRITERS 0xffffffffUL // the ticket lock's count of holders
+
+static uint64_t * volatile bootReadSlots[CPU_READ_SLOTS];
+
+static uint64_t * volatile * _read_slots();
+static void _wait_for_readers(uint64_t * volatile * slots, uint64_t * ptr);
+
+/**
+ * anscheduler_lock() uses queued MCS locks, so a contended lock does not make
+ * every waiting CPU spin on the same cache line. Define
+ * ANSCHEDULER_TICKET_LOCKS to use plain ticket locks instead. Every lock is
+ * taken in a critical section, so a CPU cannot migrate while holding one and
+ * each CPU can keep its queue nodes in its cpu_t.
+ */
+
+#ifndef ANSCHEDULER_TICKET_LOCKS
+#define ANSCHEDULER_MCS_LOCKS
+#endif
+
+#ifdef ANSCHEDULER_MCS_LOCKS
+static cpu_lock_slot_t bootSlots[CPU_LOCK_SLOTS];
+
+static cpu_lock_slot_t * _lock_slots();
+#endif
+
 void * anscheduler_alloc(uint64_t size) {
   if (size > 0x1000) return NULL;
   void * ptr = (void *)(kernpage_alloc_virtual() << 12);
@@ -14,11 +46,89 @@ void anscheduler_free(void * buffer) {
 }
 
 void anscheduler_lock(uint64_t * ptr) {
+#ifdef ANSCHEDULER_MCS_LOCKS
+  cpu_lock_slot_t * slots = _lock_slots();
+  int i;
+  for (i = 0; i < CPU_LOCK_SLOTS; i++) {
+    if (slots[i].lock) continue;
+    slots[i].lock = ptr;
+    anlock_mcs_lock(ptr, &slots[i].node);
+    return;
+  }
+  anscheduler_abort("out of MCS lock slots");
+#else
   anlock_lock(ptr);
+#endif
 }
 
 void anscheduler_unlock(uint64_t * ptr) {
+#ifdef ANSCHEDULER_MCS_LOCKS
+  cpu_lock_slot_t * slots = _lock_slots();
+  int i;
+  for (i = 0; i < CPU_LOCK_SLOTS; i++) {
+    if (slots[i].lock != ptr) continue;
+    anlock_mcs_unlock(ptr, &slots[i].node);
+    slots[i].lock = NULL;
+    return;
+  }
+  anscheduler_abort("unlocked a lock this CPU does not hold");
+#else
   anlock_unlock(ptr);
+#endif
+}
+
+void anscheduler_read_lock(uint64_t * ptr) {
+  uint64_t * volatile * slots = _read_slots();
+  int i;
+  for (i = 0; i < CPU_READ_SLOTS; i++) {
+    if (slots[i]) continue;
+    while (1) {
+      slots[i] = ptr;
+      // the slot must be visible before we look for a writer
+      __sync_synchronize();
+      if (!(*(volatile uint64_t *)ptr & RW_WRITERS)) return;
+      slots[i] = NULL;
+      while (*(volatile uint64_t *)ptr & RW_WRITERS) {
+        __asm__ __volatile__("pause" : : : "memory");
+      }
+    }
+  }
+  anscheduler_abort("out of read lock slots");
+}
+
+void anscheduler_read_unlock(uint64_t * ptr) {
+  uint64_t * volatile * slots = _read_slots();
+  int i;
+  for (i = 0; i < CPU_READ_SLOTS; i++) {
+    if (slots[i] != ptr) continue;
+    __asm__ __volatile__("" : : : "memory");
+    slots[i] = NULL;
+    return;
+  }
+  anscheduler_abort("read unlocked a lock this CPU does not hold");
+}
+
+void anscheduler_write_lock(uint64_t * ptr) {
+  anlock_lock(ptr);
+  // new readers now back off; wait for the ones already inside
+  __sync_synchronize();
+  _wait_for_readers(bootReadSlots, ptr);
+  cpu_t * cpu;
+  for (cpu = cpu_first(); cpu; cpu = cpu->next) {
+    _wait_for_readers(cpu->readSlots, ptr);
+  }
+}
+
+void anscheduler_write_unlock(uint64_t * ptr) {
+  anlock_unlock(ptr);
+}
+
+void anscheduler_lock_name(uint64_t * ptr, const char * name) {
+  anlock_name(ptr, name);
+}
+
+void anscheduler_lock_forget(uint64_t * ptr) {
+  anlock_forget(ptr);
 }
 
 void anscheduler_abort(const char * error) {
@@ -52,3 +162,27 @@ void anscheduler_or_32(uint32_t * ptr, uint32_t flag) {
   __asm__("lock orl %0, (%1)" : : "r" (flag), "r" (ptr) : "memory");
 }
 
+static uint64_t * volatile * _read_slots() {
+  cpu_t * cpu = cpu_current();
+  // before the CPU list exists only the boot processor is running
+  if (!cpu) return bootReadSlots;
+  return cpu->readSlots;
+}
+
+static void _wait_for_readers(uint64_t * volatile * slots, uint64_t * ptr) {
+  int i;
+  for (i = 0; i < CPU_READ_SLOTS; i++) {
+    while (slots[i] == ptr) {
+      __asm__ __volatile__("pause" : : : "memory");
+    }
+  }
+}
+
+#ifdef ANSCHEDULER_MCS_LOCKS
+static cpu_lock_slot_t * _lock_slots() {
+  cpu_t * cpu = cpu_current();
+  // before the CPU list exists only the boot processor is running
+  if (!cpu) return bootSlots;
+  return cpu->lockSlots;
+}
+#endif
@@ -1,6 +1,13 @@
 #include "code.h"
+#include <syscall/futex.h>
+#include <syscall/taskinfo.h>
 
 void anscheduler_task_cleanup(task_t * task) {
   code_task_cleanup(task->ui.code, task);
+  taskinfo_cleanup(task);
+}
+
+void anscheduler_thread_cleanup(thread_t * thread) {
+  futex_thread_cleanup(thread);
 }
 
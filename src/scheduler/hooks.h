@@ -1,4 +1,5 @@
 #include <anscheduler/types.h>
 
 void anscheduler_task_cleanup(task_t * task);
+void anscheduler_thread_cleanup(thread_t * thread);
 
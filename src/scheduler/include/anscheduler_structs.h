@@ -1,24 +1,5 @@
 #include "../code.h"
-
-/**
- * Equivalent to this:
- *********************
- * xor ax, ax
- * mov ss, ax
- * mov r11, rsp
- * mov rsp, NEW_STACK
- * mov rax, KERN_ADDR
- * jmp rax
- ***************************/
-typedef struct {
-  char code1[0xa]; // 66 31 C0 8E D0 49 89 E3 48 BC
-  uint64_t stack;
-  char code2[2]; // 48 B8
-  uint64_t kernCall;
-  char code3[2]; // FF E0
-
-  char reserved[2]; // alignment
-} __attribute__((packed)) syscall_code;
+#include "../tlb.h"
 
 typedef struct {
   uint64_t rsp;
@@ -48,15 +29,34 @@ typedef struct {
   uint64_t reserved;
   char fxState[0x200];
 
-  syscall_code callCode;
+  // top of the kernel stack in the kernel's address space, where syscalls
+  // move to once they need the kernel's page table
+  uint64_t kernStack;
 
   uint64_t sleepLock;
   bool unsleepReq;
   bool isSleeping;
   char alignment[6];
+
+  // futex wait queue linkage, guarded by the futex bucket lock
+  thread_t * futexNext;
+  uint64_t futexAddr;
+  uint64_t futexWoken;
+
+  // priority inheritance, guarded by the futex PI lock
+  thread_t * piNext; // next thread blocked on a PI futex
+  thread_t * piOwner; // the thread holding the PI futex we are blocked on
+  uint64_t piFlags;
+
+  // user TLS thread pointer, loaded into MSR_FS_BASE whenever the thread runs
+  uint64_t fsBase;
 } __attribute__((packed)) anscheduler_state;
 
 typedef struct {
   code_t * code;
+  tlb_batch_t tlbPending; // page ranges waiting for a shootdown
+  uint64_t tlbGen; // number of shootdowns sent for this task
+  uint64_t asid; // unique address space number for PCIDs; 0 if unassigned
+  void * info; // the read-only taskinfo_t page mapped into the task
 } __attribute__((packed)) anscheduler_task_ui_t;
 
@@ -0,0 +1,122 @@
+#include "pcid.h"
+#include "cpu.h"
+
+#define CR4_PCIDE (1UL << 17)
+#define CPUID1_ECX_PCID (1 << 17)
+#define CPUID7_EBX_INVPCID (1 << 10)
+#define CR3_ADDRESS_MASK 0x000ffffffffff000UL
+
+typedef struct {
+  uint64_t pcid;
+  uint64_t address;
+} __attribute__((packed)) invpcid_desc_t;
+
+static uint64_t nextAsid __attribute__((aligned(8))) = 0;
+
+static void _cpuid(uint32_t leaf, uint32_t * regs);
+static uint64_t _task_asid(task_t * task);
+static void _invpcid(uint64_t type, uint64_t pcid, uint64_t address);
+
+void pcid_initialize() {
+  uint32_t regs[4];
+  _cpuid(0, regs);
+  if (regs[0] < 7) return;
+  _cpuid(1, regs);
+  if (!(regs[2] & CPUID1_ECX_PCID)) return;
+  _cpuid(7, regs);
+  if (!(regs[1] & CPUID7_EBX_INVPCID)) return;
+
+  // CR3 holds the kernel page table with PCID 0 at this point, as required
+  // for setting CR4.PCIDE
+  uint64_t cr4;
+  __asm__ __volatile__("mov %%cr4, %0" : "=r" (cr4));
+  cr4 |= CR4_PCIDE;
+  __asm__ __volatile__("mov %0, %%cr4" : : "r" (cr4));
+  cpu_current()->pcidEnabled = 1;
+}
+
+bool pcid_enabled() {
+  cpu_t * cpu = cpu_current();
+  if (!cpu) return false;
+  return cpu->pcidEnabled != 0;
+}
+
+uint64_t pcid_cr3(task_t * task, uint64_t cr3) {
+  cpu_t * cpu = cpu_current();
+  cr3 &= CR3_ADDRESS_MASK;
+  if (!cpu->pcidEnabled) return cr3;
+
+  uint64_t asid = _task_asid(task);
+
+  // cpu->task was stored before this; a shootdown either sees us running the
+  // task, or we see the generation it bumped
+  __sync_synchronize();
+  uint64_t gen = task->ui.tlbGen;
+
+  cpu->pcidClock++;
+  pcid_slot_t * slot = pcid_lookup(task);
+  if (slot) {
+    slot->lastUse = cpu->pcidClock;
+    if (slot->gen == gen) return cr3 | pcid_for_slot(slot) | PCID_NOFLUSH;
+  } else {
+    int i;
+    slot = &cpu->pcids[0];
+    for (i = 1; i < PCID_SLOTS; i++) {
+      if (cpu->pcids[i].lastUse < slot->lastUse) slot = &cpu->pcids[i];
+    }
+    slot->asid = asid;
+    slot->lastUse = cpu->pcidClock;
+  }
+
+  // loading without the no-flush bit discards whatever the PCID held
+  slot->gen = gen;
+  return cr3 | pcid_for_slot(slot);
+}
+
+pcid_slot_t * pcid_lookup(task_t * task) {
+  cpu_t * cpu = cpu_current();
+  if (!cpu || !cpu->pcidEnabled || !task->ui.asid) return NULL;
+  int i;
+  for (i = 0; i < PCID_SLOTS; i++) {
+    if (cpu->pcids[i].asid == task->ui.asid) return &cpu->pcids[i];
+  }
+  return NULL;
+}
+
+uint64_t pcid_for_slot(pcid_slot_t * slot) {
+  cpu_t * cpu = cpu_current();
+  return (uint64_t)(slot - cpu->pcids) + 1;
+}
+
+void pcid_invalidate_page(uint64_t pcid, uint64_t page) {
+  _invpcid(0, pcid, page << 12);
+}
+
+void pcid_invalidate_all(uint64_t pcid) {
+  _invpcid(1, pcid, 0);
+}
+
+static void _cpuid(uint32_t leaf, uint32_t * regs) {
+  __asm__ __volatile__("cpuid"
+                       : "=a" (regs[0]), "=b" (regs[1]),
+                         "=c" (regs[2]), "=d" (regs[3])
+                       : "a" (leaf), "c" (0));
+}
+
+static uint64_t _task_asid(task_t * task) {
+  // task structures get reused, so a PCID is tied to a number which is never
+  // handed out twice rather than to the task's address
+  if (!task->ui.asid) {
+    uint64_t asid = __sync_add_and_fetch(&nextAsid, 1);
+    __sync_bool_compare_and_swap(&task->ui.asid, 0, asid);
+  }
+  return task->ui.asid;
+}
+
+static void _invpcid(uint64_t type, uint64_t pcid, uint64_t address) {
+  invpcid_desc_t desc;
+  desc.pcid = pcid;
+  desc.address = address;
+  __asm__ __volatile__("invpcid %0, %1"
+                       : : "m" (desc), "r" (type) : "memory");
+}
@@ -0,0 +1,69 @@
+#ifndef __SCHEDULER_PCID_H__
+#define __SCHEDULER_PCID_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Process-context identifiers let the TLB keep the translations of several
+ * address spaces at once. Each CPU hands out PCID_SLOTS identifiers to the
+ * tasks it runs, recycling the least recently used one; PCID 0 belongs to the
+ * kernel page table.
+ */
+#define PCID_SLOTS 0x10
+#define PCID_NOFLUSH (1UL << 63)
+
+/**
+ * A PCID owned by an address space on one CPU. `gen` is the task's TLB
+ * generation as of the last time this CPU invalidated the PCID.
+ */
+typedef struct {
+  uint64_t asid;
+  uint64_t gen;
+  uint64_t lastUse;
+} __attribute__((packed)) pcid_slot_t;
+
+#include <anscheduler/types.h>
+
+/**
+ * Enable PCIDs on the current CPU if it supports both PCID and INVPCID.
+ */
+void pcid_initialize();
+
+/**
+ * Returns true if PCIDs are enabled on the current CPU.
+ */
+bool pcid_enabled();
+
+/**
+ * Compute the CR3 value to switch into a task's address space on the current
+ * CPU. The no-flush bit is set only if this CPU's translations for the task
+ * are up to date with every shootdown sent to it.
+ * @param cr3 The task's CR3; any PCID bits in it are ignored.
+ * @critical The task must already be set as the CPU's current task.
+ */
+uint64_t pcid_cr3(task_t * task, uint64_t cr3);
+
+/**
+ * Returns the current CPU's slot for a task, or NULL if the task has no PCID
+ * on this CPU.
+ * @critical
+ */
+pcid_slot_t * pcid_lookup(task_t * task);
+
+/**
+ * Returns the PCID for a slot returned by pcid_lookup().
+ */
+uint64_t pcid_for_slot(pcid_slot_t * slot);
+
+/**
+ * Invalidate a single page for a PCID.
+ */
+void pcid_invalidate_page(uint64_t pcid, uint64_t page);
+
+/**
+ * Invalidate every non-global translation for a PCID.
+ */
+void pcid_invalidate_all(uint64_t pcid);
+
+#endif
@@ -0,0 +1,163 @@
+#include "tlb.h"
+#include "cpu.h"
+#include "pcid.h"
+#include <interrupts/lapic.h>
+#include <anscheduler/functions.h>
+#include <libkern_base.h>
+#include <anlock.h>
+
+#define TLB_IPI_VECTOR 0x31
+
+static uint64_t shootdownLock __attribute__((aligned(8))) = 0;
+
+static uint64_t _batch_pages(tlb_batch_t * batch);
+static void _batch_apply(tlb_batch_t * batch);
+static void _request_apply(tlb_request_t * request);
+static void _service(void * unused);
+
+void tlb_batch_add(tlb_batch_t * batch, uint64_t start, uint64_t count) {
+  if (batch->full || !count) return;
+
+  uint64_t i;
+  for (i = 0; i < batch->rangeCount; i++) {
+    tlb_range_t * range = &batch->ranges[i];
+    uint64_t end = range->start + range->count;
+    if (start > end || start + count < range->start) continue;
+    if (start + count > end) end = start + count;
+    if (start < range->start) range->start = start;
+    range->count = end - range->start;
+    break;
+  }
+  if (i == batch->rangeCount) {
+    if (batch->rangeCount == TLB_MAX_RANGES) {
+      batch->full = 1;
+      return;
+    }
+    batch->ranges[i].start = start;
+    batch->ranges[i].count = count;
+    batch->rangeCount++;
+  }
+
+  if (_batch_pages(batch) > TLB_FULL_FLUSH_PAGES) {
+    batch->full = 1;
+  }
+}
+
+void tlb_queue(task_t * task, uint64_t start, uint64_t count) {
+  tlb_batch_t * batch = &task->ui.tlbPending;
+  anscheduler_lock(&batch->lock);
+  tlb_batch_add(batch, start, count);
+  anscheduler_unlock(&batch->lock);
+}
+
+void tlb_queue_full(task_t * task) {
+  tlb_batch_t * batch = &task->ui.tlbPending;
+  anscheduler_lock(&batch->lock);
+  batch->full = 1;
+  anscheduler_unlock(&batch->lock);
+}
+
+void tlb_flush_pending(task_t * task) {
+  tlb_request_t request;
+
+  // take the pending batch so that new changes can queue up behind us
+  tlb_batch_t * pending = &task->ui.tlbPending;
+  anscheduler_lock(&pending->lock);
+  request.batch = *pending;
+  pending->full = 0;
+  pending->rangeCount = 0;
+  anscheduler_unlock(&pending->lock);
+  if (!request.batch.full && !request.batch.rangeCount) return;
+  request.task = task;
+  request.acks = 0;
+
+  // only one shootdown is in flight at once; keep answering requests aimed
+  // at this CPU while we wait, or two CPUs could wait on each other forever
+  anlock_lock_waiting(&shootdownLock, NULL, _service);
+
+  // CPUs which are not running the task now notice the new generation the
+  // next time they switch to it, and flush the PCID they had for it
+  request.gen = __sync_add_and_fetch(&task->ui.tlbGen, 1);
+
+  cpu_t * current = cpu_current();
+  cpu_t * cpu;
+  for (cpu = cpu_first(); cpu; cpu = cpu->next) {
+    if (cpu == current || cpu->task != task) continue;
+    __sync_fetch_and_add(&request.acks, 1);
+    cpu->tlbRequest = &request;
+    lapic_send_ipi(cpu->cpuId, TLB_IPI_VECTOR, 0, 1, 0);
+  }
+  if (current && current->task == task) {
+    _request_apply(&request);
+  }
+
+  while (__sync_fetch_and_add(&request.acks, 0)) {
+    _service(NULL);
+    __asm__ __volatile__("pause");
+  }
+  anlock_unlock(&shootdownLock);
+}
+
+void tlb_handle_ipi() {
+  _service(NULL);
+}
+
+static uint64_t _batch_pages(tlb_batch_t * batch) {
+  uint64_t i, total = 0;
+  for (i = 0; i < batch->rangeCount; i++) {
+    total += batch->ranges[i].count;
+  }
+  return total;
+}
+
+static void _batch_apply(tlb_batch_t * batch) {
+  if (batch->full) {
+    __asm__ __volatile__("mov %%cr3, %%rax\n"
+                         "mov %%rax, %%cr3"
+                         : : : "rax", "memory");
+    return;
+  }
+  uint64_t i, j;
+  for (i = 0; i < batch->rangeCount; i++) {
+    tlb_range_t * range = &batch->ranges[i];
+    for (j = 0; j < range->count; j++) {
+      invalidate_page(range->start + j);
+    }
+  }
+}
+
+static void _request_apply(tlb_request_t * request) {
+  if (!pcid_enabled()) {
+    _batch_apply(&request->batch);
+    return;
+  }
+
+  // we run on the kernel's PCID here, so invlpg would not reach the task's
+  // translations
+  pcid_slot_t * slot = pcid_lookup(request->task);
+  if (!slot || slot->gen >= request->gen) return;
+  uint64_t pcid = pcid_for_slot(slot);
+  tlb_batch_t * batch = &request->batch;
+  if (batch->full || slot->gen + 1 != request->gen) {
+    pcid_invalidate_all(pcid);
+  } else {
+    uint64_t i, j;
+    for (i = 0; i < batch->rangeCount; i++) {
+      tlb_range_t * range = &batch->ranges[i];
+      for (j = 0; j < range->count; j++) {
+        pcid_invalidate_page(pcid, range->start + j);
+      }
+    }
+  }
+  slot->gen = request->gen;
+}
+
+static void _service(void * unused) {
+  cpu_t * cpu = cpu_current();
+  if (!cpu) return;
+  tlb_request_t * request = cpu->tlbRequest;
+  if (!request) return;
+  cpu->tlbRequest = NULL;
+  _request_apply(request);
+  __sync_fetch_and_sub(&request->acks, 1);
+}
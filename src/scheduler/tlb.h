@@ -0,0 +1,80 @@
+#ifndef __SCHEDULER_TLB_H__
+#define __SCHEDULER_TLB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A shootdown covering more than this many pages flushes the whole address
+ * space instead of issuing an invlpg for every page.
+ */
+#ifndef TLB_FULL_FLUSH_PAGES
+#define TLB_FULL_FLUSH_PAGES 0x20
+#endif
+
+#define TLB_MAX_RANGES 8
+
+typedef struct {
+  uint64_t start;
+  uint64_t count;
+} __attribute__((packed)) tlb_range_t;
+
+/**
+ * A set of virtual page ranges which need to be invalidated. When `full` is
+ * set, the ranges are meaningless and the entire address space is flushed.
+ */
+typedef struct {
+  uint64_t lock;
+  uint64_t full;
+  uint64_t rangeCount;
+  tlb_range_t ranges[TLB_MAX_RANGES];
+} __attribute__((packed)) tlb_batch_t;
+
+/**
+ * A shootdown in flight. `acks` is the number of CPUs which have yet to
+ * perform the invalidation, and `gen` is the task's TLB generation once the
+ * shootdown completes.
+ */
+typedef struct {
+  tlb_batch_t batch;
+  struct task_t * task;
+  uint64_t gen;
+  uint64_t acks;
+} __attribute__((packed)) tlb_request_t;
+
+#include <anscheduler/types.h>
+
+/**
+ * Add a range of pages to a batch, merging it with an adjacent or overlapping
+ * range where possible. The batch degrades to a full flush if it runs out of
+ * ranges or covers more than TLB_FULL_FLUSH_PAGES pages. Does not lock.
+ */
+void tlb_batch_add(tlb_batch_t * batch, uint64_t start, uint64_t count);
+
+/**
+ * Record that a range of a task's page table entries changed. The change is
+ * not visible to other CPUs until tlb_flush_pending() is called.
+ * @critical
+ */
+void tlb_queue(task_t * task, uint64_t start, uint64_t count);
+
+/**
+ * Record that the whole address space of a task changed.
+ * @critical
+ */
+void tlb_queue_full(task_t * task);
+
+/**
+ * Shoot down every range queued for a task on every CPU running it, and wait
+ * for each of them to acknowledge. Does nothing if nothing was queued.
+ * @critical Do not hold any lock besides the CPU lock while calling this.
+ */
+void tlb_flush_pending(task_t * task);
+
+/**
+ * Called on the receiving CPU for the shootdown IPI.
+ * @critical
+ */
+void tlb_handle_ipi();
+
+#endif
@@ -2,9 +2,48 @@
 #include <memory/kernpage.h>
 #include <anscheduler/functions.h>
 
+/**
+ * Every table keeps its own bookkeeping in bits 52-61 of its first three
+ * entries, which the MMU ignores: the number of non-zero entries, the number
+ * of entries with the user flag, and the number with the write flag. This
+ * lets an unmap decide whether to free a table or drop flags from its parent
+ * without scanning all 512 entries. The MMU may set the accessed and dirty
+ * bits of an entry at any time, so entries are only ever changed atomically.
+ */
+#define VM_COUNT_SHIFT 52
+#define VM_COUNT_MASK (0x3ffUL << VM_COUNT_SHIFT)
+#define VM_ADDRESS_MASK 0x000ffffffffff000UL
+
+#define VM_COUNT_USED 0
+#define VM_COUNT_USER 1
+#define VM_COUNT_WRITE 2
+
+static void _indices(uint64_t vpage, uint64_t * indices);
+static uint64_t _entry(uint64_t * table, uint64_t idx);
+static uint64_t * _entry_table(uint64_t entry);
+static uint64_t _count(uint64_t * table, int which);
+static void _count_add(uint64_t * table, int which, int delta);
+static uint64_t _update_entry(uint64_t * table,
+                              uint64_t idx,
+                              uint64_t clear,
+                              uint64_t set);
+static void _set_entry(uint64_t * table, uint64_t idx, uint64_t value);
+static bool _sync_entry(uint64_t * table, uint64_t idx, uint64_t * child);
+static void _propagate(uint64_t ** tables, uint64_t * indices, int level);
+static void _release(uint64_t ** tables, uint64_t * indices, int level);
+static void _unmap_range(uint64_t * table,
+                         int depth,
+                         uint64_t base,
+                         uint64_t start,
+                         uint64_t end,
+                         void * data,
+                         void (* fn)(void * data, uint64_t page, uint16_t f));
+static void _table_drop(uint64_t * table,
+                        int depth,
+                        void * data,
+                        void (* fn)(void * data, uint64_t page, uint16_t f));
 static void _table_free(uint64_t * table, int depth);
 static void _table_free_async(uint64_t * table, int depth);
-static void _backclear(uint64_t * indices, uint64_t ** tables);
 
 uint64_t anscheduler_vm_physical(uint64_t virt) {
   return kernpage_calculate_physical(virt);
@@ -24,82 +63,81 @@ bool anscheduler_vm_map(void * root,
                         uint64_t vpage,
                         uint64_t dpage,
                         uint16_t flags) {
-  uint64_t ptIndex = vpage & 0x1ff;
-  uint64_t pdtIndex = (vpage >> 9) & 0x1ff;
-  uint64_t pdptIndex = (vpage >> 18) & 0x1ff;
-  uint64_t pml4Index = (vpage >> 27) & 0x1ff;
-  uint64_t indices[3] = {pml4Index, pdptIndex, pdtIndex};
-  
+  // a page number past the address bits would spill into the counts
+  if (dpage & ~(VM_ADDRESS_MASK >> 12)) return false;
+
+  uint64_t indices[4];
+  uint64_t * tables[4] = {(uint64_t *)root, NULL, NULL, NULL};
+  _indices(vpage, indices);
+
   int i;
-  uint64_t * table = (uint64_t *)root;
   for (i = 0; i < 3; i++) {
-    uint64_t idx = indices[i];
-    if (table[idx] & 1) {
-      // make sure all needed flags are set
-      if (flags & 4) table[idx] |= 4;
-      if (flags & 2) table[idx] |= 2;
-      table = (uint64_t *)((((uint64_t)table[idx]) >> 12) << 12);
+    uint64_t entry = _entry(tables[i], indices[i]);
+    if (entry & 1) {
+      tables[i + 1] = _entry_table(entry);
     } else {
       void * nextTable = anscheduler_alloc(0x1000);
+      if (!nextTable) return false;
       anscheduler_zero(nextTable, 0x1000);
-      table[idx] = 1 | ((uint64_t)nextTable);
-      if (flags & 4) table[idx] |= 4;
-      if (flags & 2) table[idx] |= 2;
-      table = (uint64_t *)nextTable;
+      uint64_t phys = kernpage_calculate_physical(((uint64_t)nextTable) >> 12);
+      _set_entry(tables[i], indices[i], 1 | (phys << 12));
+      tables[i + 1] = (uint64_t *)nextTable;
     }
   }
-  
-  table[ptIndex] = (dpage << 12) | flags;
+
+  _set_entry(tables[3], indices[3],
+             ((dpage << 12) & VM_ADDRESS_MASK) | (flags & 0xfff));
+  _propagate(tables, indices, 3);
   return true;
 }
 
 void anscheduler_vm_unmap(void * root, uint64_t vpage) {
-  uint64_t * tablePtr = (uint64_t *)root;
-
-  uint64_t indexInPT = vpage & 0x1ff;
-  uint64_t indexInPDT = (vpage >> 9) & 0x1ff;
-  uint64_t indexInPDPT = (vpage >> 18) & 0x1ff;
-  uint64_t indexInPML4 = (vpage >> 27) & 0x1ff;
-  uint64_t indices[4] = {indexInPML4, indexInPDPT, indexInPDT, indexInPT};
-  uint64_t * tablePtrs[4] = {tablePtr, NULL, NULL, NULL};
-  int i;
+  uint64_t indices[4];
+  uint64_t * tables[4] = {(uint64_t *)root, NULL, NULL, NULL};
+  _indices(vpage, indices);
 
+  int i;
   for (i = 0; i < 3; i++) {
-    uint64_t value = tablePtr[indices[i]];
-    if (!(value & 1)) return;
-    uint64_t physPage = value >> 12;
-    uint64_t virPage = kernpage_calculate_virtual(physPage);
-    if (!virPage) return;
-    tablePtr = (uint64_t *)(virPage << 12);
-    tablePtrs[i + 1] = tablePtr;
+    uint64_t entry = _entry(tables[i], indices[i]);
+    if (!(entry & 1)) return;
+    tables[i + 1] = _entry_table(entry);
   }
 
-  tablePtr[indices[3]] = 0;
+  if (!_entry(tables[3], indices[3])) return;
+  _set_entry(tables[3], indices[3], 0);
+  _release(tables, indices, 3);
+}
 
-  _backclear(indices, tablePtrs);
+void anscheduler_vm_unmap_range(void * root,
+                                uint64_t vpage,
+                                uint64_t count,
+                                void * data,
+                                void (* fn)(void * data,
+                                            uint64_t page,
+                                            uint16_t flags)) {
+  if (!count) return;
+  _unmap_range((uint64_t *)root, 0, 0, vpage, vpage + count, data, fn);
 }
 
 uint64_t anscheduler_vm_lookup(void * root,
                                uint64_t vpage,
                                uint16_t * flags) {
-  uint64_t ptIndex = vpage & 0x1ff;
-  uint64_t pdtIndex = (vpage >> 9) & 0x1ff;
-  uint64_t pdptIndex = (vpage >> 18) & 0x1ff;
-  uint64_t pml4Index = (vpage >> 27) & 0x1ff;
-  uint64_t indices[4] = {pml4Index, pdptIndex, pdtIndex, ptIndex};
+  uint64_t indices[4];
+  _indices(vpage, indices);
   uint64_t * table = (uint64_t *)root;
   int i;
   for (i = 0; i < 3; i++) {
-    uint64_t idx = indices[i];
-    if (table[idx] & 1) {
-      table = (uint64_t *)((table[idx] >> 12) << 12);
+    uint64_t entry = _entry(table, indices[i]);
+    if (entry & 1) {
+      table = _entry_table(entry);
     } else {
       (*flags) = 0;
       return 0;
     }
   }
-  (*flags) = (uint16_t)(table[indices[3]] & 0xfff);
-  return table[indices[3]] >> 12;
+  uint64_t entry = _entry(table, indices[3]);
+  (*flags) = (uint16_t)(entry & 0xfff);
+  return entry >> 12;
 }
 
 void anscheduler_vm_root_free(void * root) {
@@ -110,62 +148,182 @@ void anscheduler_vm_root_free_async(void * root) {
   _table_free_async((uint64_t *)root, 0);
 }
 
-static void _table_free(uint64_t * table, int depth) {
-  if (depth == 3) {
-    return anscheduler_free(table);
-  }
+static void _indices(uint64_t vpage, uint64_t * indices) {
+  indices[0] = (vpage >> 27) & 0x1ff;
+  indices[1] = (vpage >> 18) & 0x1ff;
+  indices[2] = (vpage >> 9) & 0x1ff;
+  indices[3] = vpage & 0x1ff;
+}
+
+static uint64_t _entry(uint64_t * table, uint64_t idx) {
+  return table[idx] & ~VM_COUNT_MASK;
+}
+
+static uint64_t * _entry_table(uint64_t entry) {
+  uint64_t page = kernpage_calculate_virtual((entry & VM_ADDRESS_MASK) >> 12);
+  return (uint64_t *)(page << 12);
+}
+
+static uint64_t _count(uint64_t * table, int which) {
+  return (table[which] & VM_COUNT_MASK) >> VM_COUNT_SHIFT;
+}
+
+static void _count_add(uint64_t * table, int which, int delta) {
+  if (!delta) return;
+  // a count never leaves 0-512, so this cannot carry out of the field
+  __sync_fetch_and_add(&table[which], (uint64_t)delta << VM_COUNT_SHIFT);
+}
+
+/**
+ * Clears and then sets bits of an entry in one atomic step, leaving the
+ * counts alone. Returns the old entry without its count bits.
+ */
+static uint64_t _update_entry(uint64_t * table,
+                              uint64_t idx,
+                              uint64_t clear,
+                              uint64_t set) {
+  clear &= ~VM_COUNT_MASK;
+  uint64_t old;
+  do {
+    old = table[idx];
+  } while (!__sync_bool_compare_and_swap(&table[idx], old,
+                                         (old & ~clear) | set));
+  return old & ~VM_COUNT_MASK;
+}
+
+static void _set_entry(uint64_t * table, uint64_t idx, uint64_t value) {
+  uint64_t old = _update_entry(table, idx, ~0UL, value);
+  _count_add(table, VM_COUNT_USED, (int)(value != 0) - (old != 0));
+  _count_add(table, VM_COUNT_USER,
+             (int)((value & 4) != 0) - ((old & 4) != 0));
+  _count_add(table, VM_COUNT_WRITE,
+             (int)((value & 2) != 0) - ((old & 2) != 0));
+}
+
+/**
+ * Set or clear the user and write flags on a table entry to match what the
+ * child table needs. Returns true if the entry changed.
+ */
+static bool _sync_entry(uint64_t * table, uint64_t idx, uint64_t * child) {
+  uint64_t flags = 0;
+  if (_count(child, VM_COUNT_USER)) flags |= 4;
+  if (_count(child, VM_COUNT_WRITE)) flags |= 2;
+  if ((_entry(table, idx) & 6) == flags) return false;
+
+  // only swap the two flags so an accessed bit set meanwhile survives
+  uint64_t old = _update_entry(table, idx, 6, flags);
+  _count_add(table, VM_COUNT_USER, (int)((flags & 4) != 0) - ((old & 4) != 0));
+  _count_add(table, VM_COUNT_WRITE,
+             (int)((flags & 2) != 0) - ((old & 2) != 0));
+  return true;
+}
+
+static void _propagate(uint64_t ** tables, uint64_t * indices, int level) {
   int i;
-  for (i = 0; i < 0x200; i++) {
-    if (table[i] & 1) {
-      uint64_t * nTable = (uint64_t *)((table[i] >> 12) << 12);
-      _table_free(nTable, depth + 1);
-    }
+  for (i = level; i > 0; i--) {
+    if (!_sync_entry(tables[i - 1], indices[i - 1], tables[i])) break;
   }
-  anscheduler_free(table);
 }
 
-static void _table_free_async(uint64_t * table, int depth) {
-  if (depth == 3) {
-    return anscheduler_free(table);
-  }
+static void _release(uint64_t ** tables, uint64_t * indices, int level) {
   int i;
-  for (i = 0; i < 0x200; i++) {
-    if (table[i] & 1) {
-      uint64_t * nTable = (uint64_t *)((table[i] >> 12) << 12);
-      _table_free_async(nTable, depth + 1);
+  for (i = level; i > 0; i--) {
+    if (_count(tables[i], VM_COUNT_USED)) {
+      _propagate(tables, indices, i);
+      return;
     }
+    anscheduler_free(tables[i]);
+    _set_entry(tables[i - 1], indices[i - 1], 0);
   }
-  anscheduler_free(table);
 }
 
-static void _backclear(uint64_t * indices, uint64_t ** tables) {
-  uint64_t * table = tables[3];
-  int i, j;
-  for (i = 3; i > 0; i--) {
-    uint64_t collectiveEntries = 0;
-    for (j = 0; j < 0x200; j++) {
-      collectiveEntries |= table[j];
-    }
+static void _unmap_range(uint64_t * table,
+                         int depth,
+                         uint64_t base,
+                         uint64_t start,
+                         uint64_t end,
+                         void * data,
+                         void (* fn)(void * data, uint64_t page, uint16_t f)) {
+  uint64_t shift = 9 * (3 - depth);
+  uint64_t span = 1UL << shift;
+  uint64_t first = start > base ? (start - base) >> shift : 0;
+  uint64_t i;
+  for (i = first; i < 0x200; i++) {
+    uint64_t entryBase = base + (i << shift);
+    if (entryBase >= end) break;
+    if (!_count(table, VM_COUNT_USED)) break;
 
-    table = tables[i - 1];
-    if (!collectiveEntries) {
-      // free this entire table
-      anscheduler_free(tables[i]);
-      table[indices[i - 1]] = 0;
+    uint64_t entry = _entry(table, i);
+    if (!entry) continue;
+    if (depth == 3) {
+      if (fn) fn(data, (entry & VM_ADDRESS_MASK) >> 12, entry & 0xfff);
+      _set_entry(table, i, 0);
       continue;
     }
+    if (!(entry & 1)) continue;
 
-    // unset flags if they are no longer needed
-    if (!(collectiveEntries & 4)) {
-      if (table[indices[i - 1]] & 4) {
-        table[indices[i - 1]] ^= 4;
-      }
+    uint64_t * child = _entry_table(entry);
+    if (entryBase >= start && entryBase + span <= end) {
+      // the range covers this whole table, so skip the bookkeeping
+      _table_drop(child, depth + 1, data, fn);
+      _set_entry(table, i, 0);
+      continue;
     }
-    if (!(collectiveEntries & 2)) {
-      if (table[indices[i - 1]] & 2) {
-        table[indices[i - 1]] ^= 2;
-      }
+    _unmap_range(child, depth + 1, entryBase, start, end, data, fn);
+    if (!_count(child, VM_COUNT_USED)) {
+      anscheduler_free(child);
+      _set_entry(table, i, 0);
+    } else {
+      _sync_entry(table, i, child);
+    }
+  }
+}
+
+static void _table_drop(uint64_t * table,
+                        int depth,
+                        void * data,
+                        void (* fn)(void * data, uint64_t page, uint16_t f)) {
+  uint64_t remaining = _count(table, VM_COUNT_USED);
+  uint64_t i;
+  for (i = 0; i < 0x200 && remaining && (fn || depth < 3); i++) {
+    uint64_t entry = _entry(table, i);
+    if (!entry) continue;
+    remaining--;
+    if (depth == 3) {
+      fn(data, (entry & VM_ADDRESS_MASK) >> 12, entry & 0xfff);
+    } else if (entry & 1) {
+      _table_drop(_entry_table(entry), depth + 1, data, fn);
     }
   }
+  anscheduler_free(table);
 }
 
+static void _table_free(uint64_t * table, int depth) {
+  if (depth == 3) {
+    return anscheduler_free(table);
+  }
+  uint64_t remaining = _count(table, VM_COUNT_USED);
+  int i;
+  for (i = 0; i < 0x200 && remaining; i++) {
+    uint64_t entry = _entry(table, i);
+    if (!entry) continue;
+    remaining--;
+    if (entry & 1) _table_free(_entry_table(entry), depth + 1);
+  }
+  anscheduler_free(table);
+}
+
+static void _table_free_async(uint64_t * table, int depth) {
+  if (depth == 3) {
+    return anscheduler_free(table);
+  }
+  uint64_t remaining = _count(table, VM_COUNT_USED);
+  int i;
+  for (i = 0; i < 0x200 && remaining; i++) {
+    uint64_t entry = _entry(table, i);
+    if (!entry) continue;
+    remaining--;
+    if (entry & 1) _table_free_async(_entry_table(entry), depth + 1);
+  }
+  anscheduler_free(table);
+}
@@ -7,6 +7,7 @@ extern hang
 extern kernpage_initialize
 extern apic_initialize
 extern smp_initialize
+extern cpuPlaceholder
 
 bits 32
 
@@ -173,6 +174,14 @@ _entry64:
   xor ax, ax
   mov ss, ax
 
+  ; until this CPU is added to the list, GS points at an empty cpu_t so that
+  ; cpu_current() returns NULL
+  mov ecx, 0xC0000101 ; MSR_GS_BASE
+  mov rax, cpuPlaceholder
+  mov rdx, rax
+  shr rdx, 32
+  wrmsr
+
   mov rdi, inLongModeMessage
   call print
   call kernpage_initialize
@@ -1,5 +1,6 @@
 #include "proc_init.h"
 #include <scheduler/cpu.h>
+#include <scheduler/pcid.h>
 #include <anscheduler/functions.h>
 #include <anscheduler/loop.h>
 #include <interrupts/lapic.h>
@@ -33,6 +34,9 @@ void proc_run_scheduler() {
           "or $0x600, %ax\n"
           "mov %rax, %cr4");
 
+  // tag address spaces so that switching tasks does not flush the TLB
+  pcid_initialize();
+
   // setup other CPU registers
   load_new_gdt();
   load_tss();
@@ -7,6 +7,7 @@ START_STACK equ 0x4000
 
 extern kernpage_alloc_virtual
 extern proc_initialize
+extern cpuPlaceholder
 extern print
 
 bits 16
@@ -64,6 +65,14 @@ global proc_entry_end
 proc_entry_end:
 
 initiate_routine:
+  ; until this CPU is added to the list, GS points at an empty cpu_t so that
+  ; cpu_current() returns NULL
+  mov ecx, 0xC0000101 ; MSR_GS_BASE
+  mov rax, cpuPlaceholder
+  mov rdx, rax
+  shr rdx, 32
+  wrmsr
+
   call kernpage_alloc_virtual
 
   ; use rax as our stack
@@ -16,6 +16,7 @@
 #include <anscheduler/thread.h>
 #include <anscheduler/functions.h>
 #include <syscall/config.h>
+#include <syscall/taskinfo.h>
 
 #include "proc_init.h"
 
@@ -46,6 +47,8 @@ static void start_task(void * ptr, uint64_t len);
 
 void smp_initialize() {
   print("initializing basic scheduling structures...\n");
+  anscheduler_loop_name_locks();
+  anscheduler_task_name_locks();
   gdt_initialize();
   copy_init_code();
 
@@ -111,6 +114,13 @@ static void copy_init_code() {
 
 static void initialize_cpu(void * unused, uint64_t cpuId) {
   if (cpuId == lapic_get_id()) return;
+  if (cpu_count() >= CPU_MAX) {
+    // every cpu_t is preallocated in the kernel image
+    print("not starting APIC with ID 0x");
+    printHex(cpuId);
+    print(": too many CPUs\n");
+    return;
+  }
   
   print("initializing APIC with ID 0x");
   printHex(cpuId);
@@ -148,6 +158,7 @@ static void start_task(void * ptr, uint64_t len) {
   code_t * code = code_allocate(ptr, len);
   task_t * task = anscheduler_task_create();
   task->ui.code = code;
+  if (!taskinfo_create(task)) die("failed to map task info");
   anscheduler_task_launch(task);
 
   thread_t * thread = anscheduler_thread_create(task);
@@ -3,9 +3,13 @@
 #define MSR_STAR 0xC0000081
 #define MSR_LSTAR 0xC0000082
 #define MSR_SFMASK 0xC0000084
+#define MSR_FS_BASE 0xC0000100
+#define MSR_GS_BASE 0xC0000101
+#define MSR_KERNEL_GS_BASE 0xC0000102
 
 /**
- * Initialize the MSR's that never need to change again.
+ * Initialize the MSR's that never need to change again, including the single
+ * syscall entry point which every thread shares.
  */
 void syscall_initialize();
 
@@ -16,8 +20,8 @@ void syscall_initialize();
 void syscall_initialize_thread(thread_t * thread);
 
 /**
- * Setup the syscall handler the thread in question. The thread's owning task
- * must have a reference to it.
+ * Point the current CPU's syscall stacks at the thread in question, and load
+ * its FS base. The thread's owning task must have a reference to it.
  */
 void syscall_setup_for_thread(thread_t * thread);
 
@@ -1,21 +1,57 @@
 bits 64
 
 %include "../shared/addresses.s"
+%include "../pcid.s"
+%include "entry_defs.s" ; SYSCALL_COUNT, KERN_STACKS_PAGE, CPU_*_STACK
 extern syscall_entry, syscall_return
+extern syscallFastTable
 
 section .text
 
+; MSR_LSTAR points here for every thread
 global syscall_configure_stack
 syscall_configure_stack:
-  ;we just ran:
-  ; cli (done by syscall)
-  ; xor rax, rax
-  ; mov ss, ax
-  ; mov r11, rsp
-  ; mov rsp, NEW STACK
+  ; syscall already cleared IF; the cpu_t is in the kernel image, which the
+  ; task maps, so it can be used before we switch page tables
+  swapgs
+  xor rax, rax
+  mov ss, ax
+  mov r11, rsp
+  mov rsp, [gs:CPU_TASK_STACK]
 
+  ; our thread_t is mapped at -(stack index + 1) pages, and the kernel stack
+  ; is at KERN_STACKS_PAGE + stack index
+  mov rax, rsp
+  shr rax, 12
+  sub rax, KERN_STACKS_PAGE
+  shl rax, 12
+  neg rax
+
+  ; some syscalls need nothing but the thread, so they run right here without
+  ; switching to the kernel's page table
+  cmp rdi, SYSCALL_COUNT
+  jae .slowPath
+  mov r10, [syscallFastTable + rdi * 8]
+  test r10, r10
+  jz .slowPath
+
+  push 0x23 ; ss
+  push r11 ; rsp
+  push 0x202 ; rflags, with interrupts on
+  push 0x1b ; cs
+  push rcx ; rip
+  sub rsp, 8 ; keep the stack aligned for C
+  mov rdi, rax
+  call r10
+  add rsp, 8
+  swapgs
+  iretq
+
+.slowPath:
+  mov rsp, [gs:CPU_KERN_STACK]
   mov r10, cr3
   mov rax, PML4_START
+  cr3_noflush rax, r9
   mov cr3, rax
   sti
 
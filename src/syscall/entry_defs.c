@@ -0,0 +1,20 @@
+#include "functions.h"
+#include <scheduler/cpu.h>
+#include <anscheduler/task.h>
+#include <stddef.h>
+
+/**
+ * This file is never linked. The Makefile compiles it to assembly and turns
+ * each DEFINE() into an `equ` in build/entry_defs.s, which entry.s includes,
+ * so entry.s and the C code cannot disagree on a constant.
+ */
+
+#define DEFINE(name, value) \
+  __asm__ __volatile__("\n#define " #name " %c0" : : "i" (value))
+
+void entry_defs() {
+  DEFINE(SYSCALL_COUNT, SYSCALL_COUNT);
+  DEFINE(KERN_STACKS_PAGE, ANSCHEDULER_TASK_KERN_STACKS_PAGE);
+  DEFINE(CPU_TASK_STACK, offsetof(cpu_t, taskStack));
+  DEFINE(CPU_KERN_STACK, offsetof(cpu_t, kernStack));
+}
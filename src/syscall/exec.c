@@ -3,18 +3,24 @@
 #include <anscheduler/socket.h>
 #include <anscheduler/functions.h>
 #include <syscall/config.h>
+#include <syscall/futex.h>
+#include <syscall/taskinfo.h>
 #include <scheduler/context.h>
+#include <libkern_base.h>
+#include "exec.h"
 
-uint64_t syscall_fork(uint64_t rip) {
+uint64_t syscall_fork(uint64_t rip, uint64_t arg1) {
   anscheduler_cpu_lock();
   task_t * task = anscheduler_cpu_get_task();
   task_t * fork = anscheduler_task_create();
-  fork->ui.code = code_retain(task->ui.code);
-  anscheduler_task_launch(fork);
-
   if (!fork) {
     anscheduler_abort("failed to fork task");
   }
+  fork->ui.code = code_retain(task->ui.code);
+  if (!taskinfo_create(fork)) {
+    anscheduler_abort("failed to map task info");
+  }
+  anscheduler_task_launch(fork);
 
   // open a stdio socket
   socket_desc_t * desc = anscheduler_socket_new();
@@ -48,6 +54,7 @@ uint64_t syscall_fork(uint64_t rip) {
   thread->state.rbp = (stackStart + 0x100) << 12;
   thread->state.flags = 0x200;
   thread->state.rip = rip;
+  thread->state.rdi = arg1;
   thread->state.cs = 0x1b;
   thread->state.ss = 0x23;
   syscall_initialize_thread(thread);
@@ -108,3 +115,31 @@ uint64_t syscall_thread_id() {
   return ident;
 }
 
+uint64_t syscall_fast_thread_id(thread_t * thread) {
+  return thread->stack;
+}
+
+bool syscall_set_fs_base(uint64_t base) {
+  // only canonical addresses in the lower half may be loaded into the MSR
+  if (base >= 0x800000000000L) return false;
+  anscheduler_cpu_lock();
+  thread_t * thread = anscheduler_cpu_get_thread();
+  thread->state.fsBase = base;
+  msr_write(MSR_FS_BASE, base);
+  anscheduler_cpu_unlock();
+  return true;
+}
+
+bool syscall_set_priority(uint64_t priority) {
+  if (priority > SYSCALL_PRIORITY_MAX) return false;
+  anscheduler_cpu_lock();
+  thread_t * thread = anscheduler_cpu_get_thread();
+  if (priority && thread->task->uid) {
+    anscheduler_cpu_unlock();
+    return false;
+  }
+  thread->basePriority = (uint8_t)priority;
+  futex_priority_changed(thread);
+  anscheduler_cpu_unlock();
+  return true;
+}
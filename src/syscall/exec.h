@@ -1,11 +1,15 @@
-#include <stdint.h>
+#include <anscheduler/types.h>
+#include <anscheduler/loop.h>
+
+#define SYSCALL_PRIORITY_MAX (ANSCHEDULER_PRIORITY_LEVELS - 1)
 
 /**
  * Launches a new task, opens a socket to it, and returns the file descriptor in
- * the current task's descriptor space.
+ * the current task's descriptor space. The new task's first thread starts at
+ * `rip` with `arg1` as its first argument.
  * @noncritical
  */
-uint64_t syscall_fork(uint64_t rip);
+uint64_t syscall_fork(uint64_t rip, uint64_t arg1);
 
 /**
  * Kill a task with a specified PID. This will only take effect if the given
@@ -25,3 +29,22 @@ void syscall_thread_launch(uint64_t rip, uint64_t arg1, uint64_t arg2);
  */
 uint64_t syscall_thread_id();
 
+/**
+ * The same as syscall_thread_id(), for the syscall fast path. `thread` is the
+ * calling thread as it is mapped into the task's address space.
+ */
+uint64_t syscall_fast_thread_id(thread_t * thread);
+
+/**
+ * Set the FS base of the current thread. It is saved in the thread's state and
+ * reloaded every time the thread runs, so user code can use it as the thread
+ * pointer for TLS. Returns false if `base` is not a lower-half address.
+ */
+bool syscall_set_fs_base(uint64_t base);
+
+/**
+ * Set the base priority of the current thread. The scheduler always runs the
+ * runnable thread with the highest priority, so only root may raise a thread
+ * above the default of 0. Returns false if the priority was not changed.
+ */
+bool syscall_set_priority(uint64_t priority);
@@ -5,6 +5,9 @@
 #include "exec.h"
 #include "memory.h"
 #include "time.h"
+#include "futex.h"
+#include "ring.h"
+#include "stats.h"
 #include <stdio.h>
 #include <memory/kernpage.h>
 #include <shared/addresses.h>
@@ -13,72 +16,95 @@
 #include <anscheduler/thread.h>
 #include <anscheduler/loop.h>
 #include <anscheduler/interrupts.h>
+#include <anlock.h>
 
 static bool print_line(const char * ptr);
 
+static void * const syscallTable[SYSCALL_COUNT] = {
+  (void *)syscall_print, // 0x0
+  (void *)syscall_get_time,
+  (void *)syscall_sleep,
+  (void *)syscall_exit,
+  (void *)syscall_thread_exit,
+  (void *)syscall_wants_interrupts,
+  (void *)syscall_get_interrupts,
+  (void *)syscall_open_socket,
+  (void *)syscall_connect,
+  (void *)syscall_close_socket,
+  (void *)syscall_write,
+  (void *)syscall_read,
+  (void *)syscall_poll,
+  (void *)syscall_remote_pid,
+  (void *)syscall_remote_uid,
+  (void *)syscall_in,
+  (void *)syscall_out, // 0x10
+  (void *)syscall_set_color,
+  (void *)syscall_fork,
+  (void *)syscall_mem_usage,
+  (void *)syscall_kill,
+  (void *)syscall_allocate_page,
+  (void *)syscall_allocate_aligned,
+  (void *)syscall_free_page,
+  (void *)syscall_free_aligned,
+  (void *)syscall_vmmap,
+  (void *)syscall_vmunmap,
+  (void *)syscall_invlpg,
+  (void *)syscall_thread_launch,
+  (void *)syscall_thread_id,
+  (void *)syscall_unsleep,
+  (void *)syscall_self_uid,
+  (void *)syscall_self_pid, // 0x20
+  (void *)syscall_self_vm_read,
+  (void *)syscall_become_pager,
+  (void *)syscall_get_fault,
+  (void *)syscall_self_vmmap,
+  (void *)syscall_self_vmunmap,
+  (void *)syscall_self_invlpg,
+  (void *)syscall_shift_fault,
+  (void *)syscall_abort,
+  (void *)syscall_mem_fault,
+  (void *)syscall_wake_thread,
+  (void *)syscall_batch_vmunmap,
+  (void *)syscall_batch_alloc,
+  (void *)syscall_batch_vmmap,
+  (void *)syscall_clear_unsleep,
+  (void *)syscall_batch_vmsample,
+  (void *)syscall_lockstat, // 0x30
+  (void *)syscall_futex_wait,
+  (void *)syscall_futex_wake,
+  (void *)syscall_set_fs_base,
+  (void *)syscall_futex_requeue,
+  (void *)syscall_futex_lock_pi,
+  (void *)syscall_futex_unlock_pi,
+  (void *)syscall_set_priority,
+  (void *)syscall_ring_enter, // 0x38
+  (void *)syscall_syscallstat
+};
+
+// entries which are not NULL are run by entry.s straight from the task's
+// address space, so they may only touch the low 4MB and the calling thread
+void * const syscallFastTable[SYSCALL_COUNT] = {
+  [0x1] = (void *)syscall_fast_get_time,
+  [0x1d] = (void *)syscall_fast_thread_id
+};
+
 uint64_t syscall_entry(uint64_t arg1,
                        uint64_t arg2,
                        uint64_t arg3,
                        uint64_t arg4) {
-  void * functions[] = {
-    (void *)syscall_print, // 0x0
-    (void *)syscall_get_time,
-    (void *)syscall_sleep,
-    (void *)syscall_exit,
-    (void *)syscall_thread_exit,
-    (void *)syscall_wants_interrupts,
-    (void *)syscall_get_interrupts,
-    (void *)syscall_open_socket,
-    (void *)syscall_connect,
-    (void *)syscall_close_socket,
-    (void *)syscall_write,
-    (void *)syscall_read,
-    (void *)syscall_poll,
-    (void *)syscall_remote_pid,
-    (void *)syscall_remote_uid,
-    (void *)syscall_in,
-    (void *)syscall_out, // 0x10
-    (void *)syscall_set_color,
-    (void *)syscall_fork,
-    (void *)syscall_mem_usage,
-    (void *)syscall_kill,
-    (void *)syscall_allocate_page,
-    (void *)syscall_allocate_aligned,
-    (void *)syscall_free_page,
-    (void *)syscall_free_aligned,
-    (void *)syscall_vmmap,
-    (void *)syscall_vmunmap,
-    (void *)syscall_invlpg,
-    (void *)syscall_thread_launch,
-    (void *)syscall_thread_id,
-    (void *)syscall_unsleep,
-    (void *)syscall_self_uid,
-    (void *)syscall_self_pid, // 0x20
-    (void *)syscall_self_vm_read,
-    (void *)syscall_become_pager,
-    (void *)syscall_get_fault,
-    (void *)syscall_self_vmmap,
-    (void *)syscall_self_vmunmap,
-    (void *)syscall_self_invlpg,
-    (void *)syscall_shift_fault,
-    (void *)syscall_abort,
-    (void *)syscall_mem_fault,
-    (void *)syscall_wake_thread,
-    (void *)syscall_batch_vmunmap,
-    (void *)syscall_batch_alloc,
-    (void *)syscall_batch_vmmap,
-    (void *)syscall_clear_unsleep
-  };
-  if (arg1 >= sizeof(functions) / sizeof(void *)) {
+  if (arg1 >= SYSCALL_COUNT) {
     return 0;
   }
   uint64_t ret;
-  void * func = functions[arg1];
+  uint64_t start = syscall_stats_begin(arg1);
+  void * func = syscallTable[arg1];
+  // the callee may clobber every argument register
   __asm__("xor %%rax, %%rax\n"
           "call *%%rcx"
-          : "=a" (ret)
-          : "D" (arg2), "S" (arg3), "d" (arg4), "c" (func)
+          : "=a" (ret), "+D" (arg2), "+S" (arg3), "+d" (arg4), "+c" (func)
+          :
           : "r8", "r9", "r10", "r11", "memory");
+  syscall_stats_end(arg1, start);
   return ret;
 }
 
@@ -146,6 +172,23 @@ uint64_t syscall_mem_usage() {
   return count;
 }
 
+uint64_t syscall_lockstat(void * buffer, uint64_t max) {
+  if (max > ANLOCK_STATS_CLASSES) max = ANLOCK_STATS_CLASSES;
+  anscheduler_cpu_lock();
+  anlock_stat_t * stats = anscheduler_alloc(0x1000);
+  if (!stats) {
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  uint64_t count = anlock_get_stats(stats, max);
+  if (!task_copy_out(buffer, stats, count * sizeof(anlock_stat_t))) {
+    count = 0;
+  }
+  anscheduler_free(stats);
+  anscheduler_cpu_unlock();
+  return count;
+}
+
 uint64_t syscall_self_uid() {
   anscheduler_cpu_lock();
   task_t * task = anscheduler_cpu_get_task();
@@ -169,23 +212,16 @@ void syscall_abort() {
 
 static bool print_line(const char * ptr) {
   anscheduler_cpu_lock();
-  bool ret = true;
-
-  int i;
-  for (i = 0; i < 0x50; i++) {
-    char buff[2] = {0, 0};
-    bool result = task_copy_in(buff, ptr + i, 1);
-    if (!result) {
-      anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_MEMORY);
-    }
-    if (buff[0] == 0) {
-      ret = false;
-      break;
-    }
-    print(buff);
+
+  char buff[0x51];
+  uint64_t len;
+  if (!task_copy_in_string(buff, ptr, 0x50, &len)) {
+    anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_MEMORY);
   }
+  buff[len] = 0;
+  print(buff);
 
   anscheduler_cpu_unlock();
-  return ret;
+  return len == 0x50;
 }
 
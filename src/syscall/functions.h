@@ -6,6 +6,7 @@
 #define FD_INVAL 0xffffffffffffffffL
 #define ANSCHEDULER_TASK_KILL_REASON_ACCESS 3
 #define ANSCHEDULER_TASK_KILL_REASON_ABORT 4
+#define SYSCALL_COUNT 0x3a // entry.s gets this through entry_defs.c
 
 typedef struct {
   uint64_t rax;
@@ -80,4 +81,12 @@ uint64_t syscall_self_pid();
  */
 void syscall_abort();
 
+/**
+ * Copies the lock statistics of at most `max` lock names to `buffer`, an
+ * array of anlock_stat_t, sorted by the time spent waiting for them. Returns
+ * the number of entries copied. Statistics are only kept if the kernel was
+ * built with LOCKSTAT=1.
+ */
+uint64_t syscall_lockstat(void * buffer, uint64_t max);
+
 #endif
@@ -0,0 +1,496 @@
+#include "futex.h"
+#include <anscheduler/functions.h>
+#include <anscheduler/loop.h>
+#include <anscheduler/task.h>
+
+typedef struct {
+  uint64_t lock;
+  thread_t * first;
+} __attribute__((packed)) futex_bucket_t;
+
+static futex_bucket_t buckets[FUTEX_BUCKET_COUNT] __attribute__((aligned(8)));
+
+// every thread blocked on a PI futex; only walked to recompute boosts
+static uint64_t piLock __attribute__((aligned(8))) = 0;
+static thread_t * piFirst __attribute__((aligned(8))) = NULL;
+
+static futex_bucket_t * _bucket(task_t * task, uint64_t addr);
+static bool _read_word(task_t * task, uint64_t addr, uint64_t * value);
+static volatile uint64_t * _word_lock(task_t * task, uint64_t addr);
+static void _word_unlock(task_t * task);
+static thread_t * _find_owner(task_t * task, uint64_t word);
+static void _pi_link(thread_t * thread, thread_t * owner);
+static void _pi_unlink(thread_t * thread);
+static void _pi_update(thread_t * owner);
+static void _lock_pair(futex_bucket_t * b1, futex_bucket_t * b2);
+static void _unlock_pair(futex_bucket_t * b1, futex_bucket_t * b2);
+static bool _dequeue_self(task_t * task, thread_t * thread);
+static void _push_waiter(futex_bucket_t * bucket, thread_t * thread);
+static bool _remove_waiter(futex_bucket_t * bucket, thread_t * thread);
+static void _wake_thread(thread_t * thread);
+static uint64_t _deadline(uint64_t usec);
+
+uint64_t syscall_futex_wait(uint64_t * ptr, uint64_t expected, uint64_t usec) {
+  uint64_t addr = (uint64_t)ptr;
+  if (!addr || (addr & 7)) return 0;
+
+  anscheduler_cpu_lock();
+  thread_t * thread = anscheduler_cpu_get_thread();
+  task_t * task = thread->task;
+  futex_bucket_t * bucket = _bucket(task, addr);
+
+  // the value is checked under the bucket lock, so a wake which follows a
+  // change to the value cannot slip in before we are queued
+  anscheduler_lock(&bucket->lock);
+  uint64_t value;
+  if (!_read_word(task, addr, &value) || value != expected) {
+    anscheduler_unlock(&bucket->lock);
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  thread->state.futexAddr = addr;
+  thread->state.futexWoken = 0;
+  _push_waiter(bucket, thread);
+
+  anscheduler_lock(&thread->state.sleepLock);
+  thread->nextTimestamp = _deadline(usec);
+  thread->state.isSleeping = true;
+  anscheduler_unlock(&thread->state.sleepLock);
+  anscheduler_unlock(&bucket->lock);
+
+  anscheduler_loop_save_and_resign();
+
+  anscheduler_lock(&thread->state.sleepLock);
+  thread->state.isSleeping = false;
+  anscheduler_unlock(&thread->state.sleepLock);
+
+  _dequeue_self(task, thread);
+  uint64_t woken = thread->state.futexWoken;
+  anscheduler_cpu_unlock();
+  return woken;
+}
+
+uint64_t syscall_futex_wake(uint64_t * ptr, uint64_t count) {
+  uint64_t addr = (uint64_t)ptr;
+  if (!addr || (addr & 7)) return 0;
+
+  anscheduler_cpu_lock();
+  task_t * task = anscheduler_cpu_get_task();
+  futex_bucket_t * bucket = _bucket(task, addr);
+  uint64_t woken = 0;
+
+  anscheduler_lock(&bucket->lock);
+  thread_t * thread = bucket->first;
+  while (thread && woken < count) {
+    thread_t * next = thread->state.futexNext;
+    if (thread->task == task && thread->state.futexAddr == addr) {
+      thread->state.futexWoken = 1;
+      _remove_waiter(bucket, thread);
+      _wake_thread(thread);
+      woken++;
+    }
+    thread = next;
+  }
+  anscheduler_unlock(&bucket->lock);
+  anscheduler_cpu_unlock();
+  return woken;
+}
+
+uint64_t syscall_futex_requeue(uint64_t * ptr,
+                               uint64_t expected,
+                               uint64_t * target) {
+  uint64_t addr = (uint64_t)ptr;
+  uint64_t dest = (uint64_t)target;
+  if (!addr || (addr & 7) || !dest || (dest & 7)) return 0;
+  if (addr == dest) return syscall_futex_wake(ptr, 1);
+
+  anscheduler_cpu_lock();
+  task_t * task = anscheduler_cpu_get_task();
+  futex_bucket_t * source = _bucket(task, addr);
+  futex_bucket_t * destBucket = _bucket(task, dest);
+  _lock_pair(source, destBucket);
+
+  uint64_t value;
+  if (!_read_word(task, addr, &value) || value != expected) {
+    _unlock_pair(source, destBucket);
+    anscheduler_cpu_unlock();
+    return FUTEX_REQUEUE_MISMATCH;
+  }
+
+  uint64_t count = 0;
+  thread_t * thread = source->first;
+  while (thread) {
+    thread_t * next = thread->state.futexNext;
+    if (thread->task == task && thread->state.futexAddr == addr) {
+      if (!count) {
+        thread->state.futexWoken = 1;
+        _remove_waiter(source, thread);
+        _wake_thread(thread);
+      } else {
+        _remove_waiter(source, thread);
+        thread->state.futexAddr = dest;
+        _push_waiter(destBucket, thread);
+      }
+      count++;
+    }
+    thread = next;
+  }
+
+  _unlock_pair(source, destBucket);
+  anscheduler_cpu_unlock();
+  return count;
+}
+
+uint64_t syscall_futex_lock_pi(uint64_t * ptr) {
+  uint64_t addr = (uint64_t)ptr;
+  if (!addr || (addr & 7)) return 0;
+
+  anscheduler_cpu_lock();
+  thread_t * thread = anscheduler_cpu_get_thread();
+  task_t * task = thread->task;
+  uint64_t tid = thread->stack + 1;
+  futex_bucket_t * bucket = _bucket(task, addr);
+
+  anscheduler_lock(&bucket->lock);
+  volatile uint64_t * word = _word_lock(task, addr);
+  if (!word) {
+    anscheduler_unlock(&bucket->lock);
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  thread_t * owner = NULL;
+  while (1) {
+    uint64_t value = *word;
+    if ((value & FUTEX_PI_OWNER) == tid) {
+      // we already own it
+      _word_unlock(task);
+      anscheduler_unlock(&bucket->lock);
+      anscheduler_cpu_unlock();
+      return 0;
+    }
+    if (value & FUTEX_PI_OWNER) {
+      // the owner must see the waiters bit so that it unlocks through us
+      uint64_t marked = value | FUTEX_PI_WAITERS;
+      if (!__sync_bool_compare_and_swap(word, value, marked)) continue;
+      owner = _find_owner(task, marked);
+      if (owner) break;
+      // the owner exited without unlocking, so the futex is up for grabs
+      anscheduler_unlock(&task->threadsLock);
+      value = marked;
+    }
+    uint64_t taken = tid | (value & FUTEX_PI_WAITERS);
+    if (__sync_bool_compare_and_swap(word, value, taken)) {
+      _word_unlock(task);
+      anscheduler_unlock(&bucket->lock);
+      anscheduler_cpu_unlock();
+      return 1;
+    }
+  }
+  _word_unlock(task);
+
+  // the owner cannot be freed while we hold the threads lock
+  thread->state.futexAddr = addr;
+  thread->state.futexWoken = 0;
+  _push_waiter(bucket, thread);
+  _pi_link(thread, owner);
+  anscheduler_unlock(&task->threadsLock);
+
+  anscheduler_lock(&thread->state.sleepLock);
+  thread->nextTimestamp = 0xffffffffffffffffL;
+  thread->state.isSleeping = true;
+  anscheduler_unlock(&thread->state.sleepLock);
+  anscheduler_unlock(&bucket->lock);
+
+  anscheduler_loop_save_and_resign();
+
+  anscheduler_lock(&thread->state.sleepLock);
+  thread->state.isSleeping = false;
+  anscheduler_unlock(&thread->state.sleepLock);
+
+  // if the unlocking thread woke us, it has already made us the owner
+  _dequeue_self(task, thread);
+  uint64_t woken = thread->state.futexWoken;
+  anscheduler_cpu_unlock();
+  return woken;
+}
+
+uint64_t syscall_futex_unlock_pi(uint64_t * ptr) {
+  uint64_t addr = (uint64_t)ptr;
+  if (!addr || (addr & 7)) return 0;
+
+  anscheduler_cpu_lock();
+  thread_t * thread = anscheduler_cpu_get_thread();
+  task_t * task = thread->task;
+  uint64_t tid = thread->stack + 1;
+  futex_bucket_t * bucket = _bucket(task, addr);
+
+  anscheduler_lock(&bucket->lock);
+  volatile uint64_t * word = _word_lock(task, addr);
+  if (!word) {
+    anscheduler_unlock(&bucket->lock);
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  if ((*word & FUTEX_PI_OWNER) != tid) {
+    _word_unlock(task);
+    anscheduler_unlock(&bucket->lock);
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+
+  // hand the futex to the most important waiter, oldest first among equals
+  thread_t * next = NULL;
+  bool others = false;
+  thread_t * waiter = bucket->first;
+  while (waiter) {
+    if (waiter->task == task && waiter->state.futexAddr == addr) {
+      if (next) others = true;
+      if (!next || waiter->priority > next->priority) next = waiter;
+    }
+    waiter = waiter->state.futexNext;
+  }
+
+  if (!next) {
+    (*word) = 0;
+  } else {
+    (*word) = (next->stack + 1) | (others ? FUTEX_PI_WAITERS : 0);
+  }
+  _word_unlock(task);
+
+  if (next) {
+    next->state.futexWoken = 1;
+    _remove_waiter(bucket, next);
+    _wake_thread(next);
+
+    // whoever is still waiting is now waiting on the new owner
+    anscheduler_lock(&piLock);
+    waiter = bucket->first;
+    while (waiter) {
+      if (waiter->task == task && waiter->state.futexAddr == addr) {
+        waiter->state.piOwner = next;
+      }
+      waiter = waiter->state.futexNext;
+    }
+    _pi_update(next);
+    anscheduler_unlock(&piLock);
+  }
+
+  anscheduler_lock(&piLock);
+  _pi_update(thread);
+  anscheduler_unlock(&piLock);
+
+  anscheduler_unlock(&bucket->lock);
+  anscheduler_cpu_unlock();
+  return 1;
+}
+
+void futex_priority_changed(thread_t * thread) {
+  anscheduler_lock(&piLock);
+  _pi_update(thread);
+  // a waiter passes its new priority on to the thread it is blocked on
+  if (thread->state.piOwner) _pi_update(thread->state.piOwner);
+  anscheduler_unlock(&piLock);
+}
+
+void futex_thread_cleanup(thread_t * thread) {
+  _dequeue_self(thread->task, thread);
+
+  // nothing may boost this thread once it is gone
+  anscheduler_lock(&piLock);
+  thread->state.piFlags |= FUTEX_PI_EXITED;
+  thread_t * waiter = piFirst;
+  while (waiter) {
+    if (waiter->state.piOwner == thread) waiter->state.piOwner = NULL;
+    waiter = waiter->state.piNext;
+  }
+  anscheduler_unlock(&piLock);
+}
+
+static futex_bucket_t * _bucket(task_t * task, uint64_t addr) {
+  uint64_t hash = (addr >> 3) ^ ((uint64_t)task >> 12);
+  hash ^= hash >> 7;
+  return &buckets[hash % FUTEX_BUCKET_COUNT];
+}
+
+static bool _read_word(task_t * task, uint64_t addr, uint64_t * value) {
+  // the page may only be read while the vmLock keeps it from being freed
+  anscheduler_read_lock(&task->vmLock);
+  uint16_t flags;
+  uint64_t entry = anscheduler_vm_lookup(task->vm, addr >> 12, &flags);
+  if (!(flags & ANSCHEDULER_PAGE_FLAG_PRESENT)
+      || !(flags & ANSCHEDULER_PAGE_FLAG_USER)) {
+    anscheduler_read_unlock(&task->vmLock);
+    return false;
+  }
+  uint64_t page = anscheduler_vm_virtual(entry) << 12;
+  (*value) = *(volatile uint64_t *)(page + (addr & 0xfff));
+  anscheduler_read_unlock(&task->vmLock);
+  return true;
+}
+
+/**
+ * Returns a pointer to a writable futex word with the task's vmLock held for
+ * reading, so the page cannot be unmapped and freed while it is in use. The
+ * caller must pass the task to _word_unlock() once it is done with the word.
+ * Returns NULL, without the lock, if the word is not mapped writable.
+ */
+static volatile uint64_t * _word_lock(task_t * task, uint64_t addr) {
+  uint16_t needed = ANSCHEDULER_PAGE_FLAG_PRESENT
+    | ANSCHEDULER_PAGE_FLAG_USER
+    | ANSCHEDULER_PAGE_FLAG_WRITE;
+  anscheduler_read_lock(&task->vmLock);
+  uint16_t flags;
+  uint64_t entry = anscheduler_vm_lookup(task->vm, addr >> 12, &flags);
+  if ((flags & needed) != needed) {
+    anscheduler_read_unlock(&task->vmLock);
+    return NULL;
+  }
+  uint64_t page = anscheduler_vm_virtual(entry) << 12;
+  return (volatile uint64_t *)(page + (addr & 0xfff));
+}
+
+static void _word_unlock(task_t * task) {
+  anscheduler_read_unlock(&task->vmLock);
+}
+
+static thread_t * _find_owner(task_t * task, uint64_t word) {
+  // returns with the task's threadsLock held, even if nothing was found
+  uint64_t stack = (word & FUTEX_PI_OWNER) - 1;
+  anscheduler_lock(&task->threadsLock);
+  thread_t * thread = task->firstThread;
+  while (thread) {
+    if (thread->stack == stack) break;
+    thread = thread->next;
+  }
+  return thread;
+}
+
+static void _pi_link(thread_t * thread, thread_t * owner) {
+  anscheduler_lock(&piLock);
+  thread->state.piFlags |= FUTEX_PI_WAITING;
+  thread->state.piNext = piFirst;
+  piFirst = thread;
+  thread->state.piOwner = NULL;
+  if (!(owner->state.piFlags & FUTEX_PI_EXITED)) {
+    thread->state.piOwner = owner;
+    if (thread->priority > owner->priority) {
+      anscheduler_loop_set_priority(owner, thread->priority);
+    }
+  }
+  anscheduler_unlock(&piLock);
+}
+
+static void _pi_unlink(thread_t * thread) {
+  anscheduler_lock(&piLock);
+  thread_t ** link = &piFirst;
+  while (*link) {
+    if (*link == thread) {
+      (*link) = thread->state.piNext;
+      break;
+    }
+    link = &(*link)->state.piNext;
+  }
+  thread->state.piNext = NULL;
+  thread->state.piFlags &= ~FUTEX_PI_WAITING;
+  thread_t * owner = thread->state.piOwner;
+  thread->state.piOwner = NULL;
+  if (owner) _pi_update(owner);
+  anscheduler_unlock(&piLock);
+}
+
+static void _pi_update(thread_t * owner) {
+  // the caller holds piLock
+  uint8_t priority = owner->basePriority;
+  thread_t * thread = piFirst;
+  while (thread) {
+    if (thread->state.piOwner == owner && thread->priority > priority) {
+      priority = thread->priority;
+    }
+    thread = thread->state.piNext;
+  }
+  if (priority != owner->priority) {
+    anscheduler_loop_set_priority(owner, priority);
+  }
+}
+
+static void _lock_pair(futex_bucket_t * b1, futex_bucket_t * b2) {
+  // always lock the lower bucket first so two requeues cannot deadlock
+  if (b1 == b2) {
+    anscheduler_lock(&b1->lock);
+  } else if (b1 < b2) {
+    anscheduler_lock(&b1->lock);
+    anscheduler_lock(&b2->lock);
+  } else {
+    anscheduler_lock(&b2->lock);
+    anscheduler_lock(&b1->lock);
+  }
+}
+
+static void _unlock_pair(futex_bucket_t * b1, futex_bucket_t * b2) {
+  anscheduler_unlock(&b1->lock);
+  if (b1 != b2) anscheduler_unlock(&b2->lock);
+}
+
+static bool _dequeue_self(task_t * task, thread_t * thread) {
+  // a requeue may move the thread to another bucket until we hold the lock
+  // of the bucket its address currently hashes to
+  while (1) {
+    uint64_t addr = *((volatile uint64_t *)&thread->state.futexAddr);
+    if (!addr) return false;
+    futex_bucket_t * bucket = _bucket(task, addr);
+    anscheduler_lock(&bucket->lock);
+    if (thread->state.futexAddr == addr) {
+      _remove_waiter(bucket, thread);
+      anscheduler_unlock(&bucket->lock);
+      return true;
+    }
+    anscheduler_unlock(&bucket->lock);
+  }
+}
+
+static void _push_waiter(futex_bucket_t * bucket, thread_t * thread) {
+  thread->state.futexNext = NULL;
+  if (!bucket->first) {
+    bucket->first = thread;
+    return;
+  }
+  // append so that waiters on one address are woken in order
+  thread_t * last = bucket->first;
+  while (last->state.futexNext) {
+    last = last->state.futexNext;
+  }
+  last->state.futexNext = thread;
+}
+
+static bool _remove_waiter(futex_bucket_t * bucket, thread_t * thread) {
+  thread_t ** link = &bucket->first;
+  while (*link) {
+    if (*link == thread) {
+      (*link) = thread->state.futexNext;
+      thread->state.futexNext = NULL;
+      thread->state.futexAddr = 0;
+      if (thread->state.piFlags & FUTEX_PI_WAITING) _pi_unlink(thread);
+      return true;
+    }
+    link = &(*link)->state.futexNext;
+  }
+  return false;
+}
+
+static void _wake_thread(thread_t * thread) {
+  anscheduler_lock(&thread->state.sleepLock);
+  if (thread->state.isSleeping) {
+    thread->nextTimestamp = 0;
+    thread->state.isSleeping = false;
+  }
+  anscheduler_unlock(&thread->state.sleepLock);
+}
+
+static uint64_t _deadline(uint64_t usec) {
+  if (!usec) return 0xffffffffffffffffL;
+  uint64_t units = (anscheduler_second_length() * usec) / 1000000L;
+  uint64_t now = anscheduler_get_time();
+  uint64_t destTime = now + units;
+  if (destTime < now) destTime = 0xffffffffffffffffL;
+  return destTime;
+}
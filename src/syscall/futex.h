@@ -0,0 +1,77 @@
+/**
+ * Futexes let user space block on the value of a 64-bit word. Waiters are
+ * keyed on their task and the virtual address of the word, and are kept in a
+ * small hash table of wait queues.
+ */
+
+#ifndef __SYSCALL_FUTEX_H__
+#define __SYSCALL_FUTEX_H__
+
+#include <anscheduler/types.h>
+
+#define FUTEX_BUCKET_COUNT 0x40
+#define FUTEX_REQUEUE_MISMATCH 0xffffffffffffffffL
+
+// layout of a priority inheritance futex word; 0 means unlocked
+#define FUTEX_PI_OWNER 0xffffffffL // thread ID of the owner, plus one
+#define FUTEX_PI_WAITERS (1L << 63) // unlocking must go through the kernel
+
+// piFlags in a thread's state
+#define FUTEX_PI_WAITING 1
+#define FUTEX_PI_EXITED 2
+
+/**
+ * If the aligned 64-bit word at `ptr` still equals `expected`, sleep until
+ * syscall_futex_wake() is called on the same address or `usec` microseconds
+ * pass. A timeout of 0 waits forever. Returns 1 if a wake ended the wait, or
+ * 0 if the value did not match, the wait timed out, or the thread was woken
+ * for some other reason.
+ */
+uint64_t syscall_futex_wait(uint64_t * ptr, uint64_t expected, uint64_t usec);
+
+/**
+ * Wake up to `count` threads of this task waiting on `ptr`. Returns the number
+ * of threads woken.
+ */
+uint64_t syscall_futex_wake(uint64_t * ptr, uint64_t count);
+
+/**
+ * If the word at `ptr` still equals `expected`, wake one thread waiting on
+ * `ptr` and move every other waiter onto the wait queue for `target` without
+ * waking it. Returns the number of threads woken or moved, or
+ * FUTEX_REQUEUE_MISMATCH if the value did not match. Condition variables use
+ * this so that a broadcast does not wake every waiter just to have them all
+ * fight over the mutex.
+ */
+uint64_t syscall_futex_requeue(uint64_t * ptr,
+                               uint64_t expected,
+                               uint64_t * target);
+
+/**
+ * Acquire the priority inheritance futex at `ptr`, sleeping if another thread
+ * owns it. While we sleep, the owner (found through the thread ID in the
+ * word) runs with at least our priority. Returns 1 once we own the futex, or
+ * 0 if the caller should try again.
+ */
+uint64_t syscall_futex_lock_pi(uint64_t * ptr);
+
+/**
+ * Release a priority inheritance futex owned by the calling thread, handing it
+ * straight to its highest-priority waiter, and drop any priority boost it gave
+ * us. Returns 0 if we did not own it.
+ */
+uint64_t syscall_futex_unlock_pi(uint64_t * ptr);
+
+/**
+ * Recompute a thread's effective priority after its base priority changed.
+ * @critical
+ */
+void futex_priority_changed(thread_t * thread);
+
+/**
+ * Remove a thread which is about to be freed from any futex wait queue.
+ * @critical
+ */
+void futex_thread_cleanup(thread_t * thread);
+
+#endif
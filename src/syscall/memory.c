@@ -7,9 +7,11 @@
 #include <anscheduler/socket.h>
 #include <anscheduler/loop.h>
 #include <memory/kernpage.h>
+#include <scheduler/tlb.h>
 
 static task_t * _get_remote_task(uint64_t fd);
 static bool _vmmap_call(task_t * task, uint64_t virt, uint64_t entry);
+static void _vmunmap_call(task_t * task, uint64_t vpage);
 
 uint64_t syscall_allocate_page() {
   anscheduler_cpu_lock();
@@ -77,9 +79,7 @@ bool syscall_vmunmap(uint64_t fd, uint64_t vpage) {
     return false;
   }
 
-  anscheduler_lock(&task->vmLock);
-  anscheduler_vm_unmap(task->vm, vpage);
-  anscheduler_unlock(&task->vmLock);
+  _vmunmap_call(task, vpage);
   anscheduler_task_dereference(task);
 
   anscheduler_cpu_unlock();
@@ -94,7 +94,7 @@ bool syscall_invlpg(uint64_t fd) {
     return false;
   }
   
-  anscheduler_cpu_notify_invlpg(task);
+  tlb_flush_pending(task);
   anscheduler_task_dereference(task);
   anscheduler_cpu_unlock();
   return true;
@@ -108,9 +108,9 @@ uint64_t syscall_self_vm_read(uint64_t vpage) {
   }
 
   uint16_t flags;
-  anscheduler_lock(&task->vmLock);
+  anscheduler_read_lock(&task->vmLock);
   uint64_t page = anscheduler_vm_lookup(task->vm, vpage, &flags);
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_read_unlock(&task->vmLock);
   anscheduler_cpu_unlock();
 
   return (page << 12) | flags;
@@ -199,10 +199,7 @@ void syscall_self_vmunmap(uint64_t vpage) {
     anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_ACCESS);
   }
   
-  anscheduler_lock(&task->vmLock);
-  anscheduler_vm_unmap(task->vm, vpage);
-  anscheduler_unlock(&task->vmLock);
-  
+  _vmunmap_call(task, vpage);
   anscheduler_cpu_unlock();
 }
 
@@ -212,7 +209,7 @@ void syscall_self_invlpg() {
   if (task->uid) {
     anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_ACCESS);
   }
-  anscheduler_cpu_notify_invlpg(task);
+  tlb_flush_pending(task);
   anscheduler_cpu_unlock();
 }
 
@@ -261,11 +258,11 @@ uint64_t syscall_batch_vmunmap(uint64_t fd, uint64_t start, uint64_t count) {
     anscheduler_cpu_unlock();
     return 0;
   }
-  uint64_t i;
-  for (i = 0; i < count; i++) {
-    anscheduler_lock(&task->vmLock);
-    anscheduler_vm_unmap(task->vm, i + start);
-    anscheduler_unlock(&task->vmLock);
+  if (count && start + count > start) {
+    anscheduler_write_lock(&task->vmLock);
+    anscheduler_vm_unmap_range(task->vm, start, count, NULL, NULL);
+    anscheduler_write_unlock(&task->vmLock);
+    tlb_queue(task, start, count);
   }
   anscheduler_task_dereference(task);
   anscheduler_cpu_unlock();
@@ -279,16 +276,20 @@ void syscall_batch_alloc(uint64_t listOut, uint64_t count) {
   }
 
   uint64_t i;
+  task_cursor_t cursor;
+  task_cursor_init(&cursor);
   for (i = 0; i < count; i++) {
     uint64_t page = kernpage_alloc_virtual();
     if (!page) {
       anscheduler_abort("failed to allocate page for syscall_batch_alloc()");
     }
     uint64_t phyAddr = kernpage_calculate_physical(page) << 12;
-    if (!task_copy_out((void *)(listOut + (i << 3)), &phyAddr, 8)) {
+    void * dest = (void *)(listOut + (i << 3));
+    if (!task_cursor_copy_out(&cursor, dest, &phyAddr, 8)) {
       anscheduler_abort("failed to copy out for syscall_batch_alloc()");
     }
   }
+  task_cursor_release(&cursor);
   anscheduler_cpu_unlock();
 }
 
@@ -301,20 +302,77 @@ uint64_t syscall_batch_vmmap(uint64_t fd, uint64_t list, uint64_t count) {
   }
   uint64_t i;
   uint64_t firstVpage;
-  if (!task_copy_in(&firstVpage, (void *)list, 8)) {
+  task_cursor_t cursor;
+  task_cursor_init(&cursor);
+  if (!task_cursor_copy_in(&cursor, &firstVpage, (void *)list, 8)) {
     anscheduler_abort("syscall_batch_vmmap() failed to copy in address.\n");
   }
   for (i = 0; i < count; i++) {
     uint64_t entry;
-    if (!task_copy_in(&entry, (void *)(list + ((i + 1) << 3)), 8)) {
+    void * source = (void *)(list + ((i + 1) << 3));
+    if (!task_cursor_copy_in(&cursor, &entry, source, 8)) {
       anscheduler_abort("syscall_batch_vmmap() failed to copy in address.\n");
     }
-    anscheduler_lock(&task->vmLock);
-    bool res = anscheduler_vm_map(task->vm, firstVpage + i,
-                                  entry >> 12, entry & 0xfff);
-    anscheduler_unlock(&task->vmLock);
+    // the cursor holds our own vmLock, which mapping into ourself needs
+    if (task == anscheduler_cpu_get_task()) task_cursor_release(&cursor);
+    bool res = _vmmap_call(task, firstVpage + i, entry);
     if (!res) anscheduler_abort("syscall_batch_vmmap failed to map page.\n");
   }
+  task_cursor_release(&cursor);
+  anscheduler_task_dereference(task);
+  anscheduler_cpu_unlock();
+  return 1;
+}
+
+uint64_t syscall_batch_vmsample(uint64_t fd, uint64_t list, uint64_t count) {
+  anscheduler_cpu_lock();
+  task_t * task = _get_remote_task(fd);
+  if (!task) {
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  if (count > SYSCALL_VMSAMPLE_MAX) {
+    anscheduler_task_dereference(task);
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  uint64_t * entries = anscheduler_alloc(0x1000);
+  if (!entries) {
+    anscheduler_abort("syscall_batch_vmsample() failed to allocate buffer.\n");
+  }
+  if (!task_copy_in(entries, (void *)list, 8)) {
+    anscheduler_abort("syscall_batch_vmsample() failed to copy in address.\n");
+  }
+  uint64_t firstVpage = entries[0];
+
+  // the range of entries whose accessed flag we cleared
+  uint64_t clearStart = 0, clearEnd = 0;
+  uint64_t i;
+  anscheduler_write_lock(&task->vmLock);
+  for (i = 0; i < count; i++) {
+    uint16_t flags;
+    uint64_t page = anscheduler_vm_lookup(task->vm, firstVpage + i, &flags);
+    if (flags & ANSCHEDULER_PAGE_FLAG_ACCESSED) {
+      anscheduler_vm_map(task->vm, firstVpage + i, page,
+                         flags ^ ANSCHEDULER_PAGE_FLAG_ACCESSED);
+      if (clearStart == clearEnd) clearStart = i;
+      clearEnd = i + 1;
+    }
+    entries[i + 1] = (page << 12) | flags;
+  }
+  anscheduler_write_unlock(&task->vmLock);
+
+  // a CPU which still caches a translation will not set the flag again, so
+  // the pages would look idle to the next sample
+  if (clearStart != clearEnd) {
+    tlb_queue(task, firstVpage + clearStart, clearEnd - clearStart);
+    tlb_flush_pending(task);
+  }
+
+  if (!task_copy_out((void *)(list + 8), entries + 1, count << 3)) {
+    anscheduler_abort("syscall_batch_vmsample() failed to copy out entry.\n");
+  }
+  anscheduler_free(entries);
   anscheduler_task_dereference(task);
   anscheduler_cpu_unlock();
   return 1;
@@ -338,9 +396,23 @@ static task_t * _get_remote_task(uint64_t fd) {
 }
 
 static bool _vmmap_call(task_t * task, uint64_t vpage, uint64_t entry) {
-  anscheduler_lock(&task->vmLock);
+  uint16_t flags;
+  anscheduler_write_lock(&task->vmLock);
+  anscheduler_vm_lookup(task->vm, vpage, &flags);
   bool res = anscheduler_vm_map(task->vm, vpage, entry >> 12, entry & 0xfff);
-  anscheduler_unlock(&task->vmLock);
+  anscheduler_write_unlock(&task->vmLock);
+
+  // non-present entries are never cached, so filling one needs no shootdown
+  if (flags & ANSCHEDULER_PAGE_FLAG_PRESENT) tlb_queue(task, vpage, 1);
   return res;
 }
 
+static void _vmunmap_call(task_t * task, uint64_t vpage) {
+  anscheduler_write_lock(&task->vmLock);
+  anscheduler_vm_unmap(task->vm, vpage);
+  anscheduler_write_unlock(&task->vmLock);
+
+  // even a non-present entry may free a page table which is still cached
+  tlb_queue(task, vpage, 1);
+}
+
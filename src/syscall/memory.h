@@ -7,6 +7,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// the most entries syscall_batch_vmsample() reads at once
+#define SYSCALL_VMSAMPLE_MAX 0x1ff
+
 typedef struct {
   uint64_t taskId;
   uint64_t threadId;
@@ -61,7 +64,9 @@ bool syscall_vmunmap(uint64_t fd, uint64_t vpage);
 
 /**
  * Notify all CPUs running a certain task that its address space has been
- * altered.
+ * altered. Only the pages which were changed through the other calls in this
+ * file since the last notification are invalidated; if no present mapping
+ * was changed, no CPUs are interrupted at all.
  */
 bool syscall_invlpg(uint64_t fd);
 
@@ -143,3 +148,16 @@ void syscall_batch_alloc(uint64_t listOut, uint64_t count);
  */
 uint64_t syscall_batch_vmmap(uint64_t fd, uint64_t list, uint64_t count);
 
+
+/**
+ * Reads a list of page table entries from a remote task, clearing the
+ * accessed flag on each one so that the next sample only reports pages which
+ * were referenced in between.
+ * @param fd The link
+ * @param list The first entry stores the starting virtual page; the following
+ * `count` entries receive the page table entries as they were before the
+ * accessed flag was cleared.
+ * @param count The number of pages to sample, at most SYSCALL_VMSAMPLE_MAX.
+ * @return 0 if the socket is not open or `count` is too large; 1 otherwise
+ */
+uint64_t syscall_batch_vmsample(uint64_t fd, uint64_t list, uint64_t count);
@@ -0,0 +1,95 @@
+#include "ring.h"
+#include "sockets.h"
+#include "io.h"
+#include "time.h"
+#include "vm.h"
+#include <anscheduler/functions.h>
+#include <anscheduler/task.h>
+
+/**
+ * @noncritical
+ */
+static uint64_t _ring_run(const ring_sqe_t * sqe);
+
+/**
+ * @critical
+ */
+static void _copy_in(void * kPointer, const void * tPointer, uint64_t len);
+
+/**
+ * @critical
+ */
+static void _copy_out(void * tPointer, const void * kPointer, uint64_t len);
+
+uint64_t syscall_ring_enter(uint64_t ptr) {
+  ring_t * ring = (ring_t *)ptr;
+  uint64_t heads[4];
+  anscheduler_cpu_lock();
+  _copy_in(heads, ring, sizeof(heads));
+  uint64_t sqHead = heads[0], sqTail = heads[1];
+  uint64_t cqHead = heads[2], cqTail = heads[3];
+
+  uint64_t count = 0;
+  while (sqHead != sqTail && cqTail - cqHead < RING_ENTRIES
+         && count < RING_ENTRIES) {
+    ring_sqe_t sqe;
+    _copy_in(&sqe, &ring->sq[sqHead & (RING_ENTRIES - 1)], sizeof(sqe));
+    sqHead++;
+    count++;
+
+    // each operation is a syscall in its own right and may sleep
+    anscheduler_cpu_unlock();
+    ring_cqe_t cqe = {sqe.userData, _ring_run(&sqe)};
+    anscheduler_cpu_lock();
+
+    _copy_out(&ring->cq[cqTail & (RING_ENTRIES - 1)], &cqe, sizeof(cqe));
+    cqTail++;
+  }
+
+  // the completions were written before the tail that makes them visible
+  _copy_out(&ring->sqHead, &sqHead, sizeof(sqHead));
+  _copy_out(&ring->cqTail, &cqTail, sizeof(cqTail));
+  anscheduler_cpu_unlock();
+  return count;
+}
+
+static uint64_t _ring_run(const ring_sqe_t * sqe) {
+  const uint64_t * args = sqe->args;
+  switch (sqe->op) {
+    case RING_OP_NOP:
+      return 0;
+    case RING_OP_OPEN:
+      return syscall_open_socket();
+    case RING_OP_CONNECT:
+      return syscall_connect(args[0], args[1]);
+    case RING_OP_CLOSE:
+      syscall_close_socket(args[0]);
+      return 0;
+    case RING_OP_READ:
+      return syscall_read(args[0], args[1]);
+    case RING_OP_WRITE:
+      return syscall_write(args[0], args[1], args[2]);
+    case RING_OP_SLEEP:
+      syscall_sleep(args[0]);
+      return 0;
+    case RING_OP_IN:
+      return syscall_in(args[0], args[1]);
+    case RING_OP_OUT:
+      syscall_out(args[0], args[1], args[2]);
+      return 0;
+    default:
+      return RING_RESULT_INVAL;
+  }
+}
+
+static void _copy_in(void * kPointer, const void * tPointer, uint64_t len) {
+  if (!task_copy_in(kPointer, tPointer, len)) {
+    anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_MEMORY);
+  }
+}
+
+static void _copy_out(void * tPointer, const void * kPointer, uint64_t len) {
+  if (!task_copy_out(tPointer, kPointer, len)) {
+    anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_MEMORY);
+  }
+}
@@ -0,0 +1,58 @@
+/**
+ * A submission/completion ring lets a task queue many socket, sleep and port
+ * operations in its own memory and run them all with one syscall. The layout
+ * must stay in sync with libprog's base/ring.h. Like every other syscall
+ * argument, the ring and each buffer named in an entry must be on the
+ * submitting thread's stack.
+ */
+
+#ifndef __SYSCALL_RING_H__
+#define __SYSCALL_RING_H__
+
+#include <stdint.h>
+
+#define RING_ENTRIES 0x40 // must be a power of 2
+#define RING_RESULT_INVAL 0xffffffffffffffffL
+
+enum {
+  RING_OP_NOP,
+  RING_OP_OPEN, // () -> fd
+  RING_OP_CONNECT, // (fd, pid) -> 1 or 0
+  RING_OP_CLOSE, // (fd) -> 0
+  RING_OP_READ, // (fd, msgPtr) -> 1 or 0
+  RING_OP_WRITE, // (fd, ptr, len) -> 1 or 0
+  RING_OP_SLEEP, // (usec) -> 0
+  RING_OP_IN, // (port, size) -> value
+  RING_OP_OUT // (port, value, size) -> 0
+};
+
+typedef struct {
+  uint64_t op;
+  uint64_t args[3];
+  uint64_t userData;
+} __attribute__((packed)) ring_sqe_t;
+
+typedef struct {
+  uint64_t userData;
+  uint64_t result;
+} __attribute__((packed)) ring_cqe_t;
+
+typedef struct {
+  // the heads and tails count up forever; entries live at (index & mask)
+  uint64_t sqHead; // advanced by the kernel
+  uint64_t sqTail; // advanced by the task
+  uint64_t cqHead; // advanced by the task
+  uint64_t cqTail; // advanced by the kernel
+  ring_sqe_t sq[RING_ENTRIES];
+  ring_cqe_t cq[RING_ENTRIES];
+} __attribute__((packed)) ring_t;
+
+/**
+ * Run the entries queued in the ring at `ptr`, in order, and post one
+ * completion for each. Each entry behaves exactly like the matching syscall,
+ * including its permission checks. Stops early when the completion queue is
+ * full. Returns the number of entries consumed.
+ */
+uint64_t syscall_ring_enter(uint64_t ptr);
+
+#endif
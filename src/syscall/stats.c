@@ -0,0 +1,103 @@
+#include "stats.h"
+#include "functions.h"
+#include "vm.h"
+#include <scheduler/cpu.h>
+#include <anscheduler/functions.h>
+#include <anscheduler/task.h>
+
+// a CPU's table is a single page
+_Static_assert(SYSCALL_COUNT * sizeof(syscall_stat_t) <= 0x1000,
+               "syscall_stat_t table does not fit in a page");
+
+static uint64_t _read_tsc();
+static uint64_t _bucket(uint64_t cycles);
+static syscall_stat_t * _cpu_stats();
+
+uint64_t syscall_stats_begin(uint64_t number) {
+  if (number < SYSCALL_COUNT) {
+    anscheduler_cpu_lock();
+    syscall_stat_t * stats = _cpu_stats();
+    if (stats) stats[number].calls++;
+    anscheduler_cpu_unlock();
+  }
+  return _read_tsc();
+}
+
+void syscall_stats_end(uint64_t number, uint64_t start) {
+  if (number >= SYSCALL_COUNT) return;
+  uint64_t end = _read_tsc();
+  // a syscall which slept may finish on a CPU whose TSC is behind
+  uint64_t cycles = end > start ? end - start : 0;
+
+  anscheduler_cpu_lock();
+  syscall_stat_t * stats = _cpu_stats();
+  if (stats) {
+    stats[number].cycles += cycles;
+    stats[number].buckets[_bucket(cycles)]++;
+  }
+  anscheduler_cpu_unlock();
+}
+
+uint64_t syscall_syscallstat(void * buffer, uint64_t max, uint64_t flags) {
+  if (max > SYSCALL_COUNT) max = SYSCALL_COUNT;
+  anscheduler_cpu_lock();
+  if ((flags & SYSCALL_STAT_RESET) && anscheduler_cpu_get_task()->uid) {
+    anscheduler_task_exit(ANSCHEDULER_TASK_KILL_REASON_ACCESS);
+  }
+  syscall_stat_t * sum = anscheduler_alloc(0x1000);
+  if (!sum) {
+    anscheduler_cpu_unlock();
+    return 0;
+  }
+  anscheduler_zero(sum, 0x1000);
+
+  cpu_t * cpu = cpu_first();
+  for (; cpu; cpu = cpu->next) {
+    syscall_stat_t * stats = cpu->syscallStats;
+    if (!stats) continue;
+    uint64_t i, j;
+    for (i = 0; i < max; i++) {
+      sum[i].calls += stats[i].calls;
+      sum[i].cycles += stats[i].cycles;
+      for (j = 0; j < SYSCALL_STAT_BUCKETS; j++) {
+        sum[i].buckets[j] += stats[i].buckets[j];
+      }
+    }
+    if (flags & SYSCALL_STAT_RESET) {
+      anscheduler_zero(stats, sizeof(syscall_stat_t) * SYSCALL_COUNT);
+    }
+  }
+
+  if (!task_copy_out(buffer, sum, max * sizeof(syscall_stat_t))) {
+    max = 0;
+  }
+  anscheduler_free(sum);
+  anscheduler_cpu_unlock();
+  return max;
+}
+
+static syscall_stat_t * _cpu_stats() {
+  cpu_t * cpu = cpu_current();
+  if (!cpu->syscallStats) {
+    cpu->syscallStats = anscheduler_alloc(0x1000);
+    if (!cpu->syscallStats) return NULL;
+    anscheduler_zero(cpu->syscallStats, 0x1000);
+  }
+  return cpu->syscallStats;
+}
+
+static uint64_t _read_tsc() {
+  uint32_t lower, upper;
+  __asm__ __volatile__("rdtsc" : "=a" (lower), "=d" (upper));
+  return ((uint64_t)upper << 32) | lower;
+}
+
+static uint64_t _bucket(uint64_t cycles) {
+  uint64_t shift = SYSCALL_STAT_MIN_SHIFT;
+  uint64_t bucket = 0;
+  while (bucket < SYSCALL_STAT_BUCKETS - 1 && cycles >= (1L << shift)) {
+    bucket++;
+    shift++;
+  }
+  return bucket;
+}
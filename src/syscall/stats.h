@@ -0,0 +1,53 @@
+/**
+ * Each CPU counts the syscalls it runs and how many TSC cycles they take,
+ * from syscall_entry() until it returns. Calls are counted on entry, but only
+ * the ones which return add to the cycles and the histogram, so a syscall
+ * which never comes back through syscall_entry() (exit, thread_exit, or a
+ * blocking call resumed with its saved return state) has a call and no
+ * latency. The syscalls on entry.s's fast path never reach syscall_entry()
+ * and are not counted.
+ */
+
+#ifndef __SYSCALL_STATS_H__
+#define __SYSCALL_STATS_H__
+
+#include <stdint.h>
+
+// bucket i of a histogram counts calls of less than 2^(i + 7) cycles; the
+// last bucket counts everything longer
+#define SYSCALL_STAT_BUCKETS 0xc
+#define SYSCALL_STAT_MIN_SHIFT 7
+
+// flags for syscall_syscallstat()
+#define SYSCALL_STAT_RESET 1
+
+typedef struct {
+  uint64_t calls;
+  uint64_t cycles;
+  uint32_t buckets[SYSCALL_STAT_BUCKETS];
+} __attribute__((packed)) syscall_stat_t;
+
+/**
+ * Counts one call to syscall `number` on the CPU we are running on and
+ * returns the timestamp to pass to syscall_stats_end(). The CPU's table is
+ * allocated the first time.
+ * @noncritical
+ */
+uint64_t syscall_stats_begin(uint64_t number);
+
+/**
+ * Records the latency of a call to syscall `number` which began at `start`.
+ * @noncritical
+ */
+void syscall_stats_end(uint64_t number, uint64_t start);
+
+/**
+ * Copies the statistics of every CPU, added together, to `buffer`, an array
+ * of at most `max` syscall_stat_t indexed by syscall number. Returns the
+ * number of entries copied. With SYSCALL_STAT_RESET in `flags`, the counters
+ * are cleared afterwards; calls running on other CPUs at that moment may be
+ * lost. Only root may reset.
+ */
+uint64_t syscall_syscallstat(void * buffer, uint64_t max, uint64_t flags);
+
+#endif
@@ -0,0 +1,50 @@
+#include "taskinfo.h"
+#include <anscheduler/functions.h>
+#include <interrupts/lapic.h>
+
+#define CPUID_INVARIANT_TSC (1 << 8)
+
+static uint64_t _tsc_mult();
+
+bool taskinfo_create(task_t * task) {
+  taskinfo_t * info = anscheduler_alloc(0x1000);
+  if (!info) return false;
+  anscheduler_zero(info, 0x1000);
+  info->pid = task->pid;
+  info->uid = task->uid;
+  info->tscBase = lapic_get_tsc_calibrated();
+  info->tscMult = _tsc_mult();
+
+  uint64_t physical = anscheduler_vm_physical(((uint64_t)info) >> 12);
+  uint16_t flags = ANSCHEDULER_PAGE_FLAG_PRESENT | ANSCHEDULER_PAGE_FLAG_USER;
+  anscheduler_write_lock(&task->vmLock);
+  bool result = anscheduler_vm_map(task->vm, TASKINFO_PAGE, physical, flags);
+  anscheduler_write_unlock(&task->vmLock);
+  if (!result) {
+    anscheduler_free(info);
+    return false;
+  }
+  task->ui.info = info;
+  return true;
+}
+
+void taskinfo_cleanup(task_t * task) {
+  if (!task->ui.info) return;
+  anscheduler_cpu_lock();
+  anscheduler_free(task->ui.info);
+  anscheduler_cpu_unlock();
+}
+
+static uint64_t _tsc_mult() {
+  // the clock is only shared with user space if the TSC ticks at a constant
+  // rate, even across power states
+  uint32_t eax, edx;
+  __asm__("cpuid" : "=a" (eax), "=d" (edx) : "a" (0x80000000) : "rbx", "rcx");
+  if (eax < 0x80000007) return 0;
+  __asm__("cpuid" : "=a" (eax), "=d" (edx) : "a" (0x80000007) : "rbx", "rcx");
+  if (!(edx & CPUID_INVARIANT_TSC)) return 0;
+
+  uint64_t speed = lapic_get_tsc_speed();
+  if (!speed) return 0;
+  return (1000000000L << 32) / speed;
+}
@@ -0,0 +1,38 @@
+/**
+ * Every task gets a read-only page at TASKINFO_PAGE with facts about itself,
+ * so that libprog can answer the most common queries without a syscall. The
+ * layout must stay in sync with libprog's base/taskinfo.h.
+ */
+
+#ifndef __SYSCALL_TASKINFO_H__
+#define __SYSCALL_TASKINFO_H__
+
+#include <anscheduler/types.h>
+
+// the last page below the kernel stacks; code never gets this large
+#define TASKINFO_PAGE 0xfffff
+
+typedef struct {
+  uint64_t pid;
+  uint64_t uid;
+
+  // nanoseconds since boot are ((rdtsc - tscBase) * tscMult) >> 32; tscMult is
+  // 0 if the TSC is not invariant, and the syscall must be used instead
+  uint64_t tscBase;
+  uint64_t tscMult;
+} __attribute__((packed)) taskinfo_t;
+
+/**
+ * Allocate, fill in and map a new task's info page. Call this once the task's
+ * UID is final. Returns false if no memory was available.
+ * @critical
+ */
+bool taskinfo_create(task_t * task);
+
+/**
+ * Free the info page of a task which is being destroyed.
+ * @noncritical
+ */
+void taskinfo_cleanup(task_t * task);
+
+#endif
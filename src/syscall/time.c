@@ -9,13 +9,18 @@ static void _sleep_method(thread_t * th, uint64_t usec);
 
 uint64_t syscall_get_time() {
   anscheduler_cpu_lock();
-  uint64_t ts = anscheduler_get_time();
-  // provide a decent timestamp, but not perfect
-  uint64_t res = 1000 * ts / (anscheduler_second_length() / 1000);
+  uint64_t res = syscall_fast_get_time(anscheduler_cpu_get_thread());
   anscheduler_cpu_unlock();
   return res;
 }
 
+uint64_t syscall_fast_get_time(thread_t * thread) {
+  // the timestamp and bus speed both live in the low 4MB
+  uint64_t ts = anscheduler_get_time();
+  // provide a decent timestamp, but not perfect
+  return 1000 * ts / (anscheduler_second_length() / 1000);
+}
+
 void syscall_sleep(uint64_t usec) {
   anscheduler_cpu_lock();
   thread_t * thread = anscheduler_cpu_get_thread();
@@ -1,10 +1,15 @@
-#include <stdint.h>
+#include <anscheduler/types.h>
 
 /**
  * Return the current system time in microseconds.
  */
 uint64_t syscall_get_time();
 
+/**
+ * The same as syscall_get_time(), for the syscall fast path.
+ */
+uint64_t syscall_fast_get_time(thread_t * thread);
+
 /**
  * Sleep for a specified number of microseconds.
  */
@@ -4,122 +4,123 @@
 
 #define DO_STACK_VALIDATION
 
+#define COPY_MODE_IN 0
+#define COPY_MODE_OUT 1
+#define COPY_MODE_ZERO 2
+
 static bool _validate_stack_addr(const void * tPtr);
+static bool _validate_range(const void * tPtr, uint64_t len);
+static uint8_t * _cursor_page(task_cursor_t * cursor, uint64_t page, bool w);
+static bool _cursor_copy(task_cursor_t * cursor,
+                         uint64_t tAddr,
+                         uint8_t * kPointer,
+                         uint64_t len,
+                         int mode);
+static void _copy_bytes(void * dest, const void * source, uint64_t len);
+static void _zero_bytes(void * dest, uint64_t len);
 
 bool task_copy_in(void * kPointer, const void * tPointer, uint64_t len) {
-  if (!_validate_stack_addr(tPointer)) return false;
+  task_cursor_t cursor;
+  task_cursor_init(&cursor);
+  bool result = task_cursor_copy_in(&cursor, kPointer, tPointer, len);
+  task_cursor_release(&cursor);
+  return result;
+}
 
-  task_t * task = anscheduler_cpu_get_task();
+bool task_copy_out(void * tPointer, const void * kPointer, uint64_t len) {
+  task_cursor_t cursor;
+  task_cursor_init(&cursor);
+  bool result = task_cursor_copy_out(&cursor, tPointer, kPointer, len);
+  task_cursor_release(&cursor);
+  return result;
+}
 
-  uint64_t firstPage = ((uint64_t)tPointer) >> 12;
-  uint64_t startOffset = ((uint64_t)tPointer) & 0xfff;
-  uint64_t finalPage = ((uint64_t)tPointer + len) >> 12;
-  uint64_t finalOffset = ((uint64_t)tPointer + len) & 0xfff;
-  uint64_t i;
-  for (i = firstPage; i <= finalPage; i++) {
-    uint64_t start = 0, end = 0x1000;
-    if (i == firstPage) start = startOffset;
-    if (i == finalPage) end = finalOffset;
-    if (end == 0) break;
-
-    anscheduler_lock(&task->vmLock);
-    uint16_t flags;
-    uint64_t entry = anscheduler_vm_lookup(task->vm, i, &flags);
-    if (flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) {
-      flags = ANSCHEDULER_PAGE_FLAG_USER
-        | ANSCHEDULER_PAGE_FLAG_PRESENT
-        | ANSCHEDULER_PAGE_FLAG_WRITE;
-      void * ptr = anscheduler_alloc(0x1000);
-      anscheduler_zero(ptr, 0x1000);
-      entry = anscheduler_vm_physical(((uint64_t)ptr) >> 12);
-      anscheduler_vm_map(task->vm, i, entry, flags);
-    }
-    anscheduler_unlock(&task->vmLock);
-    if (!(flags & ANSCHEDULER_PAGE_FLAG_PRESENT)
-        || !(flags & ANSCHEDULER_PAGE_FLAG_USER)) {
-      return false;
-    }
-    uint8_t * source = (uint8_t *)(anscheduler_vm_virtual(entry) << 12);
-    uint8_t * dest = kPointer;
-    uint64_t j;
-    for (j = 0; j < end - start; j++) {
-      dest[j] = source[start + j];
+bool task_copy_in_string(char * kPointer,
+                         const char * tPointer,
+                         uint64_t max,
+                         uint64_t * lenOut) {
+  task_cursor_t cursor;
+  task_cursor_init(&cursor);
+
+  uint64_t tAddr = (uint64_t)tPointer;
+  uint64_t copied = 0;
+  while (copied < max) {
+    if (!_validate_stack_addr((const void *)tAddr)) break;
+    uint8_t * source = _cursor_page(&cursor, tAddr >> 12, false);
+    if (!source) break;
+
+    uint64_t offset = tAddr & 0xfff;
+    uint64_t chunk = 0x1000 - offset;
+    if (chunk > max - copied) chunk = max - copied;
+
+    uint64_t i;
+    for (i = 0; i < chunk; i++) {
+      char ch = (char)source[offset + i];
+      kPointer[copied + i] = ch;
+      if (!ch) {
+        (*lenOut) = copied + i;
+        task_cursor_release(&cursor);
+        return true;
+      }
     }
-    kPointer += end - start;
+    copied += chunk;
+    tAddr += chunk;
   }
+  task_cursor_release(&cursor);
+  if (copied < max) return false;
+  (*lenOut) = max;
   return true;
 }
 
-bool task_copy_out(void * tPointer, const void * kPointer, uint64_t len) {
-  if (!_validate_stack_addr(tPointer)) return false;
-  task_t * task = anscheduler_cpu_get_task();
+bool task_zero_out(void * tPointer, uint64_t len) {
+  if (!_validate_range(tPointer, len)) return false;
+  task_cursor_t cursor;
+  task_cursor_init(&cursor);
+  bool result = _cursor_copy(&cursor, (uint64_t)tPointer, NULL, len,
+                             COPY_MODE_ZERO);
+  task_cursor_release(&cursor);
+  return result;
+}
 
-  uint64_t firstPage = ((uint64_t)tPointer) >> 12;
-  uint64_t startOffset = ((uint64_t)tPointer) & 0xfff;
-  uint64_t finalPage = ((uint64_t)tPointer + len) >> 12;
-  uint64_t finalOffset = ((uint64_t)tPointer + len) & 0xfff;
-
-  uint64_t i;
-  for (i = firstPage; i <= finalPage; i++) {
-    uint64_t start = 0, end = 0x1000;
-    if (i == firstPage) start = startOffset;
-    if (i == finalPage) end = finalOffset;
-    anscheduler_lock(&task->vmLock);
-    uint16_t flags;
-    uint64_t entry = anscheduler_vm_lookup(task->vm, i, &flags);
-    if (flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) {
-      flags = ANSCHEDULER_PAGE_FLAG_USER
-        | ANSCHEDULER_PAGE_FLAG_PRESENT
-        | ANSCHEDULER_PAGE_FLAG_WRITE;
-      void * ptr = anscheduler_alloc(0x1000);
-      anscheduler_zero(ptr, 0x1000);
-      entry = anscheduler_vm_physical(((uint64_t)ptr) >> 12);
-      anscheduler_vm_map(task->vm, i, entry, flags);
-    }
-    anscheduler_unlock(&task->vmLock);
-    if (!(flags & ANSCHEDULER_PAGE_FLAG_PRESENT)
-        || !(flags & ANSCHEDULER_PAGE_FLAG_USER)
-        || !(flags & ANSCHEDULER_PAGE_FLAG_WRITE)) {
-      return false;
-    }
-    uint8_t * dest = (uint8_t *)(anscheduler_vm_virtual(entry) << 12);
-    const uint8_t * source = kPointer;
-    uint64_t j;
-    for (j = 0; j < end - start; j++) {
-      dest[j + start] = source[j];
-    }
-    kPointer += end - start;
+void task_cursor_init(task_cursor_t * cursor) {
+  cursor->page = 0;
+  cursor->kernel = NULL;
+  cursor->writable = false;
+  cursor->locked = false;
+}
+
+void task_cursor_release(task_cursor_t * cursor) {
+  if (cursor->locked) {
+    anscheduler_read_unlock(&anscheduler_cpu_get_task()->vmLock);
   }
-  return true;
+  task_cursor_init(cursor);
 }
 
-bool task_get_virtual(const void * tPtr, void ** out) {
-  if (!_validate_stack_addr(tPtr)) return false;
+bool task_cursor_copy_in(task_cursor_t * cursor,
+                         void * kPointer,
+                         const void * tPointer,
+                         uint64_t len) {
+  if (!_validate_range(tPointer, len)) return false;
+  return _cursor_copy(cursor, (uint64_t)tPointer, kPointer, len,
+                      COPY_MODE_IN);
+}
 
-  task_t * task = anscheduler_cpu_get_task();
-  uint64_t pageIdx = ((uint64_t)tPtr) >> 12;
+bool task_cursor_copy_out(task_cursor_t * cursor,
+                          void * tPointer,
+                          const void * kPointer,
+                          uint64_t len) {
+  if (!_validate_range(tPointer, len)) return false;
+  return _cursor_copy(cursor, (uint64_t)tPointer, (uint8_t *)kPointer, len,
+                      COPY_MODE_OUT);
+}
 
-  anscheduler_lock(&task->vmLock);
-  uint16_t flags;
-  uint64_t entry = anscheduler_vm_lookup(task->vm, pageIdx, &flags);
-  if (flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) {
-    flags = ANSCHEDULER_PAGE_FLAG_USER
-      | ANSCHEDULER_PAGE_FLAG_PRESENT
-      | ANSCHEDULER_PAGE_FLAG_WRITE;
-    void * ptr = anscheduler_alloc(0x1000);
-    anscheduler_zero(ptr, 0x1000);
-    entry = anscheduler_vm_physical(((uint64_t)ptr) >> 12);
-    anscheduler_vm_map(task->vm, pageIdx, entry, flags);
-  }
-  anscheduler_unlock(&task->vmLock);
-  if (!(flags & ANSCHEDULER_PAGE_FLAG_PRESENT)
-      || !(flags & ANSCHEDULER_PAGE_FLAG_USER)
-      || !(flags & ANSCHEDULER_PAGE_FLAG_WRITE)) {
-    return false;
-  }
+bool task_get_virtual(task_cursor_t * cursor, const void * tPtr, void ** out) {
+  if (!_validate_stack_addr(tPtr)) return false;
+
+  uint8_t * page = _cursor_page(cursor, ((uint64_t)tPtr) >> 12, true);
+  if (!page) return false;
 
-  uint64_t vPage = anscheduler_vm_virtual(entry);
-  *out = (void *)((vPage << 12) + (((uint64_t)tPtr) & 0xfff));
+  *out = (void *)(page + (((uint64_t)tPtr) & 0xfff));
   return true;
 }
 
@@ -135,3 +136,115 @@ static bool _validate_stack_addr(const void * tPtr) {
 #endif
 }
 
+static bool _validate_range(const void * tPtr, uint64_t len) {
+  if (!len) return true;
+  uint64_t last = (uint64_t)tPtr + len - 1;
+  if (last < (uint64_t)tPtr) return false;
+  if (!_validate_stack_addr(tPtr)) return false;
+  return _validate_stack_addr((const void *)last);
+}
+
+/**
+ * Returns the kernel address of a task page, allocating it if it was lazily
+ * mapped. The result is cached in the cursor, so consecutive calls for the
+ * same page do not touch the page tables. The cursor keeps the task's vmLock
+ * for reading from its first lookup until task_cursor_release(), so no page
+ * it returned can be unmapped and freed while it is in use.
+ */
+static uint8_t * _cursor_page(task_cursor_t * cursor, uint64_t page, bool w) {
+  if (cursor->kernel && cursor->page == page && (cursor->writable || !w)) {
+    return cursor->kernel;
+  }
+
+  task_t * task = anscheduler_cpu_get_task();
+  if (!cursor->locked) {
+    anscheduler_read_lock(&task->vmLock);
+    cursor->locked = true;
+  }
+  uint16_t flags;
+  uint64_t entry = anscheduler_vm_lookup(task->vm, page, &flags);
+
+  while (flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) {
+    // look again under the write lock; another thread may have beaten us
+    anscheduler_read_unlock(&task->vmLock);
+    anscheduler_write_lock(&task->vmLock);
+    entry = anscheduler_vm_lookup(task->vm, page, &flags);
+    void * ptr = NULL;
+    if (flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) {
+      ptr = anscheduler_alloc(0x1000);
+      if (ptr) {
+        anscheduler_zero(ptr, 0x1000);
+        entry = anscheduler_vm_physical(((uint64_t)ptr) >> 12);
+        anscheduler_vm_map(task->vm, page, entry,
+                           ANSCHEDULER_PAGE_FLAG_USER
+                           | ANSCHEDULER_PAGE_FLAG_PRESENT
+                           | ANSCHEDULER_PAGE_FLAG_WRITE);
+      }
+    }
+    anscheduler_write_unlock(&task->vmLock);
+    anscheduler_read_lock(&task->vmLock);
+    if ((flags & ANSCHEDULER_PAGE_FLAG_UNALLOC) && !ptr) return NULL;
+
+    // the page may have changed again while no lock was held
+    entry = anscheduler_vm_lookup(task->vm, page, &flags);
+  }
+
+  if (!(flags & ANSCHEDULER_PAGE_FLAG_PRESENT)
+      || !(flags & ANSCHEDULER_PAGE_FLAG_USER)) {
+    return NULL;
+  }
+  if (w && !(flags & ANSCHEDULER_PAGE_FLAG_WRITE)) return NULL;
+
+  cursor->page = page;
+  cursor->kernel = (uint8_t *)(anscheduler_vm_virtual(entry) << 12);
+  cursor->writable = (flags & ANSCHEDULER_PAGE_FLAG_WRITE) != 0;
+  return cursor->kernel;
+}
+
+static bool _cursor_copy(task_cursor_t * cursor,
+                         uint64_t tAddr,
+                         uint8_t * kPointer,
+                         uint64_t len,
+                         int mode) {
+  while (len) {
+    uint8_t * page = _cursor_page(cursor, tAddr >> 12, mode != COPY_MODE_IN);
+    if (!page) return false;
+
+    uint64_t offset = tAddr & 0xfff;
+    uint64_t chunk = 0x1000 - offset;
+    if (chunk > len) chunk = len;
+
+    if (mode == COPY_MODE_IN) {
+      _copy_bytes(kPointer, page + offset, chunk);
+    } else if (mode == COPY_MODE_OUT) {
+      _copy_bytes(page + offset, kPointer, chunk);
+    } else {
+      _zero_bytes(page + offset, chunk);
+    }
+
+    if (kPointer) kPointer += chunk;
+    tAddr += chunk;
+    len -= chunk;
+  }
+  return true;
+}
+
+static void _copy_bytes(void * dest, const void * source, uint64_t len) {
+  uint64_t count = len >> 3;
+  __asm__ __volatile__("rep movsq\n"
+                       "mov %3, %%rcx\n"
+                       "rep movsb"
+                       : "+D" (dest), "+S" (source), "+c" (count)
+                       : "r" (len & 7)
+                       : "memory");
+}
+
+static void _zero_bytes(void * dest, uint64_t len) {
+  uint64_t count = len >> 3;
+  __asm__ __volatile__("rep stosq\n"
+                       "mov %2, %%rcx\n"
+                       "rep stosb"
+                       : "+D" (dest), "+c" (count)
+                       : "r" (len & 7), "a" (0UL)
+                       : "memory");
+}
@@ -4,6 +4,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/**
+ * Remembers the last task page that was translated so that a run of small
+ * copies to or from nearby addresses only looks each page up once.
+ */
+typedef struct {
+  uint64_t page;
+  uint8_t * kernel;
+  bool writable;
+  bool locked; // holding the task's vmLock for reading
+} __attribute__((packed)) task_cursor_t;
+
 /**
  * Copies the contents at a virtual memory address in the current task's address
  * to a pointer in *our* address space. Returns false if the specified task ptr
@@ -20,14 +31,68 @@ bool task_copy_in(void * kPointer, const void * tPointer, uint64_t len);
  */
 bool task_copy_out(void * tPointer, const void * kPointer, uint64_t len);
 
+/**
+ * Copies a NUL-terminated string from the current task's address space. At
+ * most `max` bytes are copied; the copy stops after the first NUL byte. The
+ * number of bytes before the terminator (or `max` if none was found) is
+ * written to `lenOut`. Returns false if any page of the string is invalid.
+ * @critical
+ */
+bool task_copy_in_string(char * kPointer,
+                         const char * tPointer,
+                         uint64_t max,
+                         uint64_t * lenOut);
+
+/**
+ * Fills `len` bytes of the task's address space with zeroes. Fails like
+ * task_copy_out() if the task cannot write to the memory.
+ * @critical
+ */
+bool task_zero_out(void * tPointer, uint64_t len);
+
+/**
+ * Resets a cursor so its next use performs a fresh page lookup.
+ */
+void task_cursor_init(task_cursor_t * cursor);
+
+/**
+ * Releases the task's vmLock, which a cursor holds for reading from its first
+ * copy on, and resets the cursor. Every cursor must be released, even after a
+ * failed copy. Do not take the task's vmLock while holding a cursor.
+ * @critical
+ */
+void task_cursor_release(task_cursor_t * cursor);
+
+/**
+ * Like task_copy_in(), but reuses the translation cached in `cursor`.
+ * @critical
+ */
+bool task_cursor_copy_in(task_cursor_t * cursor,
+                         void * kPointer,
+                         const void * tPointer,
+                         uint64_t len);
+
+/**
+ * Like task_copy_out(), but reuses the translation cached in `cursor`.
+ * @critical
+ */
+bool task_cursor_copy_out(task_cursor_t * cursor,
+                          void * tPointer,
+                          const void * kPointer,
+                          uint64_t len);
+
 /**
  * Gets the virtual address in kernel space for the user-space address. This is
  * only guaranteed to be valid on a page boundary, so you must verify the
- * alignment of your address in advance.
+ * alignment of your address in advance. The address stays valid until the
+ * cursor is released.
+ * @param cursor A cursor to hold the task's vmLock with
  * @param tPtr The task pointer
  * @param outPtr The output pointer in kernel space
  * @return true if the address could be found; false otherwise
  */
-bool task_get_virtual(const void * tPtr, void ** ourPtr);
+bool task_get_virtual(task_cursor_t * cursor,
+                      const void * tPtr,
+                      void ** ourPtr);
 
 #endif